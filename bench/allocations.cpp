@@ -0,0 +1,114 @@
+#include "allocations.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<std::uint64_t> s_allocations{0};
+
+static void *countedAllocate(std::size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    void *pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+static void *countedAllocate(std::size_t size, std::align_val_t alignment)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    auto align = static_cast<std::size_t>(alignment);
+    // aligned_alloc wants a multiple of the alignment
+    void *pointer = std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (pointer == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void *operator new(std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return countedAllocate(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return countedAllocate(size, alignment);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+namespace bench
+{
+    std::uint64_t allocationCount()
+    {
+        return s_allocations.load(std::memory_order_relaxed);
+    }
+
+    AllocationCounter::AllocationCounter() : m_start(allocationCount())
+    {
+    }
+
+    void AllocationCounter::report(benchmark::State &state, std::size_t rowsPerIteration) const
+    {
+        auto allocations = static_cast<double>(allocationCount() - m_start);
+        auto iterations = static_cast<double>(state.iterations());
+        auto rows = static_cast<double>(rowsPerIteration);
+
+        state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(rowsPerIteration));
+        state.counters["allocs"] = allocations / iterations;
+        state.counters["allocs_per_row"] = rows > 0 ? allocations / iterations / rows : 0.0;
+    }
+}  // namespace bench
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+namespace bench
+{
+    // Number of operator new calls in the whole process so far. The global operators are
+    // replaced in allocations.cpp, so this only counts inside the benchmarks binary.
+    std::uint64_t allocationCount();
+
+    // Counts the allocations made from construction to report(), and reports them per
+    // iteration ("allocs") and per row ("allocs_per_row") next to a rows/s throughput
+    class AllocationCounter
+    {
+      public:
+        AllocationCounter();
+
+        void report(benchmark::State &state, std::size_t rowsPerIteration) const;
+
+      private:
+        std::uint64_t m_start;
+    };
+}  // namespace bench
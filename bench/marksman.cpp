@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <thread>
+
+#include "lib/concurrency/thread_pool.hpp"
+#include "marksman/categorizer.hpp"
+#include "marksman/category_matcher.hpp"
+#include "marksman/duplifinder.hpp"
+
+#include "allocations.hpp"
+#include "synthetic.hpp"
+
+static void BM_FindPossibleDuplicates(benchmark::State &state)
+{
+    auto rows = static_cast<std::size_t>(state.range(0));
+    const sheet::Ledger &ledger = bench::cachedLedger(rows);
+
+    bench::AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(marksman::findPossibleDuplicates(ledger));
+    }
+    allocations.report(state, rows);
+}
+BENCHMARK(BM_FindPossibleDuplicates)
+    ->RangeMultiplier(10)
+    ->Range(1000, 10000000)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_MatchSubjectToCategories(benchmark::State &state)
+{
+    auto rows = static_cast<std::size_t>(state.range(0));
+    const sheet::Ledger &ledger = bench::cachedLedger(rows);
+    marksman::CategoryMatcher matcher(
+        bench::makeCategoryMap(static_cast<std::size_t>(state.range(1))));
+
+    bench::AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(marksman::matchSubjectToCategories(ledger, matcher));
+    }
+    allocations.report(state, rows);
+}
+BENCHMARK(BM_MatchSubjectToCategories)
+    ->ArgsProduct({benchmark::CreateRange(1000, 10000000, 10), {100, 10000}})
+    ->ArgNames({"rows", "keywords"})
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_MatchSubjectToCategoriesParallel(benchmark::State &state)
+{
+    auto rows = static_cast<std::size_t>(state.range(0));
+    const sheet::Ledger &ledger = bench::cachedLedger(rows);
+    marksman::CategoryMatcher matcher(
+        bench::makeCategoryMap(static_cast<std::size_t>(state.range(1))));
+    concurrency::ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+
+    bench::AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(marksman::matchSubjectToCategories(ledger, matcher, pool));
+    }
+    allocations.report(state, rows);
+}
+BENCHMARK(BM_MatchSubjectToCategoriesParallel)
+    ->ArgsProduct({benchmark::CreateRange(1000, 10000000, 10), {100, 10000}})
+    ->ArgNames({"rows", "keywords"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+static void BM_ParseCategoryMap(benchmark::State &state)
+{
+    auto keywords = static_cast<std::size_t>(state.range(0));
+    std::string csv = bench::makeCategoryCsv(bench::makeCategoryMap(keywords));
+
+    bench::AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(marksman::parseCategoryMap(csv));
+    }
+    allocations.report(state, keywords);
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(csv.size()));
+}
+BENCHMARK(BM_ParseCategoryMap)->RangeMultiplier(10)->Range(100, 100000);
+
+static void BM_CompileCategoryMatcher(benchmark::State &state)
+{
+    auto keywords = static_cast<std::size_t>(state.range(0));
+    auto categoryMap = bench::makeCategoryMap(keywords);
+
+    bench::AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        marksman::CategoryMatcher matcher(categoryMap);
+        benchmark::DoNotOptimize(matcher);
+    }
+    allocations.report(state, keywords);
+}
+BENCHMARK(BM_CompileCategoryMatcher)->RangeMultiplier(10)->Range(100, 100000);
@@ -0,0 +1,25 @@
+#include <benchmark/benchmark.h>
+
+#include "reporter/report.hpp"
+
+#include "allocations.hpp"
+#include "synthetic.hpp"
+
+static void BM_TotalsSince(benchmark::State &state)
+{
+    auto rows = static_cast<std::size_t>(state.range(0));
+    const sheet::Ledger &ledger = bench::cachedLedger(rows);
+    // The newer half of the rows is in the window
+    std::int64_t since = ledger.empty() ? 0 : ledger.date(rows / 2);
+
+    bench::AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(reporter::totalsSince(ledger, since));
+    }
+    allocations.report(state, rows);
+}
+BENCHMARK(BM_TotalsSince)
+    ->RangeMultiplier(10)
+    ->Range(1000, 10000000)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,125 @@
+#include <benchmark/benchmark.h>
+#include <future>
+#include <memory>
+#include <stdexcept>
+
+#include "lib/sheet/client.hpp"
+#include "lib/sheet/ledger.hpp"
+
+#include "allocations.hpp"
+#include "synthetic.hpp"
+
+// Serves one canned values response in network-sized chunks, without any network
+class CannedRequester : public network::RequesterInterface
+{
+  public:
+    explicit CannedRequester(std::string body) : m_body(std::move(body))
+    {
+    }
+
+    void getRequestStream(
+        const std::string &, const std::vector<std::string> &,
+        const std::function<void(const char *data, std::size_t length)> &onChunk) override
+    {
+        static const std::size_t CHUNK_SIZE = 16 * 1024;
+        for (std::size_t offset = 0; offset < m_body.size(); offset += CHUNK_SIZE)
+        {
+            onChunk(m_body.data() + offset, std::min(CHUNK_SIZE, m_body.size() - offset));
+        }
+    }
+
+    std::future<network::Response> sendAsync(network::Request) override
+    {
+        throw std::logic_error("not used by the benchmarks");
+    }
+    std::future<std::string> getRequestAsync(const std::string &,
+                                             const std::vector<std::string> &) override
+    {
+        throw std::logic_error("not used by the benchmarks");
+    }
+    std::future<std::string> postRequestAsync(const std::string &, const std::vector<std::string> &,
+                                              const std::string &) override
+    {
+        throw std::logic_error("not used by the benchmarks");
+    }
+    std::future<std::string> putRequestAsync(const std::string &, const std::vector<std::string> &,
+                                             const std::string &) override
+    {
+        throw std::logic_error("not used by the benchmarks");
+    }
+    std::string getRequest(const std::string &, const std::vector<std::string> &) override
+    {
+        throw std::logic_error("not used by the benchmarks");
+    }
+    std::string postRequest(const std::string &, const std::vector<std::string> &,
+                            const std::string &) override
+    {
+        throw std::logic_error("not used by the benchmarks");
+    }
+    std::string putRequest(const std::string &, const std::vector<std::string> &,
+                           const std::string &) override
+    {
+        throw std::logic_error("not used by the benchmarks");
+    }
+
+  private:
+    std::string m_body;
+};
+
+class FixedTokenProvider : public auth::TokenProviderInterface
+{
+  public:
+    std::string getAccessToken(const std::string &) override
+    {
+        return "token";
+    }
+};
+
+static std::unique_ptr<sheet::Client> makeClient(std::size_t rows)
+{
+    auto requester =
+        std::make_shared<CannedRequester>(bench::makeValuesResponse(bench::makeTransactions(rows)));
+    auto client =
+        std::make_unique<sheet::Client>(requester, std::make_shared<FixedTokenProvider>());
+    client->setSheetId("benchmark");
+    return client;
+}
+
+// What getTransactions costs once the bytes have arrived
+static void BM_GetTransactions(benchmark::State &state)
+{
+    auto rows = static_cast<std::size_t>(state.range(0));
+    auto client = makeClient(rows);
+
+    bench::AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(client->getTransactions());
+    }
+    allocations.report(state, rows);
+}
+BENCHMARK(BM_GetTransactions)
+    ->RangeMultiplier(10)
+    ->Range(1000, 1000000)
+    ->Unit(benchmark::kMillisecond);
+
+// The same response streamed into a Ledger, as marksman and reporter read it
+static void BM_StreamIntoLedger(benchmark::State &state)
+{
+    auto rows = static_cast<std::size_t>(state.range(0));
+    auto client = makeClient(rows);
+
+    bench::AllocationCounter allocations;
+    for (auto _ : state)
+    {
+        sheet::Ledger ledger;
+        client->streamTransactions([&ledger](sheet::Transaction &&transaction)
+                                   { ledger.append(transaction); });
+        benchmark::DoNotOptimize(ledger);
+    }
+    allocations.report(state, rows);
+}
+BENCHMARK(BM_StreamIntoLedger)
+    ->RangeMultiplier(10)
+    ->Range(1000, 1000000)
+    ->Unit(benchmark::kMillisecond);
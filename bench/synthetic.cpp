@@ -0,0 +1,176 @@
+#include "synthetic.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+namespace bench
+{
+    static const char *const ACCOUNTS[] = {
+        "Cash", "BCA", "Mandiri", "Jenius", "OVO", "GoPay", "Credit Card", "Savings  ",
+    };
+    static const char *const CURRENCIES[] = {"IDR", "IDR", "IDR", "USD", "JPY"};
+    static const char *const WORDS[] = {
+        "Indomaret", "Alfamart", "Starbucks", "Grab",     "Gojek",    "Tokopedia", "Shopee",
+        "PLN",       "Telkomsel", "Netflix",  "Spotify",  "Steam",    "Lunch",     "Dinner",
+        "Coffee",    "Parking",   "Toll",     "Pharmacy", "Bakery",   "Transfer",  "Salary",
+        "Rent",      "Laundry",   "Cinema",   "Books",    "Groceries", "Fuel",     "Taxi",
+    };
+    static const char *const CATEGORIES[] = {
+        "Food", "Transport", "Shopping", "Bills", "Entertainment", "Income", "Health",
+    };
+    static const std::int64_t AMOUNTS[] = {
+        -15000, -25000, -32000, -50000, -75000, -100000, -120000, -250000, -1000000, 5000000,
+    };
+
+    template <typename T, std::size_t N> static constexpr std::size_t countOf(T (&)[N])
+    {
+        return N;
+    }
+
+    TransactionGenerator::TransactionGenerator(std::uint64_t seed)
+        // 2020-01-01T00:00Z
+        : m_random(seed), m_minutes(26297280)
+    {
+    }
+
+    std::size_t TransactionGenerator::pick(std::size_t count)
+    {
+        return static_cast<std::size_t>(m_random() % count);
+    }
+
+    sheet::Transaction TransactionGenerator::next()
+    {
+        // About 50 rows a day, some on whole days without a time of day
+        m_minutes += static_cast<std::int64_t>(pick(58));
+        std::int64_t minutes = pick(5) == 0 ? m_minutes - m_minutes % (24 * 60) : m_minutes;
+        std::chrono::system_clock::time_point date(std::chrono::minutes{minutes});
+
+        if (!m_recent.empty() && pick(100) == 0)
+        {
+            sheet::Transaction duplicate = m_recent[pick(m_recent.size())];
+            duplicate.date = date;
+            return duplicate;
+        }
+
+        std::size_t currency = pick(countOf(CURRENCIES));
+        sheet::Transaction transaction{
+            ACCOUNTS[pick(countOf(ACCOUNTS))],
+            std::string(WORDS[pick(countOf(WORDS))]) + " " + WORDS[pick(countOf(WORDS))] + " #" +
+                std::to_string(pick(10000)),
+            date,
+            static_cast<int>(AMOUNTS[pick(countOf(AMOUNTS))] / (currency < 3 ? 1 : 1000)),
+            CURRENCIES[currency],
+            pick(10) < 3 ? CATEGORIES[pick(countOf(CATEGORIES))] : "",
+        };
+
+        if (m_recent.size() < 64)
+        {
+            m_recent.push_back(transaction);
+        }
+        else
+        {
+            m_recent[pick(m_recent.size())] = transaction;
+        }
+        return transaction;
+    }
+
+    std::vector<sheet::Transaction> makeTransactions(std::size_t rows, std::uint64_t seed)
+    {
+        TransactionGenerator generator(seed);
+        std::vector<sheet::Transaction> transactions;
+        transactions.reserve(rows);
+        for (std::size_t i = 0; i < rows; ++i)
+        {
+            transactions.push_back(generator.next());
+        }
+        return transactions;
+    }
+
+    sheet::Ledger makeLedger(std::size_t rows, std::uint64_t seed)
+    {
+        // Streamed straight into the columns, so even 10M rows never exist as Transactions
+        TransactionGenerator generator(seed);
+        sheet::Ledger ledger;
+        ledger.reserve(rows);
+        for (std::size_t i = 0; i < rows; ++i)
+        {
+            ledger.append(generator.next());
+        }
+        return ledger;
+    }
+
+    const sheet::Ledger &cachedLedger(std::size_t rows)
+    {
+        static std::size_t cachedRows = 0;
+        static std::unique_ptr<sheet::Ledger> cached;
+        if (cached == nullptr || cachedRows != rows)
+        {
+            cached.reset();
+            cached = std::make_unique<sheet::Ledger>(makeLedger(rows));
+            cachedRows = rows;
+        }
+        return *cached;
+    }
+
+    std::map<std::string, std::string> makeCategoryMap(std::size_t keywords, std::uint64_t seed)
+    {
+        std::mt19937_64 random(seed);
+        std::map<std::string, std::string> categoryMap;
+
+        // The vocabulary itself, so real subjects match, then made-up words that mostly do not
+        for (std::size_t i = 0; i < countOf(WORDS) && categoryMap.size() < keywords; ++i)
+        {
+            categoryMap[WORDS[i]] = CATEGORIES[i % countOf(CATEGORIES)];
+        }
+        while (categoryMap.size() < keywords)
+        {
+            std::string keyword;
+            std::size_t length = 4 + static_cast<std::size_t>(random() % 9);
+            for (std::size_t i = 0; i < length; ++i)
+            {
+                keyword += static_cast<char>('a' + random() % 26);
+            }
+            categoryMap[keyword] = CATEGORIES[random() % countOf(CATEGORIES)];
+        }
+        return categoryMap;
+    }
+
+    std::string makeCategoryCsv(const std::map<std::string, std::string> &categoryMap)
+    {
+        std::string csv;
+        for (const auto &[keyword, category] : categoryMap)
+        {
+            csv += keyword + "," + category + "\n";
+        }
+        return csv;
+    }
+
+    std::string makeValuesResponse(const std::vector<sheet::Transaction> &transactions)
+    {
+        std::string body = R"({"range":"Transactions!A2:F","majorDimension":"ROWS","values":[)";
+        char serial[32];
+        for (std::size_t i = 0; i < transactions.size(); ++i)
+        {
+            const sheet::Transaction &transaction = transactions[i];
+            // Sheets serial date: days since 1899-12-30, with the time as the fraction
+            auto minutes = std::chrono::duration_cast<std::chrono::minutes>(
+                               transaction.date.time_since_epoch())
+                               .count();
+            std::snprintf(serial, sizeof(serial), "%.10g",
+                          25569.0 + static_cast<double>(minutes) / (24.0 * 60.0));
+
+            body += i == 0 ? "[\"" : ",[\"";
+            body += transaction.account + "\",\"" + transaction.subject + "\"," + serial + "," +
+                    std::to_string(transaction.amount) + ",\"" + transaction.currency + "\"";
+            // Like Sheets, trailing empty cells are left out
+            if (!transaction.category.empty())
+            {
+                body += ",\"" + transaction.category + "\"";
+            }
+            body += "]";
+        }
+        body += "]}";
+        return body;
+    }
+}  // namespace bench
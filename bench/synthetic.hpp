@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lib/sheet.hpp"
+#include "lib/sheet/ledger.hpp"
+
+namespace bench
+{
+    // Deterministic stream of plausible transactions: a handful of accounts and currencies,
+    // subjects drawn from a fixed vocabulary, about 50 rows a day in date order, a share of
+    // them already categorized and about 1% exact duplicates of a recent row. Only the raw
+    // engine output is used, so the same seed gives the same rows on every platform.
+    class TransactionGenerator
+    {
+      public:
+        explicit TransactionGenerator(std::uint64_t seed = 1);
+
+        sheet::Transaction next();
+
+      private:
+        std::mt19937_64 m_random;
+        std::int64_t m_minutes;
+        std::vector<sheet::Transaction> m_recent;
+
+        std::size_t pick(std::size_t count);
+    };
+
+    std::vector<sheet::Transaction> makeTransactions(std::size_t rows, std::uint64_t seed = 1);
+    sheet::Ledger makeLedger(std::size_t rows, std::uint64_t seed = 1);
+    // makeLedger(rows), kept until a different size is asked for; benchmarks run one size
+    // after another, so this avoids regenerating millions of rows for every run
+    const sheet::Ledger &cachedLedger(std::size_t rows);
+
+    // keywords entries, some of which occur in the generated subjects
+    std::map<std::string, std::string> makeCategoryMap(std::size_t keywords,
+                                                       std::uint64_t seed = 1);
+    std::string makeCategoryCsv(const std::map<std::string, std::string> &categoryMap);
+
+    // The body of a values.get response for the Transactions sheet holding transactions
+    std::string makeValuesResponse(const std::vector<sheet::Transaction> &transactions);
+}  // namespace bench
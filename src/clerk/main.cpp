@@ -1,16 +1,20 @@
 #include <ctime>
-#include <fstream>
 #include <iostream>
-#include <lib/external/exec.hpp>
 #include <lib/network/requester.hpp>
+#include <lib/network/retrying_requester.hpp>
 #include <memory>
 #include <nlohmann/json.hpp>
 
+#include "lib/auth/static_provider.hpp"
 #include "lib/network/http_server.hpp"
 #include "lib/sheet/client.hpp"
+#include "lib/sheet/write_queue.hpp"
 
 std::string sheetId;
 std::string password;
+std::shared_ptr<network::RequesterInterface> requester;
+std::shared_ptr<auth::TokenProviderInterface> tokenProvider;
+std::unique_ptr<sheet::WriteBehindQueue> writeQueue;
 
 namespace sheet
 {
@@ -35,31 +39,7 @@ auto handler = [](const std::string &path, const std::string &method,
 
     response.code = 404;
 
-    if (method == "GET")
-    {
-        if (path == "/")
-        {
-            std::ifstream file("./clerk-fe/index.html");
-            if (file.is_open())
-            {
-                response.code = 200;
-                response.content = std::string((std::istreambuf_iterator<char>(file)),
-                                               std::istreambuf_iterator<char>());
-                response.type = "text/html";
-            }
-        }
-        else
-        {
-            std::ifstream file("./clerk-fe" + path);
-            if (file.is_open())
-            {
-                response.code = 200;
-                response.content = std::string((std::istreambuf_iterator<char>(file)),
-                                               std::istreambuf_iterator<char>());
-            }
-        }
-    }
-    else if (method == "POST")
+    if (method == "POST")
     {
         // ignore path
         do
@@ -79,11 +59,17 @@ auto handler = [](const std::string &path, const std::string &method,
 
             j_body.get_to(trx);
 
-            auto requester = std::make_shared<network::Requester>();
-            auto exec = std::make_shared<external::ShellExec>();
-            sheet::Client client(requester, exec);
-            client.setSheetId(sheetId);
-            client.addTransaction(trx);
+            if (writeQueue)
+            {
+                // Acknowledged once journaled; the queue appends it to the sheet later
+                writeQueue->enqueue(trx);
+            }
+            else
+            {
+                sheet::Client client(requester, tokenProvider);
+                client.setSheetId(sheetId);
+                client.addTransaction(trx);
+            }
 
             response.code = 200;
             response.content = "";
@@ -106,13 +92,44 @@ int main()
         throw std::runtime_error("PASSWORD not found in env");
     password = env_password;
 
+    // Transient Sheets failures are retried here rather than surfacing to the client
+    requester =
+        std::make_shared<network::RetryingRequester>(std::make_shared<network::Requester>());
+    // Shared by every request so the token is minted once and reused until it nears expiry
+    tokenProvider = auth::tokenProviderFromEnv(requester);
+
+    char *env_journalFile = std::getenv("CLERK_JOURNAL_FILE");
+    if (env_journalFile != nullptr && *env_journalFile != '\0')
+    {
+        auto client = std::make_shared<sheet::Client>(requester, tokenProvider);
+        client->setSheetId(sheetId);
+        writeQueue = std::make_unique<sheet::WriteBehindQueue>(client, env_journalFile);
+        writeQueue->start();
+    }
+
     auto server = std::make_shared<network::HttpServer>();
     server->setPort(8080);
     server->setRequestHandler(handler);
 
-    server->start();
-    while (server->isRunning())
+    // The frontend is served from memory; a rebuild of clerk-fe needs a restart to show up
+    auto staticFiles = std::make_shared<network::StaticFileCache>();
+    try
     {
-        server->acceptConnection();
+        std::cout << "Loaded " << staticFiles->load("./clerk-fe") << " frontend files"
+                  << std::endl;
+        server->setStaticFiles(staticFiles);
     }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Serving without frontend: " << e.what() << std::endl;
+    }
+
+    // Sheets appends (or journal syncs) go to the workers so requests on the event loop never
+    // queue behind them
+    server->setWorkerPool(4, 64);
+    server->setOffloadFilter([](const std::string &method, const std::string &)
+                             { return method == "POST"; });
+
+    server->start();
+    server->run();
 }
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+namespace auth
+{
+    class TokenProviderInterface
+    {
+      public:
+        virtual ~TokenProviderInterface() = default;
+        virtual std::string getAccessToken(const std::string &scopes) = 0;
+    };
+}  // namespace auth
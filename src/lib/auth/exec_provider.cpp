@@ -0,0 +1,30 @@
+#include "lib/auth/exec_provider.hpp"
+
+#include <stdexcept>
+
+namespace auth
+{
+    ExecTokenProvider::ExecTokenProvider(std::shared_ptr<external::ExecInterface> p_exec)
+        : mp_exec(std::move(p_exec))
+    {
+        if (mp_exec == nullptr)
+        {
+            throw std::runtime_error("exec is null");
+        }
+    }
+
+    std::string ExecTokenProvider::getAccessToken(const std::string &scopes)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_tokens.find(scopes);
+        if (it != m_tokens.end())
+        {
+            return it->second;
+        }
+
+        std::string token = mp_exec->googleOAuth(scopes);
+        m_tokens[scopes] = token;
+        return token;
+    }
+}  // namespace auth
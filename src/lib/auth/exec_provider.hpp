@@ -0,0 +1,26 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "lib/auth.hpp"
+#include "lib/external.hpp"
+
+namespace auth
+{
+    // Fetches tokens through the google-oauth2 helper binary and keeps them for the
+    // provider's lifetime, as the helper does not report an expiry
+    class ExecTokenProvider : public TokenProviderInterface
+    {
+      private:
+        std::shared_ptr<external::ExecInterface> mp_exec;
+        std::map<std::string, std::string> m_tokens;
+        std::mutex m_mutex;
+
+      public:
+        explicit ExecTokenProvider(std::shared_ptr<external::ExecInterface> p_exec);
+
+        std::string getAccessToken(const std::string &scopes) override;
+    };
+}  // namespace auth
@@ -0,0 +1,190 @@
+#include "lib/auth/service_account.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#define TOKEN_LIFETIME_SECONDS (3600)
+
+namespace auth
+{
+    static std::string base64UrlEncode(const unsigned char *data, std::size_t length)
+    {
+        static const char *alphabet =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+        std::string encoded;
+        encoded.reserve((length + 2) / 3 * 4);
+
+        std::size_t i = 0;
+        for (; i + 2 < length; i += 3)
+        {
+            unsigned int triple = (static_cast<unsigned int>(data[i]) << 16) |
+                                  (static_cast<unsigned int>(data[i + 1]) << 8) | data[i + 2];
+            encoded.push_back(alphabet[(triple >> 18) & 0x3F]);
+            encoded.push_back(alphabet[(triple >> 12) & 0x3F]);
+            encoded.push_back(alphabet[(triple >> 6) & 0x3F]);
+            encoded.push_back(alphabet[triple & 0x3F]);
+        }
+
+        // No padding in the URL-safe variant used by JWTs
+        if (i + 1 == length)
+        {
+            unsigned int single = static_cast<unsigned int>(data[i]) << 16;
+            encoded.push_back(alphabet[(single >> 18) & 0x3F]);
+            encoded.push_back(alphabet[(single >> 12) & 0x3F]);
+        }
+        else if (i + 2 == length)
+        {
+            unsigned int pair = (static_cast<unsigned int>(data[i]) << 16) |
+                                (static_cast<unsigned int>(data[i + 1]) << 8);
+            encoded.push_back(alphabet[(pair >> 18) & 0x3F]);
+            encoded.push_back(alphabet[(pair >> 12) & 0x3F]);
+            encoded.push_back(alphabet[(pair >> 6) & 0x3F]);
+        }
+
+        return encoded;
+    }
+
+    static std::string base64UrlEncode(const std::string &data)
+    {
+        return base64UrlEncode(reinterpret_cast<const unsigned char *>(data.data()), data.size());
+    }
+
+    static std::string signRs256(const std::string &privateKeyPem, const std::string &input)
+    {
+        BIO *bio = BIO_new_mem_buf(privateKeyPem.data(), static_cast<int>(privateKeyPem.size()));
+        if (bio == nullptr)
+        {
+            throw std::runtime_error("could not read private key");
+        }
+        EVP_PKEY *key = PEM_read_bio_PrivateKey(bio, nullptr, nullptr, nullptr);
+        BIO_free(bio);
+        if (key == nullptr)
+        {
+            throw std::runtime_error("could not parse private key");
+        }
+
+        EVP_MD_CTX *context = EVP_MD_CTX_new();
+        std::vector<unsigned char> signature;
+        std::size_t signatureLength = 0;
+
+        bool ok = context != nullptr &&
+                  EVP_DigestSignInit(context, nullptr, EVP_sha256(), nullptr, key) == 1 &&
+                  EVP_DigestSignUpdate(context, input.data(), input.size()) == 1 &&
+                  EVP_DigestSignFinal(context, nullptr, &signatureLength) == 1;
+        if (ok)
+        {
+            signature.resize(signatureLength);
+            ok = EVP_DigestSignFinal(context, signature.data(), &signatureLength) == 1;
+        }
+
+        EVP_MD_CTX_free(context);
+        EVP_PKEY_free(key);
+
+        if (!ok)
+        {
+            throw std::runtime_error("could not sign token assertion");
+        }
+
+        return base64UrlEncode(signature.data(), signatureLength);
+    }
+
+    std::string readServiceAccountFile()
+    {
+        const char *serviceFilePath = std::getenv("GOOGLE_APPLICATION_CREDENTIALS");
+        if (serviceFilePath == nullptr)
+        {
+            throw std::runtime_error("credentials file is unset");
+        }
+
+        std::ifstream file(serviceFilePath);
+        if (!file.is_open())
+        {
+            throw std::runtime_error(std::string("Could not open credentials file: ") +
+                                     serviceFilePath);
+        }
+
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        return buffer.str();
+    }
+
+    ServiceAccountTokenProvider::ServiceAccountTokenProvider(
+        std::shared_ptr<network::RequesterInterface> p_requester,
+        const std::string &serviceAccountJson)
+        : mp_requester(std::move(p_requester)), m_refreshMargin(std::chrono::minutes(5))
+    {
+        if (mp_requester == nullptr)
+        {
+            throw std::runtime_error("requester is null");
+        }
+
+        nlohmann::json json = nlohmann::json::parse(serviceAccountJson);
+        json.at("client_email").get_to(m_clientEmail);
+        json.at("private_key").get_to(m_privateKey);
+        m_tokenUri = json.value("token_uri", "https://oauth2.googleapis.com/token");
+    }
+
+    void ServiceAccountTokenProvider::setRefreshMargin(std::chrono::seconds margin)
+    {
+        m_refreshMargin = margin;
+    }
+
+    std::string ServiceAccountTokenProvider::getAccessToken(const std::string &scopes)
+    {
+        // Held while minting so concurrent callers wait for one refresh instead of racing
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto now = std::chrono::system_clock::now();
+        auto it = m_tokens.find(scopes);
+        if (it != m_tokens.end() && now + m_refreshMargin < it->second.expiresAt)
+        {
+            return it->second.accessToken;
+        }
+
+        CachedToken token = mintToken(scopes);
+        m_tokens[scopes] = token;
+        return token.accessToken;
+    }
+
+    ServiceAccountTokenProvider::CachedToken
+    ServiceAccountTokenProvider::mintToken(const std::string &scopes)
+    {
+        auto issuedAt = std::chrono::system_clock::now();
+        auto issuedAtSeconds =
+            std::chrono::duration_cast<std::chrono::seconds>(issuedAt.time_since_epoch()).count();
+
+        nlohmann::json header = {{"alg", "RS256"}, {"typ", "JWT"}};
+        nlohmann::json claims = {
+            {"iss", m_clientEmail},
+            {"scope", scopes},
+            {"aud", m_tokenUri},
+            {"iat", issuedAtSeconds},
+            {"exp", issuedAtSeconds + TOKEN_LIFETIME_SECONDS},
+        };
+
+        std::string signingInput = base64UrlEncode(header.dump()) + "." +
+                                   base64UrlEncode(claims.dump());
+        std::string assertion = signingInput + "." + signRs256(m_privateKey, signingInput);
+
+        std::vector<std::string> headers = {"Content-Type: application/x-www-form-urlencoded"};
+        std::string body =
+            "grant_type=urn%3Aietf%3Aparams%3Aoauth%3Agrant-type%3Ajwt-bearer&assertion=" +
+            assertion;
+
+        nlohmann::json response =
+            nlohmann::json::parse(mp_requester->postRequest(m_tokenUri, headers, body));
+
+        std::string accessToken;
+        response.at("access_token").get_to(accessToken);
+        long expiresIn = response.value("expires_in", static_cast<long>(TOKEN_LIFETIME_SECONDS));
+
+        return CachedToken{accessToken, issuedAt + std::chrono::seconds(expiresIn)};
+    }
+}  // namespace auth
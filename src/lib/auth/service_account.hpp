@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "lib/auth.hpp"
+#include "lib/network.hpp"
+
+namespace auth
+{
+    std::string readServiceAccountFile();
+
+    // Mints OAuth2 access tokens from a service account key by signing the JWT bearer
+    // assertion in-process. Tokens are cached per scope set and renewed once they get
+    // within the refresh margin of their expiry, so one instance can be shared by every
+    // sheet::Client in the process.
+    class ServiceAccountTokenProvider : public TokenProviderInterface
+    {
+      private:
+        struct CachedToken
+        {
+            std::string accessToken;
+            std::chrono::system_clock::time_point expiresAt;
+        };
+
+        std::shared_ptr<network::RequesterInterface> mp_requester;
+        std::string m_clientEmail;
+        std::string m_privateKey;
+        std::string m_tokenUri;
+        std::chrono::seconds m_refreshMargin;
+        std::map<std::string, CachedToken> m_tokens;
+        std::mutex m_mutex;
+
+        CachedToken mintToken(const std::string &scopes);
+
+      public:
+        ServiceAccountTokenProvider(std::shared_ptr<network::RequesterInterface> p_requester,
+                                    const std::string &serviceAccountJson);
+
+        void setRefreshMargin(std::chrono::seconds margin);
+        std::string getAccessToken(const std::string &scopes) override;
+    };
+}  // namespace auth
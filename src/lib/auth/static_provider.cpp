@@ -0,0 +1,34 @@
+#include "lib/auth/static_provider.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+
+#include "lib/auth/service_account.hpp"
+
+namespace auth
+{
+    StaticTokenProvider::StaticTokenProvider(std::string token) : m_token(std::move(token))
+    {
+        if (m_token.empty())
+        {
+            throw std::runtime_error("static token is empty");
+        }
+    }
+
+    std::string StaticTokenProvider::getAccessToken(const std::string &)
+    {
+        return m_token;
+    }
+
+    std::shared_ptr<TokenProviderInterface>
+    tokenProviderFromEnv(std::shared_ptr<network::RequesterInterface> p_requester)
+    {
+        const char *token = std::getenv("GOOGLE_ACCESS_TOKEN");
+        if (token != nullptr && *token != '\0')
+        {
+            return std::make_shared<StaticTokenProvider>(token);
+        }
+        return std::make_shared<ServiceAccountTokenProvider>(std::move(p_requester),
+                                                             readServiceAccountFile());
+    }
+}  // namespace auth
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "lib/auth.hpp"
+#include "lib/network.hpp"
+
+namespace auth
+{
+    // Hands out one fixed token for every scope; for servers that do not check it, such as
+    // the mock Sheets server, or a token minted elsewhere
+    class StaticTokenProvider : public TokenProviderInterface
+    {
+      private:
+        std::string m_token;
+
+      public:
+        explicit StaticTokenProvider(std::string token);
+
+        std::string getAccessToken(const std::string &scopes) override;
+    };
+
+    // A StaticTokenProvider when GOOGLE_ACCESS_TOKEN is set, otherwise a
+    // ServiceAccountTokenProvider for the GOOGLE_APPLICATION_CREDENTIALS key
+    std::shared_ptr<TokenProviderInterface>
+    tokenProviderFromEnv(std::shared_ptr<network::RequesterInterface> p_requester);
+}  // namespace auth
@@ -0,0 +1,128 @@
+#include "lib/concurrency/thread_pool.hpp"
+
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+
+namespace concurrency
+{
+    ThreadPool::ThreadPool(std::size_t threadCount, std::size_t maxQueued)
+        : m_maxQueued(maxQueued), m_stopping(false)
+    {
+        if (threadCount == 0)
+        {
+            throw std::runtime_error("thread pool needs at least one thread");
+        }
+
+        m_threads.reserve(threadCount);
+        for (std::size_t i = 0; i < threadCount; ++i)
+        {
+            m_threads.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+
+        // Queued tasks still run before the workers exit
+        for (auto &thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    bool ThreadPool::trySubmit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_maxQueued > 0 && m_queue.size() >= m_maxQueued)
+            {
+                return false;
+            }
+            m_queue.push_back(std::move(task));
+        }
+        m_condition.notify_one();
+        return true;
+    }
+
+    std::future<void> ThreadPool::submit(std::function<void()> task)
+    {
+        auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+        std::future<void> future = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.emplace_back([packaged]() { (*packaged)(); });
+        }
+        m_condition.notify_one();
+        return future;
+    }
+
+    void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)> &fn)
+    {
+        std::vector<std::future<void>> pending;
+        pending.reserve(count);
+        for (std::size_t index = 0; index < count; ++index)
+        {
+            pending.push_back(submit([&fn, index]() { fn(index); }));
+        }
+
+        // Wait for every call before rethrowing, since they may reference the caller's frame
+        std::exception_ptr firstError = nullptr;
+        for (auto &future : pending)
+        {
+            try
+            {
+                future.get();
+            }
+            catch (...)
+            {
+                if (firstError == nullptr)
+                {
+                    firstError = std::current_exception();
+                }
+            }
+        }
+        if (firstError != nullptr)
+        {
+            std::rethrow_exception(firstError);
+        }
+    }
+
+    std::size_t ThreadPool::threadCount() const
+    {
+        return m_threads.size();
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                // wait_until keeps to libstdc++ symbols older runtimes also export
+                m_condition.wait_until(lock, std::chrono::steady_clock::time_point::max(),
+                                       [this]() { return m_stopping || !m_queue.empty(); });
+                if (m_queue.empty())
+                {
+                    return;
+                }
+                task = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                // trySubmit tasks have nowhere to report failures; submit ones use the future
+            }
+        }
+    }
+}  // namespace concurrency
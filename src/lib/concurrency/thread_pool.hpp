@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace concurrency
+{
+    class ThreadPool
+    {
+      public:
+        // maxQueued of 0 leaves the queue unbounded
+        explicit ThreadPool(std::size_t threadCount, std::size_t maxQueued = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        // Returns false instead of queueing when the queue is full
+        bool trySubmit(std::function<void()> task);
+        // Always queues, regardless of the bound
+        std::future<void> submit(std::function<void()> task);
+        // Runs fn(0) .. fn(count - 1) on the pool and waits for all of them; the first
+        // failure is rethrown once every call has finished
+        void parallelFor(std::size_t count, const std::function<void(std::size_t)> &fn);
+
+        std::size_t threadCount() const;
+
+      private:
+        std::vector<std::thread> m_threads;
+        std::deque<std::function<void()>> m_queue;
+        std::size_t m_maxQueued;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_stopping;
+
+        void workerLoop();
+    };
+}  // namespace concurrency
@@ -1,17 +1,72 @@
 #pragma once
 
 #include <functional>
+#include <future>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace network
 {
+    struct Request
+    {
+        std::string method;
+        std::string url;
+        std::vector<std::string> headers;
+        std::string body;
+        // When set, a 2xx response body is handed over chunk by chunk as it arrives (on the
+        // requester's thread) instead of being collected in Response::body. Returning false
+        // aborts the transfer.
+        std::function<bool(const char *data, std::size_t length)> onData = nullptr;
+        // Safe to send twice, so a retry after an ambiguous failure cannot apply it twice.
+        // GET and PUT always are; set it for a POST that is (e.g. values:batchUpdate).
+        bool idempotent = false;
+    };
+
+    struct Response
+    {
+        long code;
+        std::string body;
+        // header names are lowercased
+        std::vector<std::pair<std::string, std::string>> headers;
+
+        std::string header(const std::string &name) const
+        {
+            for (const auto &header : headers)
+            {
+                if (header.first == name)
+                {
+                    return header.second;
+                }
+            }
+            return "";
+        }
+    };
+
     class RequesterInterface
     {
       public:
         virtual ~RequesterInterface() = default;
+
+        // Resolves with the response whatever its status code; fails only on transport errors
+        virtual std::future<Response> sendAsync(Request request) = 0;
+        virtual std::future<std::string>
+        getRequestAsync(const std::string &url, const std::vector<std::string> &headers) = 0;
+        virtual std::future<std::string> postRequestAsync(const std::string &url,
+                                                          const std::vector<std::string> &headers,
+                                                          const std::string &body) = 0;
+        virtual std::future<std::string> putRequestAsync(const std::string &url,
+                                                         const std::vector<std::string> &headers,
+                                                         const std::string &body) = 0;
+
         virtual std::string getRequest(const std::string &url,
                                        const std::vector<std::string> &headers) = 0;
+        // Blocks until the body has been passed to onChunk piece by piece as it downloads.
+        // Unlike getRequest, throws on a non-2xx status; exceptions from onChunk abort the
+        // transfer and are rethrown here.
+        virtual void getRequestStream(
+            const std::string &url, const std::vector<std::string> &headers,
+            const std::function<void(const char *data, std::size_t length)> &onChunk) = 0;
         virtual std::string postRequest(const std::string &url,
                                         const std::vector<std::string> &headers,
                                         const std::string &body) = 0;
@@ -25,6 +80,8 @@ namespace network
         int code;
         std::string content;
         std::string type;
+        // Sent as is, after Content-Type
+        std::vector<std::pair<std::string, std::string>> headers;
     };
     using RequestHandler = std::function<HttpResponse(
         const std::string &path, const std::string &method, const std::string &body)>;
@@ -39,5 +96,6 @@ namespace network
         virtual void stop() = 0;
         virtual bool isRunning() const = 0;
         virtual bool acceptConnection() = 0;
+        virtual void run() = 0;
     };
 }  // namespace network
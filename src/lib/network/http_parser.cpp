@@ -0,0 +1,486 @@
+#include "lib/network/http_parser.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+// Longest chunk-size line (hex digits plus extensions) we are willing to buffer
+#define MAX_CHUNK_LINE (1024)
+
+namespace network
+{
+    static bool equalsIgnoreCase(std::string_view a, std::string_view b)
+    {
+        return a.size() == b.size() &&
+               std::equal(a.begin(), a.end(), b.begin(),
+                          [](char x, char y)
+                          {
+                              return std::tolower(static_cast<unsigned char>(x)) ==
+                                     std::tolower(static_cast<unsigned char>(y));
+                          });
+    }
+
+    // Whether a comma-separated header value such as "keep-alive, Upgrade" has the token
+    static bool hasToken(std::string_view value, std::string_view token)
+    {
+        while (!value.empty())
+        {
+            std::size_t comma = value.find(',');
+            std::string_view item = value.substr(0, comma);
+            while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+            {
+                item.remove_prefix(1);
+            }
+            while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+            {
+                item.remove_suffix(1);
+            }
+            if (equalsIgnoreCase(item, token))
+            {
+                return true;
+            }
+            if (comma == std::string_view::npos)
+            {
+                break;
+            }
+            value.remove_prefix(comma + 1);
+        }
+        return false;
+    }
+
+    HttpRequestParser::HttpRequestParser(std::size_t maxBodySize, std::size_t maxHeaderSize)
+        : m_size(0), m_maxBodySize(maxBodySize), m_maxHeaderSize(maxHeaderSize)
+    {
+        reset();
+    }
+
+    void HttpRequestParser::setMaxBodySize(std::size_t maxBodySize)
+    {
+        m_maxBodySize = maxBodySize;
+    }
+
+    char *HttpRequestParser::prepareWrite(std::size_t length)
+    {
+        if (m_buffer.size() < m_size + length)
+        {
+            m_buffer.resize(std::max(m_buffer.size() * 2, m_size + length));
+        }
+        return &m_buffer[m_size];
+    }
+
+    void HttpRequestParser::commitWrite(std::size_t length)
+    {
+        m_size += length;
+    }
+
+    void HttpRequestParser::feed(const char *data, std::size_t length)
+    {
+        std::memcpy(prepareWrite(length), data, length);
+        commitWrite(length);
+    }
+
+    int HttpRequestParser::errorStatus() const
+    {
+        return m_errorStatus;
+    }
+
+    std::string_view HttpRequestParser::view(Span span) const
+    {
+        return std::string_view(m_buffer.data() + span.offset, span.length);
+    }
+
+    std::string_view HttpRequestParser::method() const
+    {
+        return view(m_method);
+    }
+
+    std::string_view HttpRequestParser::target() const
+    {
+        return view(m_target);
+    }
+
+    std::string_view HttpRequestParser::path() const
+    {
+        std::string_view fullTarget = target();
+        return fullTarget.substr(0, fullTarget.find('?'));
+    }
+
+    std::string_view HttpRequestParser::version() const
+    {
+        return view(m_version);
+    }
+
+    std::string_view HttpRequestParser::header(std::string_view name) const
+    {
+        for (const auto &header : m_headers)
+        {
+            if (equalsIgnoreCase(view(header.first), name))
+            {
+                return view(header.second);
+            }
+        }
+        return {};
+    }
+
+    std::string_view HttpRequestParser::body() const
+    {
+        return std::string_view(m_buffer.data() + m_bodyStart, m_bodyLength);
+    }
+
+    bool HttpRequestParser::keepAlive() const
+    {
+        std::string_view connection = header("connection");
+        if (version() == "HTTP/1.1")
+        {
+            return !hasToken(connection, "close");
+        }
+        return hasToken(connection, "keep-alive");
+    }
+
+    bool HttpRequestParser::takeContinueRequest()
+    {
+        bool waitingForBody = m_state != State::HEADERS && m_state != State::DONE &&
+                              m_state != State::FAILED;
+        if (m_continueRequested && waitingForBody)
+        {
+            m_continueRequested = false;
+            return true;
+        }
+        return false;
+    }
+
+    void HttpRequestParser::consume()
+    {
+        if (m_state == State::DONE)
+        {
+            std::memmove(&m_buffer[0], m_buffer.data() + m_cursor, m_size - m_cursor);
+            m_size -= m_cursor;
+        }
+        else
+        {
+            m_size = 0;
+        }
+        reset();
+    }
+
+    bool HttpRequestParser::hasBufferedData() const
+    {
+        return m_size > 0;
+    }
+
+    void HttpRequestParser::reset()
+    {
+        m_state = State::HEADERS;
+        m_errorStatus = 0;
+        m_scanFrom = 0;
+        m_cursor = 0;
+        m_method = Span{0, 0};
+        m_target = Span{0, 0};
+        m_version = Span{0, 0};
+        m_headers.clear();
+        m_bodyStart = 0;
+        m_bodyLength = 0;
+        m_remaining = 0;
+        m_continueRequested = false;
+    }
+
+    HttpRequestParser::Status HttpRequestParser::fail(int status)
+    {
+        m_state = State::FAILED;
+        m_errorStatus = status;
+        return Status::ERROR;
+    }
+
+    HttpRequestParser::Status HttpRequestParser::parse()
+    {
+        std::string_view data(m_buffer.data(), m_size);
+
+        while (true)
+        {
+            switch (m_state)
+            {
+                case State::HEADERS:
+                {
+                    // Stray line breaks between pipelined requests are allowed
+                    while (m_scanFrom == 0 && data.substr(0, 2) == "\r\n")
+                    {
+                        std::memmove(&m_buffer[0], m_buffer.data() + 2, m_size - 2);
+                        m_size -= 2;
+                        data = std::string_view(m_buffer.data(), m_size);
+                    }
+
+                    std::size_t headerEnd = data.find("\r\n\r\n", m_scanFrom);
+                    if (headerEnd == std::string_view::npos)
+                    {
+                        if (m_size > m_maxHeaderSize)
+                        {
+                            return fail(431);
+                        }
+                        m_scanFrom = m_size >= 3 ? m_size - 3 : 0;
+                        return Status::INCOMPLETE;
+                    }
+                    if (headerEnd + 4 > m_maxHeaderSize)
+                    {
+                        return fail(431);
+                    }
+
+                    m_cursor = headerEnd + 4;
+                    m_bodyStart = m_cursor;
+                    if (parseHeaders() == Status::ERROR)
+                    {
+                        return Status::ERROR;
+                    }
+                    break;
+                }
+
+                case State::BODY:
+                    if (m_size - m_bodyStart < m_remaining)
+                    {
+                        return Status::INCOMPLETE;
+                    }
+                    m_bodyLength = m_remaining;
+                    m_cursor = m_bodyStart + m_bodyLength;
+                    m_state = State::DONE;
+                    break;
+
+                case State::CHUNK_SIZE:
+                {
+                    Status status = parseChunkSize();
+                    if (status != Status::COMPLETE)
+                    {
+                        return status;
+                    }
+                    break;
+                }
+
+                case State::CHUNK_DATA:
+                {
+                    // Decoded data is compacted down onto the end of the body decoded so far
+                    std::size_t available = std::min(m_remaining, m_size - m_cursor);
+                    if (available > 0)
+                    {
+                        std::memmove(&m_buffer[m_bodyStart + m_bodyLength],
+                                     m_buffer.data() + m_cursor, available);
+                        m_bodyLength += available;
+                        m_cursor += available;
+                        m_remaining -= available;
+                    }
+                    if (m_remaining > 0)
+                    {
+                        return Status::INCOMPLETE;
+                    }
+                    m_state = State::CHUNK_DATA_END;
+                    break;
+                }
+
+                case State::CHUNK_DATA_END:
+                    if (m_size - m_cursor < 2)
+                    {
+                        return Status::INCOMPLETE;
+                    }
+                    if (data.substr(m_cursor, 2) != "\r\n")
+                    {
+                        return fail(400);
+                    }
+                    m_cursor += 2;
+                    m_state = State::CHUNK_SIZE;
+                    break;
+
+                case State::TRAILERS:
+                    if (!parseTrailers())
+                    {
+                        return m_state == State::FAILED ? Status::ERROR : Status::INCOMPLETE;
+                    }
+                    break;
+
+                case State::DONE:
+                    return Status::COMPLETE;
+
+                case State::FAILED:
+                    return Status::ERROR;
+            }
+        }
+    }
+
+    HttpRequestParser::Status HttpRequestParser::parseHeaders()
+    {
+        std::string_view data(m_buffer.data(), m_size);
+        std::size_t headerEnd = m_cursor - 4;
+
+        // METHOD SP TARGET SP VERSION
+        std::size_t lineEnd = data.find("\r\n");
+        std::size_t methodEnd = data.find(' ');
+        std::size_t targetEnd =
+            methodEnd < lineEnd ? data.find(' ', methodEnd + 1) : std::string_view::npos;
+        if (methodEnd == 0 || methodEnd >= lineEnd || targetEnd >= lineEnd ||
+            targetEnd == methodEnd + 1)
+        {
+            return fail(400);
+        }
+
+        m_method = Span{0, methodEnd};
+        m_target = Span{methodEnd + 1, targetEnd - methodEnd - 1};
+        m_version = Span{targetEnd + 1, lineEnd - targetEnd - 1};
+        if (version().substr(0, 7) != "HTTP/1.")
+        {
+            return fail(version().substr(0, 5) == "HTTP/" ? 505 : 400);
+        }
+
+        std::size_t lineStart = lineEnd + 2;
+        while (lineStart < headerEnd + 2)
+        {
+            lineEnd = data.find("\r\n", lineStart);
+            std::size_t colon = data.find(':', lineStart);
+            if (colon >= lineEnd || colon == lineStart)
+            {
+                return fail(400);
+            }
+
+            std::size_t valueStart = colon + 1;
+            std::size_t valueEnd = lineEnd;
+            while (valueStart < valueEnd && (data[valueStart] == ' ' || data[valueStart] == '\t'))
+            {
+                valueStart++;
+            }
+            while (valueEnd > valueStart &&
+                   (data[valueEnd - 1] == ' ' || data[valueEnd - 1] == '\t'))
+            {
+                valueEnd--;
+            }
+
+            m_headers.emplace_back(Span{lineStart, colon - lineStart},
+                                   Span{valueStart, valueEnd - valueStart});
+            lineStart = lineEnd + 2;
+        }
+
+        m_continueRequested = equalsIgnoreCase(header("expect"), "100-continue");
+
+        std::string_view transferEncoding = header("transfer-encoding");
+        std::string_view contentLength = header("content-length");
+
+        if (!transferEncoding.empty())
+        {
+            // chunked has to be the final coding; nothing else is supported
+            std::size_t lastComma = transferEncoding.rfind(',');
+            std::string_view lastCoding =
+                lastComma == std::string_view::npos ? transferEncoding
+                                                    : transferEncoding.substr(lastComma + 1);
+            if (!hasToken(lastCoding, "chunked") || hasToken(transferEncoding, "gzip") ||
+                hasToken(transferEncoding, "deflate") || hasToken(transferEncoding, "compress"))
+            {
+                return fail(501);
+            }
+            if (!contentLength.empty())
+            {
+                return fail(400);
+            }
+            m_state = State::CHUNK_SIZE;
+            return Status::INCOMPLETE;
+        }
+
+        if (contentLength.empty())
+        {
+            m_state = State::DONE;
+            return Status::COMPLETE;
+        }
+
+        std::size_t length = 0;
+        for (char c : contentLength)
+        {
+            if (!std::isdigit(static_cast<unsigned char>(c)))
+            {
+                return fail(400);
+            }
+            if (length > (m_maxBodySize + 9) / 10)
+            {
+                return fail(413);
+            }
+            length = length * 10 + static_cast<std::size_t>(c - '0');
+        }
+        if (length > m_maxBodySize)
+        {
+            return fail(413);
+        }
+
+        m_remaining = length;
+        m_state = State::BODY;
+        return Status::INCOMPLETE;
+    }
+
+    HttpRequestParser::Status HttpRequestParser::parseChunkSize()
+    {
+        std::string_view data(m_buffer.data(), m_size);
+
+        std::size_t lineEnd = data.find("\r\n", m_cursor);
+        if (lineEnd == std::string_view::npos)
+        {
+            if (m_size - m_cursor > MAX_CHUNK_LINE)
+            {
+                return fail(400);
+            }
+            return Status::INCOMPLETE;
+        }
+
+        // chunk-size [ ";" chunk-ext ]
+        std::size_t chunkSize = 0;
+        std::size_t digits = 0;
+        std::size_t i = m_cursor;
+        for (; i < lineEnd && std::isxdigit(static_cast<unsigned char>(data[i])); ++i)
+        {
+            if (++digits > 15)
+            {
+                return fail(413);
+            }
+            char c = static_cast<char>(std::tolower(static_cast<unsigned char>(data[i])));
+            chunkSize = chunkSize * 16 +
+                        static_cast<std::size_t>(c <= '9' ? c - '0' : c - 'a' + 10);
+        }
+        if (digits == 0 || (i < lineEnd && data[i] != ';' && data[i] != ' ' && data[i] != '\t'))
+        {
+            return fail(400);
+        }
+
+        m_cursor = lineEnd + 2;
+        if (chunkSize == 0)
+        {
+            m_state = State::TRAILERS;
+            return Status::COMPLETE;
+        }
+
+        if (m_bodyLength + chunkSize > m_maxBodySize)
+        {
+            return fail(413);
+        }
+
+        m_remaining = chunkSize;
+        m_state = State::CHUNK_DATA;
+        return Status::COMPLETE;
+    }
+
+    bool HttpRequestParser::parseTrailers()
+    {
+        std::string_view data(m_buffer.data(), m_size);
+
+        // Trailer fields are skipped; an empty line ends the message
+        while (true)
+        {
+            std::size_t lineEnd = data.find("\r\n", m_cursor);
+            if (lineEnd == std::string_view::npos)
+            {
+                if (m_size - m_cursor > m_maxHeaderSize)
+                {
+                    fail(431);
+                }
+                return false;
+            }
+
+            bool emptyLine = lineEnd == m_cursor;
+            m_cursor = lineEnd + 2;
+            if (emptyLine)
+            {
+                m_state = State::DONE;
+                return true;
+            }
+        }
+    }
+}  // namespace network
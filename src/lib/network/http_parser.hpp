@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace network
+{
+    // Incremental HTTP/1.x request parser over a growable per-connection buffer.
+    //
+    // Bytes are written straight into the buffer (prepareWrite/commitWrite) and parse()
+    // advances a state machine over whatever has arrived, so a request split across any
+    // number of reads is handled without rescanning. Chunked bodies are decoded in place.
+    // Accessors return views into the buffer; they stay valid until the next write or
+    // consume().
+    class HttpRequestParser
+    {
+      public:
+        enum class Status
+        {
+            INCOMPLETE,
+            COMPLETE,
+            ERROR,
+        };
+
+        explicit HttpRequestParser(std::size_t maxBodySize = 1024 * 1024,
+                                   std::size_t maxHeaderSize = 64 * 1024);
+
+        void setMaxBodySize(std::size_t maxBodySize);
+
+        char *prepareWrite(std::size_t length);
+        void commitWrite(std::size_t length);
+        void feed(const char *data, std::size_t length);
+
+        Status parse();
+        // Status code to answer with after parse() returned ERROR
+        int errorStatus() const;
+
+        std::string_view method() const;
+        std::string_view target() const;
+        // Target without the query string
+        std::string_view path() const;
+        std::string_view version() const;
+        // Case-insensitive lookup; empty when absent
+        std::string_view header(std::string_view name) const;
+        std::string_view body() const;
+        bool keepAlive() const;
+
+        // True once, when the headers asked for "Expect: 100-continue" and the body has not
+        // arrived yet
+        bool takeContinueRequest();
+
+        // Drops the completed request, keeping any pipelined bytes after it
+        void consume();
+        bool hasBufferedData() const;
+
+      private:
+        enum class State
+        {
+            HEADERS,
+            BODY,
+            CHUNK_SIZE,
+            CHUNK_DATA,
+            CHUNK_DATA_END,
+            TRAILERS,
+            DONE,
+            FAILED,
+        };
+
+        struct Span
+        {
+            std::size_t offset;
+            std::size_t length;
+        };
+
+        std::string m_buffer;
+        std::size_t m_size;
+        std::size_t m_maxBodySize;
+        std::size_t m_maxHeaderSize;
+
+        State m_state;
+        int m_errorStatus;
+        std::size_t m_scanFrom;
+        std::size_t m_cursor;
+        Span m_method;
+        Span m_target;
+        Span m_version;
+        std::vector<std::pair<Span, Span>> m_headers;
+        std::size_t m_bodyStart;
+        std::size_t m_bodyLength;
+        std::size_t m_remaining;
+        bool m_continueRequested;
+
+        std::string_view view(Span span) const;
+        Status fail(int status);
+        Status parseHeaders();
+        Status parseChunkSize();
+        bool parseTrailers();
+        void reset();
+    };
+}  // namespace network
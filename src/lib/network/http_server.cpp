@@ -1,21 +1,127 @@
 #include "http_server.hpp"
 
+#include <algorithm>
 #include <arpa/inet.h>
+#include <array>
+#include <cerrno>
 #include <cstring>
-#include <fstream>
+#include <fcntl.h>
 #include <iostream>
 #include <netinet/tcp.h>
 #include <sstream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#define MAX_EVENTS (64)
+#define EVENT_LOOP_TICK_MS (1000)
+#define READ_CHUNK_SIZE (16384)
+
 namespace network
 {
-    HttpServer::HttpServer() : port_(8080), serverSocket_(-1), running_(false), handler_(nullptr) {}
+    struct HttpConnection
+    {
+        int fd;
+        std::uint64_t id;
+        HttpRequestParser parser;
+        // A request of this connection is with a worker; later pipelined ones wait for it
+        bool busy = false;
+        std::string output;
+        std::size_t outputOffset = 0;
+        bool closeAfterWrite = false;
+        bool waitingForWrite = false;
+        // The client shut down its side; what is buffered still gets answered
+        bool peerClosed = false;
+        // Events the descriptor is registered for with epoll
+        std::uint32_t events = EPOLLIN;
+        // Body of a static response, sent from the cache after output; views and descriptors
+        // belong to the StaticFileCache
+        std::string_view staticBody;
+        int staticFd = -1;
+        off_t staticOffset = 0;
+        std::size_t staticRemaining = 0;
+        std::chrono::steady_clock::time_point lastActivity;
+    };
+
+    static bool hasStaticBody(const HttpConnection &connection)
+    {
+        return !connection.staticBody.empty() || connection.staticRemaining > 0;
+    }
+
+    // Reading pauses while input could only pile up unparsed: a request is with a worker, a
+    // static body is going out, or the connection is about to close
+    static bool wantsInput(const HttpConnection &connection)
+    {
+        return !connection.peerClosed && !connection.busy && !connection.closeAfterWrite &&
+               !hasStaticBody(connection);
+    }
+
+    struct CompletedResponse
+    {
+        int fd;
+        std::uint64_t connectionId;
+        std::string response;
+        bool keepAlive;
+    };
+
+    static const char *reasonPhrase(int statusCode)
+    {
+        switch (statusCode)
+        {
+            case 200:
+                return "OK";
+            case 204:
+                return "No Content";
+            case 304:
+                return "Not Modified";
+            case 400:
+                return "Bad Request";
+            case 401:
+                return "Unauthorized";
+            case 404:
+                return "Not Found";
+            case 408:
+                return "Request Timeout";
+            case 413:
+                return "Payload Too Large";
+            case 429:
+                return "Too Many Requests";
+            case 431:
+                return "Request Header Fields Too Large";
+            case 500:
+                return "Internal Server Error";
+            case 501:
+                return "Not Implemented";
+            case 502:
+                return "Bad Gateway";
+            case 503:
+                return "Service Unavailable";
+            case 505:
+                return "HTTP Version Not Supported";
+            default:
+                return "Unknown";
+        }
+    }
+
+    HttpServer::HttpServer()
+        : port_(8080), serverSocket_(-1), epollFd_(-1), wakeFd_(-1), running_(false),
+          listenerClaimed_(false), handler_(nullptr), readTimeout_(std::chrono::seconds(15)),
+          writeTimeout_(std::chrono::seconds(15)), nextConnectionId_(0), workerCount_(0),
+          maxQueued_(0), offloadFilter_(nullptr), maxBodySize_(1024 * 1024)
+    {
+    }
 
     HttpServer::~HttpServer()
     {
         HttpServer::stop();
+        if (wakeFd_ >= 0)
+        {
+            close(wakeFd_);
+            wakeFd_ = -1;
+        }
     }
 
     void HttpServer::setPort(int port)
@@ -28,6 +134,35 @@ namespace network
         handler_ = handler;
     }
 
+    void HttpServer::setTimeouts(std::chrono::milliseconds readTimeout,
+                                 std::chrono::milliseconds writeTimeout)
+    {
+        readTimeout_ = readTimeout;
+        writeTimeout_ = writeTimeout;
+    }
+
+    void HttpServer::setMaxBodySize(std::size_t maxBodySize)
+    {
+        maxBodySize_ = maxBodySize;
+    }
+
+    void HttpServer::setStaticFiles(std::shared_ptr<const StaticFileCache> staticFiles)
+    {
+        staticFiles_ = std::move(staticFiles);
+    }
+
+    void HttpServer::setWorkerPool(std::size_t workerCount, std::size_t maxQueued)
+    {
+        workerCount_ = workerCount;
+        maxQueued_ = maxQueued;
+    }
+
+    void HttpServer::setOffloadFilter(
+        std::function<bool(const std::string &method, const std::string &path)> filter)
+    {
+        offloadFilter_ = std::move(filter);
+    }
+
     void HttpServer::start()
     {
         if (!handler_)
@@ -35,7 +170,7 @@ namespace network
             throw std::runtime_error("handler is unset");
         }
 
-        serverSocket_ = socket(AF_INET, SOCK_STREAM, 0);
+        serverSocket_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
         if (serverSocket_ < 0)
         {
             throw std::runtime_error("error creating socket");
@@ -69,6 +204,14 @@ namespace network
             throw std::runtime_error("error binding socket to port");
         }
 
+        // Port 0 picks a free port; report the one actually bound
+        socklen_t addrLen = sizeof(serverAddr);
+        if (getsockname(serverSocket_, reinterpret_cast<struct sockaddr *>(&serverAddr),
+                        &addrLen) == 0)
+        {
+            port_ = ntohs(serverAddr.sin_port);
+        }
+
         if (listen(serverSocket_, SOMAXCONN) < 0)
         {
             close(serverSocket_);
@@ -76,18 +219,39 @@ namespace network
             throw std::runtime_error("error listening on socket");
         }
 
+        if (wakeFd_ < 0)
+        {
+            wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (wakeFd_ < 0)
+            {
+                close(serverSocket_);
+                serverSocket_ = -1;
+                throw std::runtime_error("error creating wake descriptor");
+            }
+        }
+
+        listenerClaimed_ = false;
         running_ = true;
         std::cout << "HTTP Server listening on port " << port_ << std::endl;
     }
 
     void HttpServer::stop()
     {
-        if (serverSocket_ >= 0)
+        if (running_.exchange(false))
+        {
+            uint64_t one = 1;
+            if (write(wakeFd_, &one, sizeof(one)) < 0)
+            {
+                std::cerr << "Error waking event loop" << std::endl;
+            }
+        }
+
+        // An event loop that got there first closes the sockets on its way out
+        if (!listenerClaimed_.exchange(true) && serverSocket_ >= 0)
         {
             close(serverSocket_);
             serverSocket_ = -1;
         }
-        running_ = false;
     }
 
     bool HttpServer::isRunning() const
@@ -95,60 +259,72 @@ namespace network
         return running_;
     }
 
-    void HttpServer::parseHttpRequest(const std::string &rawRequest, std::string &path,
-                                      std::string &method, std::string &body)
+    int HttpServer::port() const
     {
-        // Find the separator between headers and body
-        size_t bodyStart = rawRequest.find("\r\n\r\n");
-        std::string headerSection = rawRequest;
-        body = "";
+        return port_;
+    }
 
-        if (bodyStart != std::string::npos)
+    std::string
+    HttpServer::buildHttpResponse(int statusCode, const std::string &contentType,
+                                  const std::string &body, bool keepAlive,
+                                  const std::vector<std::pair<std::string, std::string>> &headers)
+    {
+        std::ostringstream response;
+        response << "HTTP/1.1 " << statusCode << " " << reasonPhrase(statusCode) << "\r\n";
+        if (!contentType.empty())
         {
-            headerSection = rawRequest.substr(0, bodyStart);
-            bodyStart += 4;  // Skip past "\r\n\r\n"
-            if (bodyStart < rawRequest.length())
-            {
-                body = rawRequest.substr(bodyStart);
-            }
+            response << "Content-Type: " << contentType << "\r\n";
         }
+        for (const auto &header : headers)
+        {
+            response << header.first << ": " << header.second << "\r\n";
+        }
+        response << "Content-Length: " << body.length() << "\r\n";
+        response << (keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n");
+        response << "\r\n";
+        response << body;
 
-        std::istringstream stream(headerSection);
-        std::string firstLine;
-        std::getline(stream, firstLine);
-
-        // METHOD PATH HTTP/VERSION
-        std::istringstream lineStream(firstLine);
-        path = "/";
-
-        lineStream >> method >> path;
+        return response.str();
+    }
 
-        // ignore query parameters
-        size_t queryPos = path.find('?');
-        if (queryPos != std::string::npos)
+    std::string HttpServer::respond(const std::string &path, const std::string &method,
+                                    const std::string &body, bool keepAlive)
+    {
+        HttpResponse response;
+        try
         {
-            path = path.substr(0, queryPos);
+            response = handler_(path, method, body);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Handler error: " << e.what() << std::endl;
+            return buildHttpResponse(500, "", "", keepAlive);
         }
 
-        if (path.empty())
+        std::string contentType = response.type;
+        if (contentType.empty())
         {
-            path = "/";
+            if (path.find(".html") != std::string::npos)
+            {
+                contentType = "text/html";
+            }
+            else if (path.find(".css") != std::string::npos)
+            {
+                contentType = "text/css";
+            }
+            else if (path.find(".js") != std::string::npos)
+            {
+                contentType = "application/javascript";
+            }
         }
-    }
 
-    std::string HttpServer::buildHttpResponse(const std::string &statusCode,
-                                              const std::string &contentType,
-                                              const std::string &body)
-    {
-        std::ostringstream response;
-        response << "HTTP/1.1 " << statusCode << "\r\n";
-        response << "Content-Type: " << contentType << "\r\n";
-        response << "Content-Length: " << body.length() << "\r\n";
-        response << "Connection: close\r\n";
-        response << "\r\n";
-        response << body;
+        if (response.code == 404 && response.content.empty())
+        {
+            return buildHttpResponse(404, "text/html", "<h1>404 Not Found</h1>", keepAlive);
+        }
 
-        return response.str();
+        return buildHttpResponse(response.code, contentType, response.content, keepAlive,
+                                 response.headers);
     }
 
     bool HttpServer::acceptConnection()
@@ -169,60 +345,589 @@ namespace network
             return false;
         }
 
-        char buffer[4096] = {0};
-        ssize_t bytesReceived = recv(clientSocket, buffer, sizeof(buffer) - 1, 0);
+        HttpRequestParser parser(maxBodySize_);
+        HttpRequestParser::Status status = HttpRequestParser::Status::INCOMPLETE;
+        while (status == HttpRequestParser::Status::INCOMPLETE)
+        {
+            char *buffer = parser.prepareWrite(READ_CHUNK_SIZE);
+            ssize_t bytesReceived = recv(clientSocket, buffer, READ_CHUNK_SIZE, 0);
+            if (bytesReceived <= 0)
+            {
+                break;
+            }
+            parser.commitWrite(static_cast<std::size_t>(bytesReceived));
+            status = parser.parse();
+
+            if (parser.takeContinueRequest())
+            {
+                std::string interim = "HTTP/1.1 100 Continue\r\n\r\n";
+                send(clientSocket, interim.c_str(), interim.length(), MSG_NOSIGNAL);
+            }
+        }
+
+        std::string httpResponse;
+        StaticReply staticReply;
+        bool isStatic = status == HttpRequestParser::Status::COMPLETE && staticFiles_ &&
+                        (parser.method() == "GET" || parser.method() == "HEAD") &&
+                        staticFiles_->lookup(parser.path(), parser.header("accept-encoding"),
+                                             parser.header("if-none-match"), staticReply);
+        if (isStatic)
+        {
+            httpResponse = staticReply.head + "Connection: close\r\n\r\n";
+            if (parser.method() == "GET")
+            {
+                httpResponse.append(staticReply.body);
+            }
+            else
+            {
+                staticReply.fd = -1;
+            }
+        }
+        else if (status == HttpRequestParser::Status::COMPLETE)
+        {
+            std::string path(parser.path());
+            if (path.empty())
+            {
+                path = "/";
+            }
+            httpResponse =
+                respond(path, std::string(parser.method()), std::string(parser.body()), false);
+        }
+        else if (status == HttpRequestParser::Status::ERROR)
+        {
+            httpResponse = buildHttpResponse(parser.errorStatus(), "", "", false);
+        }
+
+        if (!httpResponse.empty())
+        {
+            send(clientSocket, httpResponse.c_str(), httpResponse.length(), MSG_NOSIGNAL);
+        }
+        if (isStatic && staticReply.fd >= 0)
+        {
+            off_t offset = 0;
+            while (static_cast<std::size_t>(offset) < staticReply.length)
+            {
+                if (sendfile(clientSocket, staticReply.fd, &offset,
+                             staticReply.length - static_cast<std::size_t>(offset)) <= 0)
+                {
+                    break;
+                }
+            }
+        }
+
+        close(clientSocket);
+        return true;
+    }
+
+    void HttpServer::run()
+    {
+        // Already stopped, and stop() has closed the listening socket
+        if (listenerClaimed_.exchange(true))
+        {
+            return;
+        }
+        if (serverSocket_ < 0)
+        {
+            throw std::runtime_error("server is not started");
+        }
+
+        int flags = fcntl(serverSocket_, F_GETFL, 0);
+        fcntl(serverSocket_, F_SETFL, flags | O_NONBLOCK);
 
-        if (bytesReceived > 0)
+        epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd_ < 0)
         {
-            buffer[bytesReceived] = '\0';
-            std::string rawRequest(buffer);
+            throw std::runtime_error("error creating epoll instance");
+        }
+
+        epoll_event listenEvent{};
+        listenEvent.events = EPOLLIN;
+        listenEvent.data.fd = serverSocket_;
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, serverSocket_, &listenEvent);
 
-            std::string method;
-            std::string path;
-            std::string body;
-            parseHttpRequest(rawRequest, path, method, body);
+        epoll_event wakeEvent{};
+        wakeEvent.events = EPOLLIN;
+        wakeEvent.data.fd = wakeFd_;
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &wakeEvent);
+
+        if (workerCount_ > 0)
+        {
+            workers_ = std::make_unique<concurrency::ThreadPool>(workerCount_, maxQueued_);
+        }
 
-            HttpResponse response = handler_(path, method, body);
-            std::string responseBody = response.content;
-            std::string contentType = response.type;
+        std::array<epoll_event, MAX_EVENTS> events{};
+        while (running_)
+        {
+            int ready = epoll_wait(epollFd_, events.data(), MAX_EVENTS, EVENT_LOOP_TICK_MS);
+            if (ready < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                std::cerr << "Error waiting for events" << std::endl;
+                break;
+            }
 
-            if (contentType.empty())
+            for (int i = 0; i < ready; ++i)
             {
-                if (path.find(".html") != std::string::npos)
+                const epoll_event &event = events.at(static_cast<std::size_t>(i));
+                int fd = event.data.fd;
+
+                if (fd == serverSocket_)
                 {
-                    contentType = "text/html";
+                    acceptPending();
+                    continue;
                 }
-                else if (path.find(".css") != std::string::npos)
+
+                if (fd == wakeFd_)
                 {
-                    contentType = "text/css";
+                    uint64_t count = 0;
+                    while (read(wakeFd_, &count, sizeof(count)) > 0)
+                    {
+                    }
+                    collectCompleted();
+                    continue;
                 }
-                else if (path.find(".js") != std::string::npos)
+
+                auto it = connections_.find(fd);
+                if (it == connections_.end())
                 {
-                    contentType = "application/javascript";
+                    continue;
+                }
+
+                if (event.events & (EPOLLERR | EPOLLHUP))
+                {
+                    closeConnection(fd);
+                    continue;
+                }
+                if (event.events & EPOLLIN)
+                {
+                    readFrom(*it->second);
+                }
+                // readFrom may have closed the connection. Writing goes through processInput so
+                // requests held back by a static body resume once it has been sent
+                it = connections_.find(fd);
+                if (it != connections_.end() && (event.events & EPOLLOUT))
+                {
+                    processInput(*it->second);
                 }
             }
 
-            // Build and send response
-            std::string httpResponse;
-            if (response.code == 404)
+            closeIdleConnections();
+        }
+
+        // Let in-flight handlers finish; their responses have nowhere to go any more
+        workers_.reset();
+        completed_.clear();
+
+        while (!connections_.empty())
+        {
+            closeConnection(connections_.begin()->first);
+        }
+        close(epollFd_);
+        epollFd_ = -1;
+        close(serverSocket_);
+        serverSocket_ = -1;
+    }
+
+    void HttpServer::acceptPending()
+    {
+        while (true)
+        {
+            int clientSocket =
+                accept4(serverSocket_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (clientSocket < 0)
             {
-                httpResponse =
-                    buildHttpResponse("404 Not Found", "text/html", "<h1>404 Not Found</h1>");
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                {
+                    std::cerr << "Error accepting connection" << std::endl;
+                }
+                return;
             }
-            else if (response.code == 401)
+
+            auto connection = std::make_unique<HttpConnection>();
+            connection->fd = clientSocket;
+            connection->id = nextConnectionId_++;
+            connection->parser.setMaxBodySize(maxBodySize_);
+            connection->lastActivity = std::chrono::steady_clock::now();
+
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = clientSocket;
+            if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, clientSocket, &event) < 0)
             {
-                httpResponse = buildHttpResponse("401 Unauthorized", "", "");
+                close(clientSocket);
+                continue;
+            }
+
+            connections_[clientSocket] = std::move(connection);
+        }
+    }
+
+    void HttpServer::readFrom(HttpConnection &connection)
+    {
+        int fd = connection.fd;
+        std::uint64_t id = connection.id;
+        auto stillOpen = [this, fd, id]()
+        {
+            auto it = connections_.find(fd);
+            return it != connections_.end() && it->second->id == id;
+        };
+
+        // Input is parsed chunk by chunk, so the parser's size limits apply as bytes arrive
+        while (wantsInput(connection))
+        {
+            char *buffer = connection.parser.prepareWrite(READ_CHUNK_SIZE);
+            ssize_t bytesReceived = recv(fd, buffer, READ_CHUNK_SIZE, 0);
+            if (bytesReceived > 0)
+            {
+                connection.parser.commitWrite(static_cast<std::size_t>(bytesReceived));
+                connection.lastActivity = std::chrono::steady_clock::now();
+                processInput(connection);
+                if (!stillOpen())
+                {
+                    return;
+                }
+                continue;
+            }
+
+            if (bytesReceived == 0)
+            {
+                // A half-close still expects answers to the requests sent before it
+                connection.peerClosed = true;
+                processInput(connection);
+                if (!stillOpen())
+                {
+                    return;
+                }
+                break;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                break;
+            }
+            if (errno != EINTR)
+            {
+                closeConnection(fd);
+                return;
+            }
+        }
+
+        updateEvents(connection);
+    }
+
+    void HttpServer::updateEvents(HttpConnection &connection)
+    {
+        std::uint32_t events = (wantsInput(connection) ? EPOLLIN : 0u) |
+                               (connection.waitingForWrite ? EPOLLOUT : 0u);
+        if (events == connection.events)
+        {
+            return;
+        }
+
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = connection.fd;
+        epoll_ctl(epollFd_, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.events = events;
+    }
+
+    void HttpServer::processInput(HttpConnection &connection)
+    {
+        while (true)
+        {
+            // Pipelined requests are answered in order, each appended to the output buffer. A
+            // static body is sent straight from the cache after it, so parsing pauses until
+            // that body is out
+            while (!connection.closeAfterWrite && !connection.busy && !hasStaticBody(connection))
+            {
+                HttpRequestParser &parser = connection.parser;
+                HttpRequestParser::Status status = parser.parse();
+
+                if (status == HttpRequestParser::Status::INCOMPLETE)
+                {
+                    if (parser.takeContinueRequest())
+                    {
+                        connection.output += "HTTP/1.1 100 Continue\r\n\r\n";
+                    }
+                    break;
+                }
+
+                if (status == HttpRequestParser::Status::ERROR)
+                {
+                    connection.output += buildHttpResponse(parser.errorStatus(), "", "", false);
+                    connection.closeAfterWrite = true;
+                    break;
+                }
+
+                if (serveStatic(connection))
+                {
+                    continue;
+                }
+
+                std::string path(parser.path());
+                if (path.empty())
+                {
+                    path = "/";
+                }
+                std::string method(parser.method());
+                std::string body(parser.body());
+                bool keepAlive = parser.keepAlive();
+                parser.consume();
+
+                dispatch(connection, path, method, body, keepAlive);
+            }
+
+            bool sendingStatic = hasStaticBody(connection);
+            if (!writeTo(connection))
+            {
+                return;
+            }
+            // Go back for pipelined requests if a static body has just been sent in full
+            if (sendingStatic && !hasStaticBody(connection))
+            {
+                continue;
+            }
+
+            // Nothing more will arrive after a half-close, and everything answerable is out
+            if (connection.peerClosed && !connection.busy && !connection.waitingForWrite)
+            {
+                closeConnection(connection.fd);
+                return;
+            }
+            updateEvents(connection);
+            return;
+        }
+    }
+
+    bool HttpServer::serveStatic(HttpConnection &connection)
+    {
+        HttpRequestParser &parser = connection.parser;
+        bool headOnly = parser.method() == "HEAD";
+        if (!staticFiles_ || (parser.method() != "GET" && !headOnly))
+        {
+            return false;
+        }
+
+        StaticReply reply;
+        if (!staticFiles_->lookup(parser.path(), parser.header("accept-encoding"),
+                                  parser.header("if-none-match"), reply))
+        {
+            return false;
+        }
+
+        bool keepAlive = parser.keepAlive();
+        parser.consume();
+
+        connection.output += reply.head;
+        connection.output +=
+            keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        connection.closeAfterWrite = !keepAlive;
+        if (headOnly)
+        {
+            return true;
+        }
+
+        if (reply.fd >= 0)
+        {
+            connection.staticFd = reply.fd;
+            connection.staticOffset = reply.offset;
+            connection.staticRemaining = reply.length;
+        }
+        else
+        {
+            connection.staticBody = reply.body;
+        }
+        return true;
+    }
+
+    void HttpServer::dispatch(HttpConnection &connection, const std::string &path,
+                              const std::string &method, const std::string &body, bool keepAlive)
+    {
+        bool offload = workers_ != nullptr && (!offloadFilter_ || offloadFilter_(method, path));
+        if (!offload)
+        {
+            connection.output += respond(path, method, body, keepAlive);
+            connection.closeAfterWrite = !keepAlive;
+            return;
+        }
+
+        int fd = connection.fd;
+        std::uint64_t connectionId = connection.id;
+        bool queued = workers_->trySubmit(
+            [this, fd, connectionId, path, method, body, keepAlive]()
+            {
+                std::string response = respond(path, method, body, keepAlive);
+                {
+                    std::lock_guard<std::mutex> lock(completedMutex_);
+                    completed_.push_back(
+                        CompletedResponse{fd, connectionId, std::move(response), keepAlive});
+                }
+
+                uint64_t one = 1;
+                if (write(wakeFd_, &one, sizeof(one)) < 0)
+                {
+                    std::cerr << "Error waking event loop" << std::endl;
+                }
+            });
+
+        if (!queued)
+        {
+            connection.output += buildHttpResponse(503, "", "", keepAlive);
+            connection.closeAfterWrite = !keepAlive;
+            return;
+        }
+
+        connection.busy = true;
+    }
+
+    void HttpServer::collectCompleted()
+    {
+        std::vector<CompletedResponse> completed;
+        {
+            std::lock_guard<std::mutex> lock(completedMutex_);
+            completed.swap(completed_);
+        }
+
+        for (auto &entry : completed)
+        {
+            // The connection may have been closed, and its descriptor reused, meanwhile
+            auto it = connections_.find(entry.fd);
+            if (it == connections_.end() || it->second->id != entry.connectionId)
+            {
+                continue;
+            }
+
+            HttpConnection &connection = *it->second;
+            connection.output += entry.response;
+            connection.closeAfterWrite = !entry.keepAlive;
+            connection.busy = false;
+            connection.lastActivity = std::chrono::steady_clock::now();
+            processInput(connection);
+        }
+    }
+
+    bool HttpServer::writeTo(HttpConnection &connection)
+    {
+        while (true)
+        {
+            std::size_t outputLeft = connection.output.size() - connection.outputOffset;
+            bool sendingFile = outputLeft == 0 && connection.staticRemaining > 0;
+
+            ssize_t bytesSent;
+            if (sendingFile)
+            {
+                bytesSent = sendfile(connection.fd, connection.staticFd, &connection.staticOffset,
+                                     connection.staticRemaining);
+            }
+            else if (outputLeft > 0 || !connection.staticBody.empty())
+            {
+                // Headers and a cached body leave in one call without being copied together
+                std::array<iovec, 2> iov{};
+                std::size_t count = 0;
+                if (outputLeft > 0)
+                {
+                    iov[count++] = {connection.output.data() + connection.outputOffset, outputLeft};
+                }
+                if (!connection.staticBody.empty())
+                {
+                    iov[count++] = {const_cast<char *>(connection.staticBody.data()),
+                                    connection.staticBody.size()};
+                }
+
+                msghdr message{};
+                message.msg_iov = iov.data();
+                message.msg_iovlen = count;
+                bytesSent = sendmsg(connection.fd, &message, MSG_NOSIGNAL);
             }
             else
             {
-                httpResponse = buildHttpResponse("200 OK", contentType, responseBody);
+                break;
+            }
+
+            if (bytesSent < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    connection.waitingForWrite = true;
+                    updateEvents(connection);
+                    return true;
+                }
+                closeConnection(connection.fd);
+                return false;
             }
 
-            send(clientSocket, httpResponse.c_str(), httpResponse.length(), 0);
+            std::size_t sent = static_cast<std::size_t>(bytesSent);
+            if (sendingFile)
+            {
+                // The file shrank on disk; the promised Content-Length can no longer be met
+                if (sent == 0)
+                {
+                    closeConnection(connection.fd);
+                    return false;
+                }
+                connection.staticRemaining -= sent;
+            }
+            else
+            {
+                std::size_t fromOutput = std::min(sent, outputLeft);
+                connection.outputOffset += fromOutput;
+                connection.staticBody.remove_prefix(sent - fromOutput);
+            }
+            connection.lastActivity = std::chrono::steady_clock::now();
         }
 
-        close(clientSocket);
+        connection.output.clear();
+        connection.outputOffset = 0;
+        connection.staticFd = -1;
+
+        if (connection.closeAfterWrite)
+        {
+            closeConnection(connection.fd);
+            return false;
+        }
+
+        connection.waitingForWrite = false;
+        updateEvents(connection);
         return true;
     }
 
+    void HttpServer::closeConnection(int fd)
+    {
+        epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections_.erase(fd);
+    }
+
+    void HttpServer::closeIdleConnections()
+    {
+        auto now = std::chrono::steady_clock::now();
+
+        std::vector<int> expired;
+        for (const auto &entry : connections_)
+        {
+            const HttpConnection &connection = *entry.second;
+            if (connection.busy)
+            {
+                continue;
+            }
+            bool writing = !connection.output.empty() || hasStaticBody(connection);
+            auto timeout = writing ? writeTimeout_ : readTimeout_;
+            if (now - connection.lastActivity > timeout)
+            {
+                expired.push_back(entry.first);
+            }
+        }
+
+        for (int fd : expired)
+        {
+            closeConnection(fd);
+        }
+    }
 }  // namespace network
@@ -1,6 +1,17 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/concurrency/thread_pool.hpp"
 #include "lib/network.hpp"
+#include "lib/network/http_parser.hpp"
+#include "lib/network/static_files.hpp"
 
 namespace network
 {
@@ -12,21 +23,75 @@ namespace network
 
         void setPort(int port) override;
         void setRequestHandler(RequestHandler handler) override;
+        void setTimeouts(std::chrono::milliseconds readTimeout,
+                         std::chrono::milliseconds writeTimeout);
+
+        // Larger request bodies are answered with 413
+        void setMaxBodySize(std::size_t maxBodySize);
+
+        // GET and HEAD requests for files in the cache are answered from it on the event loop
+        // thread; everything else goes to the request handler
+        void setStaticFiles(std::shared_ptr<const StaticFileCache> staticFiles);
+
+        // Hands requests to a pool of worker threads in run(); requests arriving while
+        // maxQueued are already waiting get a 503. The filter picks which requests go to the
+        // pool, the rest run on the event loop thread (default: all of them go to the pool).
+        void setWorkerPool(std::size_t workerCount, std::size_t maxQueued);
+        void setOffloadFilter(
+            std::function<bool(const std::string &method, const std::string &path)> filter);
 
         void start() override;
         void stop() override;
         bool isRunning() const override;
+        // The bound port once started, also when setPort(0) let the system pick it
+        int port() const;
         bool acceptConnection() override;
 
+        // Serves every connection from one thread with epoll until stop() is called
+        void run() override;
+
       private:
         int port_;
         int serverSocket_;
-        bool running_;
+        int epollFd_;
+        int wakeFd_;
+        std::atomic<bool> running_;
+        // Set by whichever of run() and stop() takes over the listening socket first; the
+        // other one leaves it alone
+        std::atomic<bool> listenerClaimed_;
         RequestHandler handler_;
+        std::chrono::milliseconds readTimeout_;
+        std::chrono::milliseconds writeTimeout_;
+        std::unordered_map<int, std::unique_ptr<struct HttpConnection>> connections_;
+        std::uint64_t nextConnectionId_;
+
+        std::size_t workerCount_;
+        std::size_t maxQueued_;
+        std::function<bool(const std::string &, const std::string &)> offloadFilter_;
+        std::unique_ptr<concurrency::ThreadPool> workers_;
+        std::mutex completedMutex_;
+        std::vector<struct CompletedResponse> completed_;
+        std::size_t maxBodySize_;
+        std::shared_ptr<const StaticFileCache> staticFiles_;
+
+        std::string buildHttpResponse(
+            int statusCode, const std::string &contentType, const std::string &body,
+            bool keepAlive,
+            const std::vector<std::pair<std::string, std::string>> &headers = {});
+        std::string respond(const std::string &path, const std::string &method,
+                            const std::string &body, bool keepAlive);
 
-        void parseHttpRequest(const std::string &rawRequest, std::string &path, std::string &method,
-                              std::string &body);
-        std::string buildHttpResponse(const std::string &statusCode, const std::string &contentType,
-                                      const std::string &body);
+        void acceptPending();
+        void readFrom(HttpConnection &connection);
+        // Registers for input only while wantsInput, and for output while a write is blocked
+        void updateEvents(HttpConnection &connection);
+        void processInput(HttpConnection &connection);
+        bool serveStatic(HttpConnection &connection);
+        bool writeTo(HttpConnection &connection);
+        void closeConnection(int fd);
+        void closeIdleConnections();
+        void dispatch(HttpConnection &connection, const std::string &path,
+                      const std::string &method, const std::string &body, bool keepAlive);
+        void collectCompleted();
     };
 }  // namespace network
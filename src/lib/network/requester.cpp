@@ -1,131 +1,492 @@
 #include "lib/network/requester.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
 #include <curl/curl.h>
-#include <sstream>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <thread>
 
-static size_t writeCallback(void *contents, size_t size, size_t nmemb, void *userp)
+// Idle easy handles kept around for reuse; anything beyond this is cleaned up
+#define MAX_IDLE_HANDLES (8)
+#define POLL_TIMEOUT_MS (1000)
+
+namespace network
 {
-    size_t real_size = size * nmemb;
+    struct Transfer
+    {
+        Request request;
+        Response response;
+        CURL *handle = nullptr;
+        struct curl_slist *headers = nullptr;
+        std::function<void(CURLcode, Response &&)> onDone;
+    };
 
-    std::stringstream *ss = static_cast<std::stringstream *>(userp);
-    ss->write(static_cast<char *>(contents), static_cast<std::streamsize>(real_size));
+    static size_t writeCallback(void *contents, size_t size, size_t nmemb, void *userp)
+    {
+        size_t real_size = size * nmemb;
 
-    return real_size;
-}
+        auto *transfer = static_cast<Transfer *>(userp);
+        if (transfer->request.onData)
+        {
+            // Error bodies are still collected so the caller can report them
+            long code = 0;
+            curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &code);
+            if (code >= 200 && code < 300)
+            {
+                return transfer->request.onData(static_cast<char *>(contents), real_size)
+                           ? real_size
+                           : 0;
+            }
+        }
+        transfer->response.body.append(static_cast<char *>(contents), real_size);
 
-static std::string performBodyRequest(const std::string &url,
-                                      const std::vector<std::string> &headers,
-                                      const std::string &body, const char *method)
-{
-    CURL *curlHandle = curl_easy_init();
+        return real_size;
+    }
 
-    if (!curlHandle)
+    static size_t headerCallback(char *buffer, size_t size, size_t nitems, void *userp)
     {
-        throw std::runtime_error("could not initialize curl handle");
+        size_t real_size = size * nitems;
+
+        auto *transfer = static_cast<Transfer *>(userp);
+        std::string line(buffer, real_size);
+
+        // A new status line (redirect, 100 Continue) starts a fresh header block
+        if (line.rfind("HTTP/", 0) == 0)
+        {
+            transfer->response.headers.clear();
+            return real_size;
+        }
+
+        size_t colonPos = line.find(':');
+        if (colonPos == std::string::npos)
+        {
+            return real_size;
+        }
+
+        std::string name = line.substr(0, colonPos);
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+        std::string value = line.substr(colonPos + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        value.erase(value.find_last_not_of(" \t\r\n") + 1);
+
+        transfer->response.headers.emplace_back(std::move(name), std::move(value));
+        return real_size;
     }
 
-    struct curl_slist *curlHeaders = nullptr;
-    for (const auto &header : headers)
+    struct Engine
     {
-        curlHeaders = curl_slist_append(curlHeaders, header.c_str());
+        CURLSH *share = nullptr;
+        CURLM *multi = nullptr;
+        std::array<std::mutex, CURL_LOCK_DATA_LAST> shareLocks;
+
+        std::vector<CURL *> idle;
+        std::size_t inFlight = 0;
+        std::atomic<std::size_t> maxInFlight{8};
+
+        std::mutex queueMutex;
+        std::deque<std::unique_ptr<Transfer>> queue;
+        bool stopping = false;
+        std::thread worker;
+
+        std::atomic<std::size_t> requests{0};
+        std::atomic<std::size_t> newConnections{0};
+        std::atomic<std::size_t> reusedConnections{0};
+
+        CURL *acquireHandle()
+        {
+            if (!idle.empty())
+            {
+                CURL *handle = idle.back();
+                idle.pop_back();
+                return handle;
+            }
+
+            CURL *handle = curl_easy_init();
+            if (!handle)
+            {
+                throw std::runtime_error("could not initialize curl handle");
+            }
+            curl_easy_setopt(handle, CURLOPT_SHARE, share);
+            return handle;
+        }
+
+        void releaseHandle(CURL *handle)
+        {
+            // Reset clears per-request options but keeps live connections and caches
+            curl_easy_reset(handle);
+
+            if (idle.size() < MAX_IDLE_HANDLES)
+            {
+                idle.push_back(handle);
+                return;
+            }
+            curl_easy_cleanup(handle);
+        }
+
+        void start(Transfer *transfer)
+        {
+            CURL *curlHandle = acquireHandle();
+            transfer->handle = curlHandle;
+
+            for (const auto &header : transfer->request.headers)
+            {
+                transfer->headers = curl_slist_append(transfer->headers, header.c_str());
+            }
+
+            const Request &request = transfer->request;
+            curl_easy_setopt(curlHandle, CURLOPT_URL, request.url.c_str());
+            curl_easy_setopt(curlHandle, CURLOPT_HTTPHEADER, transfer->headers);
+            curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, writeCallback);
+            curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, transfer);
+            curl_easy_setopt(curlHandle, CURLOPT_HEADERFUNCTION, headerCallback);
+            curl_easy_setopt(curlHandle, CURLOPT_HEADERDATA, transfer);
+            curl_easy_setopt(curlHandle, CURLOPT_PRIVATE, transfer);
+            curl_easy_setopt(curlHandle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_1_1);
+            curl_easy_setopt(curlHandle, CURLOPT_TCP_KEEPALIVE, 1L);
+
+            if (request.method != "GET")
+            {
+                curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDS, request.body.c_str());
+                curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDSIZE, (long)request.body.length());
+                curl_easy_setopt(curlHandle, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+            }
+
+            curl_multi_add_handle(multi, curlHandle);
+            inFlight++;
+        }
+
+        void finish(Transfer *transfer, CURLcode result)
+        {
+            long connectsMade = 0;
+            curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &transfer->response.code);
+            curl_easy_getinfo(transfer->handle, CURLINFO_NUM_CONNECTS, &connectsMade);
+
+            curl_multi_remove_handle(multi, transfer->handle);
+            curl_slist_free_all(transfer->headers);
+            releaseHandle(transfer->handle);
+            inFlight--;
+
+            requests++;
+            if (result == CURLE_OK)
+            {
+                if (connectsMade > 0)
+                {
+                    newConnections += static_cast<std::size_t>(connectsMade);
+                }
+                else
+                {
+                    reusedConnections++;
+                }
+            }
+
+            transfer->onDone(result, std::move(transfer->response));
+        }
+
+        void run()
+        {
+            std::vector<std::unique_ptr<Transfer>> active;
+
+            while (true)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(queueMutex);
+                    if (stopping)
+                    {
+                        break;
+                    }
+                    while (!queue.empty() && inFlight < maxInFlight.load())
+                    {
+                        std::unique_ptr<Transfer> transfer = std::move(queue.front());
+                        queue.pop_front();
+                        try
+                        {
+                            start(transfer.get());
+                        }
+                        catch (const std::exception &)
+                        {
+                            curl_slist_free_all(transfer->headers);
+                            transfer->onDone(CURLE_FAILED_INIT, std::move(transfer->response));
+                            continue;
+                        }
+                        active.push_back(std::move(transfer));
+                    }
+                }
+
+                int running = 0;
+                curl_multi_perform(multi, &running);
+
+                bool finishedAny = false;
+                int messagesLeft = 0;
+                while (CURLMsg *message = curl_multi_info_read(multi, &messagesLeft))
+                {
+                    if (message->msg != CURLMSG_DONE)
+                    {
+                        continue;
+                    }
+
+                    Transfer *transfer = nullptr;
+                    curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &transfer);
+                    finish(transfer, message->data.result);
+                    finishedAny = true;
+
+                    active.erase(std::find_if(active.begin(), active.end(),
+                                              [transfer](const std::unique_ptr<Transfer> &t)
+                                              { return t.get() == transfer; }));
+                }
+
+                // Finished transfers free up slots for queued ones, so go around again first
+                if (!finishedAny)
+                {
+                    curl_multi_poll(multi, nullptr, 0, POLL_TIMEOUT_MS, nullptr);
+                }
+            }
+
+            // Fail whatever is still pending or in flight
+            for (auto &transfer : active)
+            {
+                finish(transfer.get(), CURLE_ABORTED_BY_CALLBACK);
+            }
+
+            std::lock_guard<std::mutex> lock(queueMutex);
+            for (auto &transfer : queue)
+            {
+                transfer->onDone(CURLE_ABORTED_BY_CALLBACK, std::move(transfer->response));
+            }
+            queue.clear();
+        }
+
+        void submit(Request request, std::function<void(CURLcode, Response &&)> onDone)
+        {
+            auto transfer = std::make_unique<Transfer>();
+            transfer->request = std::move(request);
+            transfer->response.code = 0;
+            transfer->onDone = std::move(onDone);
+
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                if (stopping)
+                {
+                    throw std::runtime_error("requester is shutting down");
+                }
+                queue.push_back(std::move(transfer));
+            }
+            curl_multi_wakeup(multi);
+        }
+    };
+
+    static void lockShare(CURL *, curl_lock_data data, curl_lock_access, void *userptr)
+    {
+        static_cast<Engine *>(userptr)->shareLocks.at(static_cast<std::size_t>(data)).lock();
     }
 
-    std::stringstream response;
-    curl_easy_setopt(curlHandle, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curlHandle, CURLOPT_HTTPHEADER, curlHeaders);
-    curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, writeCallback);
-    curl_easy_setopt(curlHandle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_1_1);
-    curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDS, body.c_str());
-    curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDSIZE, (long)body.length());
-    curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, &response);
+    static void unlockShare(CURL *, curl_lock_data data, void *userptr)
+    {
+        static_cast<Engine *>(userptr)->shareLocks.at(static_cast<std::size_t>(data)).unlock();
+    }
 
-    if (method != nullptr)
+    static std::runtime_error curlError(CURLcode code)
     {
-        curl_easy_setopt(curlHandle, CURLOPT_CUSTOMREQUEST, method);
+        std::string errorMessage = "curl failed: ";
+        errorMessage.append(curl_easy_strerror(code));
+        return std::runtime_error(errorMessage);
     }
 
-    CURLcode res = curl_easy_perform(curlHandle);
+    Requester::Requester(std::size_t maxInFlight) : mp_engine(std::make_unique<Engine>())
+    {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
 
-    int responseHttpCode;
-    curl_easy_getinfo(curlHandle, CURLINFO_RESPONSE_CODE, &responseHttpCode);
+        mp_engine->share = curl_share_init();
+        mp_engine->multi = curl_multi_init();
+        if (!mp_engine->share || !mp_engine->multi)
+        {
+            curl_share_cleanup(mp_engine->share);
+            curl_multi_cleanup(mp_engine->multi);
+            throw std::runtime_error("could not initialize curl multi handle");
+        }
+        curl_share_setopt(mp_engine->share, CURLSHOPT_LOCKFUNC, lockShare);
+        curl_share_setopt(mp_engine->share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+        curl_share_setopt(mp_engine->share, CURLSHOPT_USERDATA, mp_engine.get());
+        curl_share_setopt(mp_engine->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(mp_engine->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(mp_engine->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
 
-    curl_slist_free_all(curlHeaders);
-    curl_easy_cleanup(curlHandle);
+        setMaxInFlight(maxInFlight);
+        mp_engine->worker = std::thread([engine = mp_engine.get()]() { engine->run(); });
+    }
 
-    if (res != CURLE_OK)
+    Requester::~Requester()
     {
-        std::string errorMessage = "curl failed: ";
-        errorMessage.append(curl_easy_strerror(res));
-        throw std::runtime_error(errorMessage);
+        {
+            std::lock_guard<std::mutex> lock(mp_engine->queueMutex);
+            mp_engine->stopping = true;
+        }
+        curl_multi_wakeup(mp_engine->multi);
+        mp_engine->worker.join();
+
+        // Easy handles must be gone before the multi and share they are attached to
+        for (CURL *handle : mp_engine->idle)
+        {
+            curl_easy_cleanup(handle);
+        }
+        mp_engine->idle.clear();
+        curl_multi_cleanup(mp_engine->multi);
+        curl_share_cleanup(mp_engine->share);
     }
 
-    if (responseHttpCode != 200)
+    void Requester::setMaxInFlight(std::size_t maxInFlight)
     {
-        std::string errorMessage = "request failed: " + std::to_string(responseHttpCode);
-        throw std::runtime_error(errorMessage);
+        if (maxInFlight == 0)
+        {
+            throw std::runtime_error("in-flight limit must be positive");
+        }
+        mp_engine->maxInFlight = maxInFlight;
+        curl_multi_wakeup(mp_engine->multi);
     }
 
-    return response.str();
-}
+    RequesterStats Requester::getStats() const
+    {
+        return RequesterStats{
+            mp_engine->requests.load(),
+            mp_engine->newConnections.load(),
+            mp_engine->reusedConnections.load(),
+        };
+    }
 
-namespace network
-{
-    Requester::Requester()
+    std::future<Response> Requester::sendAsync(Request request)
     {
-        curl_global_init(CURL_GLOBAL_DEFAULT);
+        auto promise = std::make_shared<std::promise<Response>>();
+        auto future = promise->get_future();
+
+        mp_engine->submit(std::move(request),
+                          [promise](CURLcode result, Response &&response)
+                          {
+                              if (result != CURLE_OK)
+                              {
+                                  promise->set_exception(std::make_exception_ptr(curlError(result)));
+                                  return;
+                              }
+                              promise->set_value(std::move(response));
+                          });
+
+        return future;
+    }
+
+    std::future<std::string> Requester::sendExpectingBody(Request request, bool checkStatus)
+    {
+        auto promise = std::make_shared<std::promise<std::string>>();
+        auto future = promise->get_future();
+
+        mp_engine->submit(
+            std::move(request),
+            [promise, checkStatus](CURLcode result, Response &&response)
+            {
+                if (result != CURLE_OK)
+                {
+                    promise->set_exception(std::make_exception_ptr(curlError(result)));
+                    return;
+                }
+
+                if (checkStatus && response.code != 200)
+                {
+                    std::string errorMessage = "request failed: " + std::to_string(response.code);
+                    promise->set_exception(
+                        std::make_exception_ptr(std::runtime_error(errorMessage)));
+                    return;
+                }
+
+                promise->set_value(std::move(response.body));
+            });
+
+        return future;
+    }
+
+    std::future<std::string> Requester::getRequestAsync(const std::string &url,
+                                                        const std::vector<std::string> &headers)
+    {
+        // GET responses are not status-checked
+        return sendExpectingBody(Request{"GET", url, headers, ""}, false);
+    }
+
+    std::future<std::string> Requester::postRequestAsync(const std::string &url,
+                                                         const std::vector<std::string> &headers,
+                                                         const std::string &body)
+    {
+        return sendExpectingBody(Request{"POST", url, headers, body}, true);
     }
 
-    Requester::~Requester() {}
+    std::future<std::string> Requester::putRequestAsync(const std::string &url,
+                                                        const std::vector<std::string> &headers,
+                                                        const std::string &body)
+    {
+        return sendExpectingBody(Request{"PUT", url, headers, body}, true);
+    }
 
     std::string Requester::getRequest(const std::string &url,
                                       const std::vector<std::string> &headers)
     {
-        CURL *curlHandle = curl_easy_init();
+        return getRequestAsync(url, headers).get();
+    }
+
+    void Requester::getRequestStream(
+        const std::string &url, const std::vector<std::string> &headers,
+        const std::function<void(const char *data, std::size_t length)> &onChunk)
+    {
+        // Set on the requester's thread before the future resolves
+        std::exception_ptr chunkError;
 
-        if (!curlHandle)
+        Request request{"GET", url, headers, ""};
+        request.onData = [&onChunk, &chunkError](const char *data, std::size_t length)
         {
-            throw std::runtime_error("could not initialize curl handle");
-        }
+            try
+            {
+                onChunk(data, length);
+                return true;
+            }
+            catch (...)
+            {
+                chunkError = std::current_exception();
+                return false;
+            }
+        };
 
-        struct curl_slist *curlHeaders = nullptr;
-        for (auto &header : headers)
+        Response response;
+        try
         {
-            curlHeaders = curl_slist_append(curlHeaders, header.c_str());
+            response = sendAsync(std::move(request)).get();
         }
-
-        curl_easy_setopt(curlHandle, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curlHandle, CURLOPT_HTTPHEADER, curlHeaders);
-        curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, writeCallback);
-        curl_easy_setopt(curlHandle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_1_1);
-        std::stringstream response;
-        curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, &response);
-        CURLcode res = curl_easy_perform(curlHandle);
-
-        curl_slist_free_all(curlHeaders);
-        curl_easy_cleanup(curlHandle);
-
-        if (res != CURLE_OK)
+        catch (const std::exception &)
         {
-            std::string errorMessage = "curl failed: ";
-            errorMessage.append(curl_easy_strerror(res));
-            throw std::runtime_error(errorMessage);
+            if (chunkError)
+            {
+                std::rethrow_exception(chunkError);
+            }
+            throw;
         }
 
-        return response.str();
+        if (response.code < 200 || response.code >= 300)
+        {
+            throw std::runtime_error("request failed: " + std::to_string(response.code));
+        }
     }
 
     std::string Requester::postRequest(const std::string &url,
                                        const std::vector<std::string> &headers,
                                        const std::string &body)
     {
-        return performBodyRequest(url, headers, body, "POST");
+        return postRequestAsync(url, headers, body).get();
     }
 
     std::string Requester::putRequest(const std::string &url,
                                       const std::vector<std::string> &headers,
                                       const std::string &body)
     {
-        return performBodyRequest(url, headers, body, "PUT");
+        return putRequestAsync(url, headers, body).get();
     }
 }  // namespace network
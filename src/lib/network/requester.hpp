@@ -1,20 +1,51 @@
 #pragma once
 
+#include <cstddef>
+#include <memory>
+
 #include "lib/network.hpp"
 
 namespace network
 {
+    struct RequesterStats
+    {
+        std::size_t requests;
+        std::size_t newConnections;
+        std::size_t reusedConnections;
+    };
+
     class Requester : public RequesterInterface
     {
       public:
-        Requester();
+        explicit Requester(std::size_t maxInFlight = 8);
         ~Requester();
 
+        std::future<Response> sendAsync(Request request) override;
+        std::future<std::string> getRequestAsync(const std::string &url,
+                                                 const std::vector<std::string> &headers) override;
+        std::future<std::string> postRequestAsync(const std::string &url,
+                                                  const std::vector<std::string> &headers,
+                                                  const std::string &body) override;
+        std::future<std::string> putRequestAsync(const std::string &url,
+                                                 const std::vector<std::string> &headers,
+                                                 const std::string &body) override;
+
         std::string getRequest(const std::string &url,
                                const std::vector<std::string> &headers) override;
+        void getRequestStream(
+            const std::string &url, const std::vector<std::string> &headers,
+            const std::function<void(const char *data, std::size_t length)> &onChunk) override;
         std::string postRequest(const std::string &url, const std::vector<std::string> &headers,
                                 const std::string &body) override;
         std::string putRequest(const std::string &url, const std::vector<std::string> &headers,
                                const std::string &body) override;
+
+        void setMaxInFlight(std::size_t maxInFlight);
+        RequesterStats getStats() const;
+
+      private:
+        std::unique_ptr<struct Engine> mp_engine;
+
+        std::future<std::string> sendExpectingBody(Request request, bool checkStatus);
     };
 }  // namespace network
@@ -0,0 +1,275 @@
+#include "lib/network/retrying_requester.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+
+namespace network
+{
+    // scheme://host[:port] of url; breakers are kept per host
+    static std::string hostOf(const std::string &url)
+    {
+        std::size_t start = url.find("://");
+        start = start == std::string::npos ? 0 : start + 3;
+        std::size_t end = url.find_first_of("/?#", start);
+        return url.substr(0, end);
+    }
+
+    static bool isIdempotent(const Request &request)
+    {
+        return request.idempotent || request.method == "GET" || request.method == "HEAD" ||
+               request.method == "PUT" || request.method == "DELETE";
+    }
+
+    static bool isTransientStatus(long code)
+    {
+        return code == 408 || code == 500 || code == 502 || code == 503 || code == 504;
+    }
+
+    RetryingRequester::RetryingRequester(std::shared_ptr<RequesterInterface> p_inner,
+                                         RetryPolicy policy)
+        : mp_inner(std::move(p_inner)), m_policy(policy), m_budget(policy.budgetCap),
+          m_random(std::random_device()()), m_retries(0)
+    {
+        if (mp_inner == nullptr)
+        {
+            throw std::runtime_error("requester is null");
+        }
+    }
+
+    std::size_t RetryingRequester::retryCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_retries;
+    }
+
+    void RetryingRequester::checkBreaker(const std::string &host)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_breakers.find(host);
+        if (it != m_breakers.end() && Clock::now() < it->second.openUntil)
+        {
+            throw std::runtime_error("circuit open for " + host + " after " +
+                                     std::to_string(it->second.consecutiveFailures) +
+                                     " failures in a row");
+        }
+    }
+
+    void RetryingRequester::recordOutcome(const std::string &host, bool failed)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Breaker &breaker = m_breakers[host];
+        if (!failed)
+        {
+            breaker.consecutiveFailures = 0;
+            return;
+        }
+        if (++breaker.consecutiveFailures >= m_policy.breakerThreshold)
+        {
+            breaker.openUntil = Clock::now() + m_policy.breakerCooldown;
+        }
+    }
+
+    bool RetryingRequester::nextDelay(int attempt, const Response *response,
+                                      Clock::duration &delay)
+    {
+        if (attempt >= m_policy.maxAttempts)
+        {
+            return false;
+        }
+
+        // Retry-After in seconds; the HTTP-date form is left to the backoff
+        std::chrono::milliseconds retryAfter(0);
+        if (response != nullptr)
+        {
+            std::string value = response->header("retry-after");
+            char *end = nullptr;
+            long seconds = std::strtol(value.c_str(), &end, 10);
+            if (!value.empty() && *end == '\0' && seconds >= 0)
+            {
+                retryAfter = std::chrono::seconds(seconds);
+                if (retryAfter > m_policy.maxDelay)
+                {
+                    return false;
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_budget < 1.0)
+        {
+            return false;
+        }
+        m_budget -= 1.0;
+        ++m_retries;
+
+        // Full jitter, so clients that failed together do not retry together
+        int doublings = std::min(attempt - 1, 20);
+        std::chrono::milliseconds ceiling =
+            std::min(m_policy.maxDelay, m_policy.baseDelay * (1 << doublings));
+        std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter(0, ceiling.count());
+        delay = std::max(retryAfter, std::chrono::milliseconds(jitter(m_random)));
+        return true;
+    }
+
+    Response RetryingRequester::send(const Request &request)
+    {
+        std::string host = hostOf(request.url);
+        bool idempotent = isIdempotent(request);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_budget = std::min(m_policy.budgetCap, m_budget + m_policy.budgetRatio);
+        }
+
+        for (int attempt = 1;; ++attempt)
+        {
+            checkBreaker(host);
+
+            // Once part of a streamed body has been handed over, a retry would repeat it
+            bool delivered = false;
+            Request attemptRequest = request;
+            if (request.onData)
+            {
+                attemptRequest.onData = [&request, &delivered](const char *data, std::size_t length)
+                {
+                    delivered = true;
+                    return request.onData(data, length);
+                };
+            }
+
+            Clock::duration delay;
+            Response response;
+            try
+            {
+                response = mp_inner->sendAsync(std::move(attemptRequest)).get();
+            }
+            catch (const std::exception &)
+            {
+                recordOutcome(host, true);
+                if (!idempotent || delivered || !nextDelay(attempt, nullptr, delay))
+                {
+                    throw;
+                }
+                std::this_thread::sleep_for(delay);
+                continue;
+            }
+
+            // Anything but a 5xx means the host is up, even when it refuses the request
+            recordOutcome(host, response.code >= 500);
+            bool retryable = response.code == 429 ||
+                             (idempotent && !delivered && isTransientStatus(response.code));
+            if (!retryable || !nextDelay(attempt, &response, delay))
+            {
+                return response;
+            }
+            std::this_thread::sleep_for(delay);
+        }
+    }
+
+    std::string RetryingRequester::sendExpectingBody(const Request &request)
+    {
+        Response response = send(request);
+        if (response.code < 200 || response.code >= 300)
+        {
+            throw std::runtime_error("request failed: " + std::to_string(response.code));
+        }
+        return std::move(response.body);
+    }
+
+    std::future<Response> RetryingRequester::sendAsync(Request request)
+    {
+        // Backoff sleeps, so each request waits on its own thread
+        return std::async(std::launch::async,
+                          [this, request = std::move(request)]() { return send(request); });
+    }
+
+    std::future<std::string>
+    RetryingRequester::getRequestAsync(const std::string &url,
+                                       const std::vector<std::string> &headers)
+    {
+        return std::async(std::launch::async, [this, request = Request{"GET", url, headers, ""}]()
+                          { return sendExpectingBody(request); });
+    }
+
+    std::future<std::string>
+    RetryingRequester::postRequestAsync(const std::string &url,
+                                        const std::vector<std::string> &headers,
+                                        const std::string &body)
+    {
+        return std::async(std::launch::async,
+                          [this, request = Request{"POST", url, headers, body}]()
+                          { return sendExpectingBody(request); });
+    }
+
+    std::future<std::string>
+    RetryingRequester::putRequestAsync(const std::string &url,
+                                       const std::vector<std::string> &headers,
+                                       const std::string &body)
+    {
+        return std::async(std::launch::async,
+                          [this, request = Request{"PUT", url, headers, body}]()
+                          { return sendExpectingBody(request); });
+    }
+
+    std::string RetryingRequester::getRequest(const std::string &url,
+                                              const std::vector<std::string> &headers)
+    {
+        return sendExpectingBody(Request{"GET", url, headers, ""});
+    }
+
+    void RetryingRequester::getRequestStream(
+        const std::string &url, const std::vector<std::string> &headers,
+        const std::function<void(const char *data, std::size_t length)> &onChunk)
+    {
+        std::exception_ptr chunkError;
+
+        Request request{"GET", url, headers, ""};
+        request.onData = [&onChunk, &chunkError](const char *data, std::size_t length)
+        {
+            try
+            {
+                onChunk(data, length);
+                return true;
+            }
+            catch (...)
+            {
+                chunkError = std::current_exception();
+                return false;
+            }
+        };
+
+        Response response;
+        try
+        {
+            response = send(request);
+        }
+        catch (const std::exception &)
+        {
+            if (chunkError)
+            {
+                std::rethrow_exception(chunkError);
+            }
+            throw;
+        }
+
+        if (response.code < 200 || response.code >= 300)
+        {
+            throw std::runtime_error("request failed: " + std::to_string(response.code));
+        }
+    }
+
+    std::string RetryingRequester::postRequest(const std::string &url,
+                                               const std::vector<std::string> &headers,
+                                               const std::string &body)
+    {
+        return sendExpectingBody(Request{"POST", url, headers, body});
+    }
+
+    std::string RetryingRequester::putRequest(const std::string &url,
+                                              const std::vector<std::string> &headers,
+                                              const std::string &body)
+    {
+        return sendExpectingBody(Request{"PUT", url, headers, body});
+    }
+}  // namespace network
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+
+#include "lib/network.hpp"
+
+namespace network
+{
+    struct RetryPolicy
+    {
+        // Attempts per request, the first one included
+        int maxAttempts = 4;
+        // Backoff before retry n is drawn from [0, min(maxDelay, baseDelay * 2^(n-1))]
+        std::chrono::milliseconds baseDelay{250};
+        std::chrono::milliseconds maxDelay{20000};
+        // Each request earns budgetRatio retries, up to budgetCap banked; every retry spends one.
+        // Keeps retries to a fraction of the traffic while a service is struggling.
+        double budgetRatio = 0.2;
+        double budgetCap = 10;
+        // After this many consecutive failures of a host, requests to it fail right away for
+        // breakerCooldown; then they go through again and one more failure reopens it
+        int breakerThreshold = 5;
+        std::chrono::milliseconds breakerCooldown{30000};
+    };
+
+    // Decorates a requester with retries for transient failures: transport errors, 408, 429
+    // and 5xx gateway/unavailable statuses.
+    //
+    // Requests that are not idempotent (POST without Request::idempotent) are only retried on
+    // 429, which Google and Discord send before doing anything. A Retry-After longer than
+    // maxDelay is not waited out. A streamed GET is retried only while none of its body has
+    // been handed over. Unlike Requester, every status outside 2xx throws in the string
+    // variants, GET included.
+    class RetryingRequester : public RequesterInterface
+    {
+      public:
+        explicit RetryingRequester(std::shared_ptr<RequesterInterface> p_inner,
+                                   RetryPolicy policy = RetryPolicy());
+
+        // Resolves with the last response once retries are exhausted
+        std::future<Response> sendAsync(Request request) override;
+        std::future<std::string> getRequestAsync(const std::string &url,
+                                                 const std::vector<std::string> &headers) override;
+        std::future<std::string> postRequestAsync(const std::string &url,
+                                                  const std::vector<std::string> &headers,
+                                                  const std::string &body) override;
+        std::future<std::string> putRequestAsync(const std::string &url,
+                                                 const std::vector<std::string> &headers,
+                                                 const std::string &body) override;
+
+        std::string getRequest(const std::string &url,
+                               const std::vector<std::string> &headers) override;
+        void getRequestStream(
+            const std::string &url, const std::vector<std::string> &headers,
+            const std::function<void(const char *data, std::size_t length)> &onChunk) override;
+        std::string postRequest(const std::string &url, const std::vector<std::string> &headers,
+                                const std::string &body) override;
+        std::string putRequest(const std::string &url, const std::vector<std::string> &headers,
+                               const std::string &body) override;
+
+        // Retries made so far, for logging
+        std::size_t retryCount() const;
+
+      private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Breaker
+        {
+            int consecutiveFailures = 0;
+            Clock::time_point openUntil;
+        };
+
+        std::shared_ptr<RequesterInterface> mp_inner;
+        RetryPolicy m_policy;
+
+        // Guards everything below; never held while sending or sleeping
+        mutable std::mutex m_mutex;
+        double m_budget;
+        std::map<std::string, Breaker> m_breakers;
+        std::mt19937 m_random;
+        std::size_t m_retries;
+
+        Response send(const Request &request);
+        std::string sendExpectingBody(const Request &request);
+        // Throws while the host's breaker is open
+        void checkBreaker(const std::string &host);
+        void recordOutcome(const std::string &host, bool failed);
+        // How long to wait before the next attempt, or false to give up
+        bool nextDelay(int attempt, const Response *response, Clock::duration &delay);
+    };
+}  // namespace network
@@ -0,0 +1,382 @@
+#include "static_files.hpp"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace network
+{
+    static std::string contentTypeFor(const std::string &path)
+    {
+        static const std::unordered_map<std::string, std::string> types = {
+            {".html", "text/html; charset=utf-8"},
+            {".htm", "text/html; charset=utf-8"},
+            {".css", "text/css; charset=utf-8"},
+            {".js", "application/javascript; charset=utf-8"},
+            {".mjs", "application/javascript; charset=utf-8"},
+            {".json", "application/json"},
+            {".map", "application/json"},
+            {".webmanifest", "application/manifest+json"},
+            {".txt", "text/plain; charset=utf-8"},
+            {".svg", "image/svg+xml"},
+            {".png", "image/png"},
+            {".jpg", "image/jpeg"},
+            {".jpeg", "image/jpeg"},
+            {".gif", "image/gif"},
+            {".webp", "image/webp"},
+            {".ico", "image/x-icon"},
+            {".woff", "font/woff"},
+            {".woff2", "font/woff2"},
+            {".ttf", "font/ttf"},
+            {".wasm", "application/wasm"},
+        };
+
+        std::string extension = std::filesystem::path(path).extension().string();
+        for (auto &c : extension)
+        {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+
+        auto it = types.find(extension);
+        return it != types.end() ? it->second : "application/octet-stream";
+    }
+
+    static std::string httpDate(time_t time)
+    {
+        std::tm tm = {};
+        gmtime_r(&time, &tm);
+        char buffer[64];
+        std::size_t length =
+            std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        return std::string(buffer, length);
+    }
+
+    static std::string_view trim(std::string_view value)
+    {
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+        {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+        {
+            value.remove_suffix(1);
+        }
+        return value;
+    }
+
+    static bool equalsIgnoreCase(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            if (std::tolower(static_cast<unsigned char>(a[i])) !=
+                std::tolower(static_cast<unsigned char>(b[i])))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Calls visit(item) for each comma-separated, trimmed item of a header value until it
+    // returns true
+    template <typename Visitor>
+    static bool anyListItem(std::string_view value, Visitor visit)
+    {
+        while (!value.empty())
+        {
+            std::size_t comma = value.find(',');
+            std::string_view item = trim(value.substr(0, comma));
+            if (!item.empty() && visit(item))
+            {
+                return true;
+            }
+            if (comma == std::string_view::npos)
+            {
+                break;
+            }
+            value.remove_prefix(comma + 1);
+        }
+        return false;
+    }
+
+    static bool acceptsEncoding(std::string_view acceptEncoding, std::string_view encoding)
+    {
+        return anyListItem(acceptEncoding,
+                           [encoding](std::string_view item)
+                           {
+                               std::size_t semicolon = item.find(';');
+                               std::string_view name = trim(item.substr(0, semicolon));
+                               if (!equalsIgnoreCase(name, encoding) && name != "*")
+                               {
+                                   return false;
+                               }
+                               if (semicolon == std::string_view::npos)
+                               {
+                                   return true;
+                               }
+
+                               // "q=0", "q=0.0" and so on explicitly refuse the encoding
+                               std::string_view params = item.substr(semicolon + 1);
+                               std::size_t q = params.find("q=");
+                               if (q == std::string_view::npos)
+                               {
+                                   return true;
+                               }
+                               for (char c : trim(params.substr(q + 2)))
+                               {
+                                   if (c != '0' && c != '.')
+                                   {
+                                       return true;
+                                   }
+                               }
+                               return false;
+                           });
+    }
+
+    static bool matchesEtag(std::string_view ifNoneMatch, const std::string &etag)
+    {
+        return anyListItem(ifNoneMatch,
+                           [&etag](std::string_view item)
+                           {
+                               if (item == "*")
+                               {
+                                   return true;
+                               }
+                               // If-None-Match uses the weak comparison
+                               if (item.substr(0, 2) == "W/")
+                               {
+                                   item.remove_prefix(2);
+                               }
+                               return item == etag;
+                           });
+    }
+
+    StaticFileCache::StaticFileCache() : sendfileThreshold_(256 * 1024)
+    {
+    }
+
+    StaticFileCache::~StaticFileCache()
+    {
+        clear();
+    }
+
+    void StaticFileCache::setSendfileThreshold(std::size_t bytes)
+    {
+        sendfileThreshold_ = bytes;
+    }
+
+    void StaticFileCache::clear()
+    {
+        for (auto &entry : files_)
+        {
+            Entry &file = entry.second;
+            for (Variant *variant : {&file.identity, &file.gzip, &file.brotli})
+            {
+                if (variant->fd >= 0)
+                {
+                    close(variant->fd);
+                }
+            }
+        }
+        files_.clear();
+    }
+
+    std::size_t StaticFileCache::load(const std::string &rootDir)
+    {
+        namespace fs = std::filesystem;
+
+        std::error_code error;
+        if (!fs::is_directory(rootDir, error))
+        {
+            throw std::runtime_error("static file directory not found: " + rootDir);
+        }
+
+        clear();
+
+        for (const auto &item : fs::recursive_directory_iterator(rootDir))
+        {
+            if (!item.is_regular_file())
+            {
+                continue;
+            }
+
+            std::string filePath = item.path().string();
+            std::string extension = item.path().extension().string();
+            if ((extension == ".gz" || extension == ".br") &&
+                fs::is_regular_file(item.path().parent_path() / item.path().stem(), error))
+            {
+                // Loaded below as a variant of the uncompressed file
+                continue;
+            }
+
+            Entry entry;
+            if (!loadVariant(filePath, nullptr, entry.identity))
+            {
+                continue;
+            }
+            loadVariant(filePath + ".gz", "gzip", entry.gzip);
+            loadVariant(filePath + ".br", "br", entry.brotli);
+            buildHeads(entry, contentTypeFor(filePath));
+
+            std::string urlPath = "/" + fs::relative(item.path(), rootDir).generic_string();
+            files_.emplace(std::move(urlPath), std::move(entry));
+        }
+
+        return files_.size();
+    }
+
+    bool StaticFileCache::loadVariant(const std::string &filePath, const char *encoding,
+                                      Variant &variant) const
+    {
+        int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat info = {};
+        if (fstat(fd, &info) < 0 || !S_ISREG(info.st_mode))
+        {
+            close(fd);
+            return false;
+        }
+
+        variant.length = static_cast<std::size_t>(info.st_size);
+        variant.lastModified = httpDate(info.st_mtim.tv_sec);
+
+        // Size and modification time identify the build that produced the file, the same
+        // scheme common web servers use, without hashing every byte
+        char etag[96];
+        std::snprintf(etag, sizeof(etag), "\"%zx-%llx%s%s\"", variant.length,
+                      static_cast<unsigned long long>(info.st_mtim.tv_sec) * 1000000000ULL +
+                          static_cast<unsigned long long>(info.st_mtim.tv_nsec),
+                      encoding ? "-" : "", encoding ? encoding : "");
+        variant.etag = etag;
+
+        if (variant.length > sendfileThreshold_)
+        {
+            variant.fd = fd;
+            return true;
+        }
+
+        variant.content.resize(variant.length);
+        std::size_t offset = 0;
+        while (offset < variant.length)
+        {
+            ssize_t bytesRead = read(fd, &variant.content[offset], variant.length - offset);
+            if (bytesRead < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (bytesRead <= 0)
+            {
+                std::cerr << "Error reading " << filePath << std::endl;
+                close(fd);
+                variant = Variant{};
+                return false;
+            }
+            offset += static_cast<std::size_t>(bytesRead);
+        }
+
+        close(fd);
+        return true;
+    }
+
+    void StaticFileCache::buildHeads(Entry &entry, const std::string &contentType) const
+    {
+        bool hasVariants = !entry.gzip.etag.empty() || !entry.brotli.etag.empty();
+        const std::string &lastModified = entry.identity.lastModified;
+
+        auto build = [&](Variant &variant, const char *encoding)
+        {
+            if (variant.etag.empty())
+            {
+                return;
+            }
+
+            std::string common = "ETag: " + variant.etag + "\r\nLast-Modified: " + lastModified +
+                                 "\r\n";
+            if (hasVariants)
+            {
+                common += "Vary: Accept-Encoding\r\n";
+            }
+
+            variant.head = "HTTP/1.1 200 OK\r\nContent-Type: " + contentType +
+                           "\r\nContent-Length: " + std::to_string(variant.length) + "\r\n";
+            if (encoding != nullptr)
+            {
+                variant.head += std::string("Content-Encoding: ") + encoding + "\r\n";
+            }
+            variant.head += common;
+
+            variant.notModifiedHead = "HTTP/1.1 304 Not Modified\r\n" + common;
+        };
+
+        build(entry.identity, nullptr);
+        build(entry.gzip, "gzip");
+        build(entry.brotli, "br");
+    }
+
+    std::size_t StaticFileCache::size() const
+    {
+        return files_.size();
+    }
+
+    bool StaticFileCache::lookup(std::string_view path, std::string_view acceptEncoding,
+                                 std::string_view ifNoneMatch, StaticReply &reply) const
+    {
+        std::string key(path);
+        if (key.empty() || key.back() == '/')
+        {
+            key += "index.html";
+        }
+
+        auto it = files_.find(key);
+        if (it == files_.end())
+        {
+            return false;
+        }
+
+        const Entry &entry = it->second;
+        const Variant *variant = &entry.identity;
+        if (!entry.brotli.etag.empty() && acceptsEncoding(acceptEncoding, "br"))
+        {
+            variant = &entry.brotli;
+        }
+        else if (!entry.gzip.etag.empty() && acceptsEncoding(acceptEncoding, "gzip"))
+        {
+            variant = &entry.gzip;
+        }
+
+        reply = StaticReply{};
+        if (!ifNoneMatch.empty() && matchesEtag(ifNoneMatch, variant->etag))
+        {
+            reply.code = 304;
+            reply.head = variant->notModifiedHead;
+            return true;
+        }
+
+        reply.head = variant->head;
+        reply.length = variant->length;
+        if (variant->fd >= 0)
+        {
+            reply.fd = variant->fd;
+        }
+        else
+        {
+            reply.body = variant->content;
+        }
+        return true;
+    }
+}  // namespace network
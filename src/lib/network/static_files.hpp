@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <unordered_map>
+
+namespace network
+{
+    // A ready-to-send static response: the status line and headers (without the final
+    // Connection header and blank line), followed by either a view into the cached bytes or
+    // a range of an open file to sendfile() from.
+    struct StaticReply
+    {
+        int code = 200;
+        std::string head;
+        std::string_view body;
+        int fd = -1;
+        off_t offset = 0;
+        std::size_t length = 0;
+    };
+
+    // Serves a directory tree (e.g. a built frontend) out of memory.
+    //
+    // load() walks the directory once; every file is read into memory, or kept open for
+    // sendfile() when it is larger than the sendfile threshold. ETag, Last-Modified and the
+    // response headers are computed up front. Sibling "<file>.br" and "<file>.gz" files are
+    // picked up as precompressed variants of "<file>" and chosen by Accept-Encoding.
+    // Directory paths resolve to their index.html. Files added or changed on disk after
+    // load() are not seen until the next load().
+    class StaticFileCache
+    {
+      public:
+        StaticFileCache();
+        ~StaticFileCache();
+
+        StaticFileCache(const StaticFileCache &) = delete;
+        StaticFileCache &operator=(const StaticFileCache &) = delete;
+
+        void setSendfileThreshold(std::size_t bytes);
+
+        // Replaces the cache with the contents of rootDir; returns the number of files served
+        std::size_t load(const std::string &rootDir);
+        std::size_t size() const;
+
+        // False when path is not one of the loaded files. Otherwise fills reply with a 200,
+        // or a 304 when ifNoneMatch matches the selected variant's ETag.
+        bool lookup(std::string_view path, std::string_view acceptEncoding,
+                    std::string_view ifNoneMatch, StaticReply &reply) const;
+
+      private:
+        struct Variant
+        {
+            std::string etag;
+            std::string lastModified;
+            std::string head;
+            std::string notModifiedHead;
+            std::string content;
+            int fd = -1;
+            std::size_t length = 0;
+        };
+
+        struct Entry
+        {
+            Variant identity;
+            Variant gzip;
+            Variant brotli;
+        };
+
+        std::unordered_map<std::string, Entry> files_;
+        std::size_t sendfileThreshold_;
+
+        void clear();
+        bool loadVariant(const std::string &filePath, const char *encoding,
+                         Variant &variant) const;
+        void buildHeads(Entry &entry, const std::string &contentType) const;
+    };
+}  // namespace network
@@ -0,0 +1,61 @@
+#include "lib/network/token_bucket.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace network
+{
+    TokenBucket::TokenBucket(std::size_t capacity, Clock::duration period)
+        : m_capacity(static_cast<double>(capacity)), m_perToken(0),
+          m_tokens(static_cast<double>(capacity)), m_updated(), m_pausedUntil()
+    {
+        if (capacity == 0 || period <= Clock::duration::zero())
+        {
+            throw std::runtime_error("token bucket needs a capacity and a period");
+        }
+        m_perToken = period / static_cast<Clock::rep>(capacity);
+    }
+
+    void TokenBucket::refill(Clock::time_point now)
+    {
+        if (m_updated == Clock::time_point() || now <= m_updated)
+        {
+            m_updated = std::max(m_updated, now);
+            return;
+        }
+        double earned = std::chrono::duration<double>(now - m_updated) /
+                        std::chrono::duration<double>(m_perToken);
+        m_tokens = std::min(m_capacity, m_tokens + earned);
+        m_updated = now;
+    }
+
+    TokenBucket::Clock::time_point TokenBucket::take(Clock::time_point now)
+    {
+        refill(now);
+        m_tokens -= 1.0;
+
+        Clock::time_point at = now;
+        if (m_tokens < 0.0)
+        {
+            at += std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(m_perToken) * -m_tokens);
+        }
+        return std::max(at, m_pausedUntil);
+    }
+
+    void TokenBucket::update(std::size_t remaining, Clock::duration resetAfter,
+                             Clock::time_point now)
+    {
+        refill(now);
+        m_tokens = std::min(m_tokens, static_cast<double>(remaining));
+        if (remaining == 0)
+        {
+            pauseUntil(now + resetAfter);
+        }
+    }
+
+    void TokenBucket::pauseUntil(Clock::time_point until)
+    {
+        m_pausedUntil = std::max(m_pausedUntil, until);
+    }
+}  // namespace network
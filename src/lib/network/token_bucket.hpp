@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace network
+{
+    // Client-side rate limit: capacity requests at once, refilled at capacity per period.
+    //
+    // take() reserves a request and says when it may be sent, so the caller sleeps outside any
+    // lock. Reservations past the capacity queue up behind each other. The server's own view
+    // (remaining requests, a reset time, a Retry-After) overrides the local estimate when it
+    // is stricter. Not thread-safe.
+    class TokenBucket
+    {
+      public:
+        using Clock = std::chrono::steady_clock;
+
+        TokenBucket(std::size_t capacity, Clock::duration period);
+
+        // When the reserved request may go out; now when a token is available
+        Clock::time_point take(Clock::time_point now);
+        // What the server reported after a response: remaining requests until resetAfter
+        void update(std::size_t remaining, Clock::duration resetAfter, Clock::time_point now);
+        // Nothing goes out before until, as after a 429
+        void pauseUntil(Clock::time_point until);
+
+      private:
+        double m_capacity;
+        Clock::duration m_perToken;
+        // Negative while reservations are waiting for tokens
+        double m_tokens;
+        Clock::time_point m_updated;
+        Clock::time_point m_pausedUntil;
+
+        void refill(Clock::time_point now);
+    };
+}  // namespace network
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <chrono>
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "lib/network.hpp"
 
@@ -24,14 +26,34 @@ namespace sheet
         int row;
     };
 
+    class Ledger;
+    struct RowEdit;
+
     class ClientInterface
     {
       public:
         virtual ~ClientInterface() = default;
         virtual void setSheetId(const std::string &sheetId) = 0;
+        // Drive revision of the spreadsheet; it changes whenever any cell does
+        virtual std::string getRevision() = 0;
         virtual std::vector<Transaction> getTransactions() = 0;
+        // Rows firstRow onwards; row 2 is the first transaction
+        virtual std::vector<Transaction> getTransactionsFrom(int firstRow) = 0;
+        // Hands each transaction to sink as soon as its row has downloaded, without holding
+        // the whole response in memory
+        virtual void streamTransactions(const std::function<void(Transaction &&)> &sink) = 0;
+        virtual void streamTransactionsFrom(int firstRow,
+                                            const std::function<void(Transaction &&)> &sink) = 0;
         virtual void markDuplicatesInSheet(const std::vector<TransactionRow> &transactionRows) = 0;
         virtual void setCategoriesInSheet(const std::vector<TransactionRow> &transactionRows) = 0;
+        virtual void queueDuplicateMarks(const std::vector<TransactionRow> &transactionRows) = 0;
+        virtual void queueCategories(const std::vector<TransactionRow> &transactionRows) = 0;
+        // Queues the cell updates for edits of ledger, whose row 0 is sheet row firstRow
+        virtual void queueEdits(const Ledger &ledger, const std::vector<RowEdit> &edits,
+                                int firstRow) = 0;
+        virtual void flushUpdates() = 0;
         virtual void addTransaction(const Transaction &transaction) = 0;
+        // Appends all transactions as rows of a single values:append call
+        virtual void addTransactions(const std::vector<Transaction> &transactions) = 0;
     };
 }  // namespace sheet
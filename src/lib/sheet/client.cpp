@@ -1,14 +1,37 @@
 #include "lib/sheet/client.hpp"
 
+#include <algorithm>
+#include <climits>
 #include <cmath>
+#include <cstdlib>
 #include <nlohmann/json.hpp>
 
+#include "lib/auth/exec_provider.hpp"
+#include "lib/sheet/ledger.hpp"
+#include "lib/sheet/values_stream.hpp"
+
 namespace sheet
 {
-    struct Token
+    static const char *SHEETS_SCOPE = "https://www.googleapis.com/auth/spreadsheets";
+    static const char *DRIVE_METADATA_SCOPE =
+        "https://www.googleapis.com/auth/drive.metadata.readonly";
+    static const char *SHEETS_BASE_URL = "https://sheets.googleapis.com/v4/spreadsheets/";
+    static const char *DRIVE_FILES_BASE_URL = "https://www.googleapis.com/drive/v3/files/";
+
+    static std::string baseUrlFromEnv(const char *name, const char *fallback)
     {
-        std::string accessToken;
-    };
+        const char *value = std::getenv(name);
+        return value != nullptr && *value != '\0' ? value : fallback;
+    }
+
+    static std::string withTrailingSlash(std::string url)
+    {
+        if (url.empty() || url.back() != '/')
+        {
+            url += '/';
+        }
+        return url;
+    }
 
     static std::chrono::system_clock::time_point
     googleSheetsDateTimeToTimePoint(const double googleSheetsValue)
@@ -26,20 +49,31 @@ namespace sheet
     }
 
     Client::Client(std::shared_ptr<network::RequesterInterface> p_requester,
-                   std::shared_ptr<external::ExecInterface> p_exec)
-        : mp_requester(std::move(p_requester)), mp_exec(std::move(p_exec)), mp_token(nullptr),
-          m_sheetId("")
+                   std::shared_ptr<auth::TokenProviderInterface> p_tokenProvider)
+        : mp_requester(std::move(p_requester)), mp_tokenProvider(std::move(p_tokenProvider)),
+          m_sheetId(""), m_batchChunkSize(500),
+          m_sheetsBaseUrl(
+              withTrailingSlash(baseUrlFromEnv("SHEETS_API_BASE_URL", SHEETS_BASE_URL))),
+          m_driveBaseUrl(
+              withTrailingSlash(baseUrlFromEnv("DRIVE_API_BASE_URL", DRIVE_FILES_BASE_URL)))
     {
         if (mp_requester == nullptr)
         {
             throw std::runtime_error("requester is null");
         }
+        if (mp_tokenProvider == nullptr)
+        {
+            throw std::runtime_error("token provider is null");
+        }
+        // Fail early on bad credentials
         getToken();
     }
 
-    Client::~Client()
+    Client::Client(std::shared_ptr<network::RequesterInterface> p_requester,
+                   std::shared_ptr<external::ExecInterface> p_exec)
+        : Client(std::move(p_requester),
+                 std::make_shared<auth::ExecTokenProvider>(std::move(p_exec)))
     {
-        deleteToken();
     }
 
     void Client::setSheetId(const std::string &sheetId)
@@ -47,217 +81,315 @@ namespace sheet
         m_sheetId = sheetId;
     }
 
-    void Client::deleteToken()
+    void Client::setBaseUrls(const std::string &sheetsBaseUrl, const std::string &driveBaseUrl)
     {
-        if (mp_token != nullptr)
+        m_sheetsBaseUrl = withTrailingSlash(sheetsBaseUrl);
+        m_driveBaseUrl = withTrailingSlash(driveBaseUrl);
+    }
+
+    void Client::setBatchChunkSize(std::size_t chunkSize)
+    {
+        if (chunkSize == 0)
         {
-            delete mp_token;
-            mp_token = nullptr;
+            throw std::runtime_error("batch chunk size must be positive");
         }
+        m_batchChunkSize = chunkSize;
     }
 
-    void Client::getToken()
+    std::size_t Client::pendingUpdateCount() const
     {
-        mp_token = new Token{mp_exec->googleOAuth("https://www.googleapis.com/auth/spreadsheets")};
+        return m_pendingUpdates.size();
     }
 
-    std::vector<Transaction> Client::getTransactions()
+    std::string Client::getToken()
+    {
+        return mp_tokenProvider->getAccessToken(SHEETS_SCOPE);
+    }
+
+    std::vector<std::string> Client::getHeaders()
+    {
+        return {
+            "Authorization: Bearer " + getToken(),
+            "Content-Type: application/json",
+        };
+    }
+
+    std::string Client::getRevision()
     {
         if (mp_requester == nullptr)
         {
             throw std::runtime_error("requester is null");
         }
 
-        if (mp_token == nullptr)
-        {
-            throw std::runtime_error("token is null");
-        }
-
-        auto fetchTransactionJson = [this]() -> std::string
-        {
-            std::string range = "Transactions!A2:F";
-            std::vector<std::string> headers;
-            headers.push_back("Authorization: Bearer " + mp_token->accessToken);
-            headers.push_back("Content-Type: application/json");
-            std::string url = "https://sheets.googleapis.com/v4/spreadsheets/" + m_sheetId +
-                              "/values/" + range + "?valueRenderOption=UNFORMATTED_VALUE";
-            return mp_requester->getRequest(std::move(url), std::move(headers));
+        std::string url = m_driveBaseUrl + m_sheetId + "?fields=version";
+        std::vector<std::string> headers = {
+            "Authorization: Bearer " + mp_tokenProvider->getAccessToken(DRIVE_METADATA_SCOPE),
         };
 
-        std::string response = fetchTransactionJson();
+        auto json = nlohmann::json::parse(mp_requester->getRequest(url, headers));
+        return json.at("version").get<std::string>();
+    }
 
-        auto parseJsonString = [](std::string &jsonString) -> std::vector<Transaction>
+    static Transaction rowToTransaction(const std::vector<ValuesStreamParser::Cell> &cells)
+    {
+        using Cell = ValuesStreamParser::Cell;
+        static const Cell empty;
+
+        // Trailing empty cells are left out of the row entirely
+        auto cell = [&cells](std::size_t column) -> const Cell &
+        { return column < cells.size() ? cells[column] : empty; };
+        auto getString = [](const Cell &c) -> std::string { return c.text; };
+        auto getNumeric = [](const Cell &c) -> int
         {
-            std::vector<Transaction> transactions;
-
-            nlohmann::json json = nlohmann::json::parse(jsonString);
-            for (auto &v : json["values"])
+            if (c.type == Cell::Type::EMPTY || c.text.empty())
             {
-                auto date = googleSheetsDateTimeToTimePoint(v[2]);
-
-                auto getString = [](nlohmann::json &i) -> std::string
-                { return i.is_null() ? "" : i; };
-                auto getNumeric = [](nlohmann::json &i) -> int
-                {
-                    if (i.is_string())
-                    {
-                        std::string s = i;
-                        if (s.length() < 1)
-                        {
-                            return 0;
-                        }
-                        return std::stoi(s);
-                    }
-
-                    if (i.is_null())
-                    {
-                        return 0;
-                    }
-
-                    return i;
-                };
-
-                transactions.emplace_back(Transaction{
-                    getString(v[0]),
-                    getString(v[1]),
-                    date,
-                    getNumeric(v[3]),
-                    getString(v[4]),
-                    getString(v[5]),
-                });
+                return 0;
+            }
+            if (c.type == Cell::Type::BOOLEAN)
+            {
+                return c.text == "true" ? 1 : 0;
+            }
+            if (c.type != Cell::Type::NUMBER)
+            {
+                return std::stoi(c.text);
             }
 
-            return transactions;
+            // JSON number text may use an exponent (1.5E7); like a JSON number converted to
+            // int, the fraction is dropped, and amounts beyond int saturate instead of wrapping
+            double value = std::strtod(c.text.c_str(), nullptr);
+            value = std::min(std::max(value, static_cast<double>(INT_MIN)),
+                             static_cast<double>(INT_MAX));
+            return static_cast<int>(value);
+        };
+
+        if (cell(2).type != Cell::Type::NUMBER)
+        {
+            throw std::runtime_error("transaction date is not a number");
+        }
+        auto date = googleSheetsDateTimeToTimePoint(std::stod(cell(2).text));
+
+        return Transaction{
+            getString(cell(0)),
+            getString(cell(1)),
+            date,
+            getNumeric(cell(3)),
+            getString(cell(4)),
+            getString(cell(5)),
         };
+    }
 
-        return parseJsonString(response);
+    std::vector<Transaction> Client::getTransactions()
+    {
+        return getTransactionsFrom(2);
     }
 
-    void Client::markDuplicatesInSheet(const std::vector<TransactionRow> &transactionRows)
+    std::vector<Transaction> Client::getTransactionsFrom(int firstRow)
+    {
+        std::vector<Transaction> transactions;
+        streamTransactionsFrom(firstRow, [&transactions](Transaction &&transaction)
+                               { transactions.push_back(std::move(transaction)); });
+        return transactions;
+    }
+
+    void Client::streamTransactions(const std::function<void(Transaction &&)> &sink)
+    {
+        streamTransactionsFrom(2, sink);
+    }
+
+    void Client::streamTransactionsFrom(int firstRow,
+                                        const std::function<void(Transaction &&)> &sink)
     {
         if (mp_requester == nullptr)
         {
             throw std::runtime_error("requester is null");
         }
+        if (firstRow < 2)
+        {
+            throw std::runtime_error("first transaction row must be 2 or later");
+        }
 
-        if (mp_token == nullptr)
+        std::string range = "Transactions!A" + std::to_string(firstRow) + ":F";
+        std::vector<std::string> headers = getHeaders();
+        std::string url = m_sheetsBaseUrl + m_sheetId + "/values/" + range +
+                          "?valueRenderOption=UNFORMATTED_VALUE";
+
+        // Rows are parsed as the chunks arrive, so parsing overlaps with the download
+        ValuesStreamParser parser([&sink](const std::vector<ValuesStreamParser::Cell> &cells)
+                                  { sink(rowToTransaction(cells)); });
+        mp_requester->getRequestStream(url, headers, [&parser](const char *data, std::size_t length)
+                                       { parser.feed(data, length); });
+        parser.finish();
+    }
+
+    void Client::markDuplicatesInSheet(const std::vector<TransactionRow> &transactionRows)
+    {
+        queueDuplicateMarks(transactionRows);
+        flushUpdates();
+    }
+
+    void Client::setCategoriesInSheet(const std::vector<TransactionRow> &transactionRows)
+    {
+        queueCategories(transactionRows);
+        flushUpdates();
+    }
+
+    void Client::queueCellUpdate(const char column, const int row, const std::string &value)
+    {
+        std::string range = std::string("Transactions!") + column + std::to_string(row) + ":" +
+                            column + std::to_string(row);
+        m_pendingUpdates.emplace_back(std::move(range), value);
+    }
+
+    void Client::queueDuplicateMarks(const std::vector<TransactionRow> &transactionRows)
+    {
+        for (const auto &trxRow : transactionRows)
         {
-            throw std::runtime_error("token is null");
+            // Update subject (column B) and set amount to 0 (column D)
+            queueCellUpdate('B', trxRow.row, trxRow.transaction->subject);
+            queueCellUpdate('D', trxRow.row, "0");
         }
+    }
 
+    void Client::queueCategories(const std::vector<TransactionRow> &transactionRows)
+    {
         for (const auto &trxRow : transactionRows)
         {
-            // Update subject (column B)
-            {
-                std::string range = "Transactions!B" + std::to_string(trxRow.row) + ":B" +
-                                    std::to_string(trxRow.row);
-                std::string url = "https://sheets.googleapis.com/v4/spreadsheets/" + m_sheetId +
-                                  "/values/" + range +
-                                  "?valueInputOption=USER_ENTERED&includeValuesInResponse=0";
-
-                std::vector<std::string> headers;
-                headers.push_back("Authorization: Bearer " + mp_token->accessToken);
-                headers.push_back("Content-Type: application/json");
-
-                nlohmann::json valueRange = {
-                    {"range", range},
-                    {"values", nlohmann::json::array(
-                                   {nlohmann::json::array({trxRow.transaction->subject})})}};
-
-                mp_requester->putRequest(url, headers, valueRange.dump());
-            }
+            // Update category (column F)
+            queueCellUpdate('F', trxRow.row, trxRow.transaction->category);
+        }
+    }
 
-            // Update amount to 0 (column D)
+    void Client::queueEdits(const Ledger &ledger, const std::vector<RowEdit> &edits,
+                            int firstRow)
+    {
+        for (const auto &edit : edits)
+        {
+            int row = static_cast<int>(edit.row) + firstRow;
+            switch (edit.kind)
             {
-                std::string range = "Transactions!D" + std::to_string(trxRow.row) + ":D" +
-                                    std::to_string(trxRow.row);
-                std::string url = "https://sheets.googleapis.com/v4/spreadsheets/" + m_sheetId +
-                                  "/values/" + range +
-                                  "?valueInputOption=USER_ENTERED&includeValuesInResponse=0";
-
-                std::vector<std::string> headers;
-                headers.push_back("Authorization: Bearer " + mp_token->accessToken);
-                headers.push_back("Content-Type: application/json");
-
-                nlohmann::json valueRange = {
-                    {"range", range},
-                    {"values", nlohmann::json::array({nlohmann::json::array({"0"})})}};
-
-                mp_requester->putRequest(url, headers, valueRange.dump());
+                case RowEdit::Kind::MARK_DUPLICATE:
+                    queueCellUpdate('B', row,
+                                    duplicateSubject(static_cast<int>(edit.original) + firstRow,
+                                                     ledger.subject(edit.row)));
+                    queueCellUpdate('D', row, "0");
+                    break;
+                case RowEdit::Kind::SET_CATEGORY:
+                    queueCellUpdate('F', row, std::string(edit.category));
+                    break;
             }
         }
     }
 
-    void Client::setCategoriesInSheet(const std::vector<TransactionRow> &transactionRows)
+    void Client::flushUpdates()
     {
         if (mp_requester == nullptr)
         {
             throw std::runtime_error("requester is null");
         }
 
-        if (mp_token == nullptr)
+        std::string url = m_sheetsBaseUrl + m_sheetId + "/values:batchUpdate";
+
+        std::vector<std::string> headers = getHeaders();
+
+        // Send every chunk up front so they overlap on the wire
+        std::vector<std::pair<std::size_t, std::future<network::Response>>> chunks;
+        for (std::size_t begin = 0; begin < m_pendingUpdates.size(); begin += m_batchChunkSize)
         {
-            throw std::runtime_error("token is null");
+            std::size_t end = std::min(begin + m_batchChunkSize, m_pendingUpdates.size());
+
+            nlohmann::json data = nlohmann::json::array();
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                data.push_back(
+                    {{"range", m_pendingUpdates[i].first},
+                     {"values", nlohmann::json::array(
+                                    {nlohmann::json::array({m_pendingUpdates[i].second})})}});
+            }
+
+            nlohmann::json requestBody = {{"valueInputOption", "USER_ENTERED"},
+                                          {"includeValuesInResponse", false},
+                                          {"data", std::move(data)}};
+
+            // Every update names its cell, so a chunk sent twice writes the same values
+            network::Request request{"POST", url, headers, requestBody.dump()};
+            request.idempotent = true;
+            chunks.emplace_back(begin, mp_requester->sendAsync(std::move(request)));
         }
 
-        for (const auto &trxRow : transactionRows)
+        // Updates from failed chunks stay queued for the next flush
+        std::vector<std::pair<std::string, std::string>> unsent;
+        std::exception_ptr firstError = nullptr;
+        for (auto &chunk : chunks)
         {
-            // Update category (column F)
-            std::string range =
-                "Transactions!F" + std::to_string(trxRow.row) + ":F" + std::to_string(trxRow.row);
-            std::string url = "https://sheets.googleapis.com/v4/spreadsheets/" + m_sheetId +
-                              "/values/" + range +
-                              "?valueInputOption=USER_ENTERED&includeValuesInResponse=0";
-
-            std::vector<std::string> headers;
-            headers.push_back("Authorization: Bearer " + mp_token->accessToken);
-            headers.push_back("Content-Type: application/json");
-
-            nlohmann::json valueRange = {
-                {"range", range},
-                {"values",
-                 nlohmann::json::array({nlohmann::json::array({trxRow.transaction->category})})}};
-
-            mp_requester->putRequest(url, headers, valueRange.dump());
+            try
+            {
+                network::Response response = chunk.second.get();
+                if (response.code < 200 || response.code >= 300)
+                {
+                    throw std::runtime_error("request failed: " + std::to_string(response.code));
+                }
+            }
+            catch (...)
+            {
+                if (firstError == nullptr)
+                {
+                    firstError = std::current_exception();
+                }
+                std::size_t end = std::min(chunk.first + m_batchChunkSize, m_pendingUpdates.size());
+                unsent.insert(unsent.end(),
+                              m_pendingUpdates.begin() + static_cast<std::ptrdiff_t>(chunk.first),
+                              m_pendingUpdates.begin() + static_cast<std::ptrdiff_t>(end));
+            }
+        }
+
+        m_pendingUpdates = std::move(unsent);
+        if (firstError != nullptr)
+        {
+            std::rethrow_exception(firstError);
         }
     }
 
     void Client::addTransaction(const Transaction &transaction)
+    {
+        addTransactions({transaction});
+    }
+
+    void Client::addTransactions(const std::vector<Transaction> &transactions)
     {
         if (mp_requester == nullptr)
         {
             throw std::runtime_error("requester is null");
         }
-
-        if (mp_token == nullptr)
+        if (transactions.empty())
         {
-            throw std::runtime_error("token is null");
+            return;
         }
 
-        // Convert time_point to YYYY-MM-DD hh:mm:ss format
-        auto timeT = std::chrono::system_clock::to_time_t(transaction.date);
-        std::tm tm = *std::gmtime(&timeT);
-        char dateBuffer[32];
-        std::strftime(dateBuffer, sizeof(dateBuffer), "%Y-%m-%d %H:%M:%S", &tm);
-        std::string dateString(dateBuffer);
-
-        nlohmann::json rowValues = nlohmann::json::array({
-            transaction.account,
-            transaction.subject,
-            dateString,
-            transaction.amount,
-        });
+        nlohmann::json rows = nlohmann::json::array();
+        for (const auto &transaction : transactions)
+        {
+            // Convert time_point to YYYY-MM-DD hh:mm:ss format
+            auto timeT = std::chrono::system_clock::to_time_t(transaction.date);
+            std::tm tm = {};
+            gmtime_r(&timeT, &tm);
+            char dateBuffer[32];
+            std::strftime(dateBuffer, sizeof(dateBuffer), "%Y-%m-%d %H:%M:%S", &tm);
+
+            rows.push_back({
+                transaction.account,
+                transaction.subject,
+                std::string(dateBuffer),
+                transaction.amount,
+            });
+        }
 
         std::string range = "Transactions!A:D";
-        std::string url = "https://sheets.googleapis.com/v4/spreadsheets/" + m_sheetId +
-                          "/values/" + range +
+        std::string url = m_sheetsBaseUrl + m_sheetId + "/values/" + range +
                           ":append?valueInputOption=USER_ENTERED&insertDataOption=INSERT_ROWS";
 
-        std::vector<std::string> headers;
-        headers.push_back("Authorization: Bearer " + mp_token->accessToken);
-        headers.push_back("Content-Type: application/json");
+        std::vector<std::string> headers = getHeaders();
 
-        nlohmann::json requestBody = {{"values", nlohmann::json::array({rowValues})}};
+        nlohmann::json requestBody = {{"values", rows}};
 
         mp_requester->postRequest(url, headers, requestBody.dump());
     }
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <memory>
+#include <utility>
 
+#include "lib/auth.hpp"
 #include "lib/external.hpp"
 #include "lib/network.hpp"
 #include "lib/sheet.hpp"
@@ -12,21 +14,47 @@ namespace sheet
     {
       private:
         std::shared_ptr<network::RequesterInterface> mp_requester;
-        std::shared_ptr<external::ExecInterface> mp_exec;
-        struct Token *mp_token;
+        std::shared_ptr<auth::TokenProviderInterface> mp_tokenProvider;
         std::string m_sheetId;
-        void getToken();
-        void deleteToken();
+        // (range, value) pairs waiting for the next values:batchUpdate
+        std::vector<std::pair<std::string, std::string>> m_pendingUpdates;
+        std::size_t m_batchChunkSize;
+        std::string m_sheetsBaseUrl;
+        std::string m_driveBaseUrl;
+        std::string getToken();
+        std::vector<std::string> getHeaders();
+        void queueCellUpdate(const char column, const int row, const std::string &value);
 
       public:
+        Client(std::shared_ptr<network::RequesterInterface> p_requester,
+               std::shared_ptr<auth::TokenProviderInterface> p_tokenProvider);
         Client(std::shared_ptr<network::RequesterInterface> p_requester,
                std::shared_ptr<external::ExecInterface> p_exec);
-        ~Client();
 
         void setSheetId(const std::string &sheetId) override;
+        // Where the API calls go, e.g. a local mock server. They start out as
+        // SHEETS_API_BASE_URL and DRIVE_API_BASE_URL when those are set, and as the Google
+        // endpoints ("https://sheets.googleapis.com/v4/spreadsheets/",
+        // "https://www.googleapis.com/drive/v3/files/") otherwise.
+        void setBaseUrls(const std::string &sheetsBaseUrl, const std::string &driveBaseUrl);
+        void setBatchChunkSize(std::size_t chunkSize);
+        std::size_t pendingUpdateCount() const;
+
+        std::string getRevision() override;
+
         std::vector<Transaction> getTransactions() override;
+        std::vector<Transaction> getTransactionsFrom(int firstRow) override;
+        void streamTransactions(const std::function<void(Transaction &&)> &sink) override;
+        void streamTransactionsFrom(int firstRow,
+                                    const std::function<void(Transaction &&)> &sink) override;
         void markDuplicatesInSheet(const std::vector<TransactionRow> &transactionRows) override;
         void setCategoriesInSheet(const std::vector<TransactionRow> &transactionRows) override;
+        void queueDuplicateMarks(const std::vector<TransactionRow> &transactionRows) override;
+        void queueCategories(const std::vector<TransactionRow> &transactionRows) override;
+        void queueEdits(const Ledger &ledger, const std::vector<RowEdit> &edits,
+                        int firstRow) override;
+        void flushUpdates() override;
         void addTransaction(const Transaction &transaction) override;
+        void addTransactions(const std::vector<Transaction> &transactions) override;
     };
 }  // namespace sheet
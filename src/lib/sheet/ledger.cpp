@@ -0,0 +1,197 @@
+#include "lib/sheet/ledger.hpp"
+
+#include <stdexcept>
+
+namespace sheet
+{
+    std::uint32_t StringPool::intern(std::string_view text)
+    {
+        auto it = m_ids.find(text);
+        if (it != m_ids.end())
+        {
+            return it->second;
+        }
+
+        if (m_strings.size() >= NONE)
+        {
+            throw std::runtime_error("too many distinct strings");
+        }
+        auto id = static_cast<std::uint32_t>(m_strings.size());
+        m_strings.emplace_back(text);
+        m_ids.emplace(m_strings.back(), id);
+        return id;
+    }
+
+    std::uint32_t StringPool::find(std::string_view text) const
+    {
+        auto it = m_ids.find(text);
+        return it == m_ids.end() ? NONE : it->second;
+    }
+
+    std::string_view StringPool::view(std::uint32_t id) const
+    {
+        return m_strings.at(id);
+    }
+
+    std::size_t StringPool::size() const
+    {
+        return m_strings.size();
+    }
+
+    Ledger::Ledger() : m_subjectOffsets{0}
+    {
+    }
+
+    Ledger Ledger::fromTransactions(const std::vector<Transaction> &transactions)
+    {
+        Ledger ledger;
+        ledger.reserve(transactions.size());
+        for (const auto &transaction : transactions)
+        {
+            ledger.append(transaction);
+        }
+        return ledger;
+    }
+
+    void Ledger::reserve(std::size_t rows)
+    {
+        m_dates.reserve(rows);
+        m_amounts.reserve(rows);
+        m_accountIds.reserve(rows);
+        m_currencyIds.reserve(rows);
+        m_categoryIds.reserve(rows);
+        m_subjectOffsets.reserve(rows + 1);
+    }
+
+    void Ledger::append(const Transaction &transaction)
+    {
+        m_dates.push_back(std::chrono::duration_cast<std::chrono::seconds>(
+                              transaction.date.time_since_epoch())
+                              .count());
+        m_amounts.push_back(transaction.amount);
+        m_accountIds.push_back(m_accounts.intern(transaction.account));
+        m_currencyIds.push_back(m_currencies.intern(transaction.currency));
+        m_categoryIds.push_back(m_categories.intern(transaction.category));
+        m_subjectArena += transaction.subject;
+        m_subjectOffsets.push_back(m_subjectArena.size());
+    }
+
+    std::size_t Ledger::size() const
+    {
+        return m_dates.size();
+    }
+
+    bool Ledger::empty() const
+    {
+        return m_dates.empty();
+    }
+
+    std::int64_t Ledger::date(std::size_t row) const
+    {
+        return m_dates[row];
+    }
+
+    std::int64_t Ledger::amount(std::size_t row) const
+    {
+        return m_amounts[row];
+    }
+
+    std::string_view Ledger::subject(std::size_t row) const
+    {
+        return std::string_view(m_subjectArena)
+            .substr(m_subjectOffsets[row], m_subjectOffsets[row + 1] - m_subjectOffsets[row]);
+    }
+
+    std::uint32_t Ledger::accountId(std::size_t row) const
+    {
+        return m_accountIds[row];
+    }
+
+    std::uint32_t Ledger::currencyId(std::size_t row) const
+    {
+        return m_currencyIds[row];
+    }
+
+    std::uint32_t Ledger::categoryId(std::size_t row) const
+    {
+        return m_categoryIds[row];
+    }
+
+    std::string_view Ledger::account(std::size_t row) const
+    {
+        return m_accounts.view(m_accountIds[row]);
+    }
+
+    std::string_view Ledger::currency(std::size_t row) const
+    {
+        return m_currencies.view(m_currencyIds[row]);
+    }
+
+    std::string_view Ledger::category(std::size_t row) const
+    {
+        return m_categories.view(m_categoryIds[row]);
+    }
+
+    const std::vector<std::int64_t> &Ledger::dates() const
+    {
+        return m_dates;
+    }
+
+    const std::vector<std::int64_t> &Ledger::amounts() const
+    {
+        return m_amounts;
+    }
+
+    const std::vector<std::uint32_t> &Ledger::accountIds() const
+    {
+        return m_accountIds;
+    }
+
+    const std::vector<std::uint32_t> &Ledger::currencyIds() const
+    {
+        return m_currencyIds;
+    }
+
+    const std::vector<std::uint32_t> &Ledger::categoryIds() const
+    {
+        return m_categoryIds;
+    }
+
+    const StringPool &Ledger::accounts() const
+    {
+        return m_accounts;
+    }
+
+    const StringPool &Ledger::currencies() const
+    {
+        return m_currencies;
+    }
+
+    const StringPool &Ledger::categories() const
+    {
+        return m_categories;
+    }
+
+    Transaction Ledger::transaction(std::size_t row) const
+    {
+        return Transaction{
+            std::string(account(row)),
+            std::string(subject(row)),
+            std::chrono::system_clock::time_point(std::chrono::seconds(m_dates[row])),
+            static_cast<int>(m_amounts[row]),
+            std::string(currency(row)),
+            std::string(category(row)),
+        };
+    }
+
+    std::string duplicateSubject(int originalRow, std::string_view subject)
+    {
+        std::string marked = "?dupof(" + std::to_string(originalRow) + ")";
+        if (!subject.empty())
+        {
+            marked += " ";
+            marked += subject;
+        }
+        return marked;
+    }
+}  // namespace sheet
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/sheet.hpp"
+
+namespace sheet
+{
+    // Hands out a dense id for every distinct string. Views stay valid for the pool's lifetime.
+    class StringPool
+    {
+      private:
+        // A deque never moves its elements, so the views keyed into m_ids stay valid
+        std::deque<std::string> m_strings;
+        std::unordered_map<std::string_view, std::uint32_t> m_ids;
+
+      public:
+        static constexpr std::uint32_t NONE = UINT32_MAX;
+
+        StringPool() = default;
+        StringPool(const StringPool &) = delete;
+        StringPool &operator=(const StringPool &) = delete;
+        StringPool(StringPool &&) = default;
+        StringPool &operator=(StringPool &&) = default;
+
+        std::uint32_t intern(std::string_view text);
+        // NONE when text was never interned
+        std::uint32_t find(std::string_view text) const;
+        std::string_view view(std::uint32_t id) const;
+        std::size_t size() const;
+    };
+
+    // The transactions of a sheet stored column by column.
+    //
+    // Accounts, currencies and categories are interned, so comparing or grouping them is an
+    // integer comparison. Subjects are kept back to back in a single arena. Dates are seconds
+    // since the epoch and amounts are int64 in the currency's smallest unit as written in the
+    // sheet. Row i is sheet row i + 2 when the ledger holds the whole sheet.
+    class Ledger
+    {
+      private:
+        std::vector<std::int64_t> m_dates;
+        std::vector<std::int64_t> m_amounts;
+        std::vector<std::uint32_t> m_accountIds;
+        std::vector<std::uint32_t> m_currencyIds;
+        std::vector<std::uint32_t> m_categoryIds;
+        std::string m_subjectArena;
+        // Subject of row i is m_subjectArena[m_subjectOffsets[i] .. m_subjectOffsets[i + 1])
+        std::vector<std::size_t> m_subjectOffsets;
+        StringPool m_accounts;
+        StringPool m_currencies;
+        StringPool m_categories;
+
+      public:
+        Ledger();
+
+        static Ledger fromTransactions(const std::vector<Transaction> &transactions);
+
+        void reserve(std::size_t rows);
+        void append(const Transaction &transaction);
+
+        std::size_t size() const;
+        bool empty() const;
+
+        std::int64_t date(std::size_t row) const;
+        std::int64_t amount(std::size_t row) const;
+        std::string_view subject(std::size_t row) const;
+        std::uint32_t accountId(std::size_t row) const;
+        std::uint32_t currencyId(std::size_t row) const;
+        std::uint32_t categoryId(std::size_t row) const;
+        std::string_view account(std::size_t row) const;
+        std::string_view currency(std::size_t row) const;
+        std::string_view category(std::size_t row) const;
+
+        // Whole columns, for loops that only touch one or two of them
+        const std::vector<std::int64_t> &dates() const;
+        const std::vector<std::int64_t> &amounts() const;
+        const std::vector<std::uint32_t> &accountIds() const;
+        const std::vector<std::uint32_t> &currencyIds() const;
+        const std::vector<std::uint32_t> &categoryIds() const;
+
+        const StringPool &accounts() const;
+        const StringPool &currencies() const;
+        const StringPool &categories() const;
+
+        // Copies row back out into a Transaction
+        Transaction transaction(std::size_t row) const;
+    };
+
+    // A change to one ledger row, referring to rows by index instead of copying them
+    struct RowEdit
+    {
+        enum class Kind
+        {
+            MARK_DUPLICATE,
+            SET_CATEGORY,
+        };
+
+        Kind kind;
+        std::uint32_t row;
+        // MARK_DUPLICATE: the row this one duplicates
+        std::uint32_t original;
+        // SET_CATEGORY: the new category; whatever it points into must outlive the edit
+        std::string_view category;
+    };
+
+    // Subject written to a row marked as a duplicate of sheet row originalRow
+    std::string duplicateSubject(int originalRow, std::string_view subject);
+}  // namespace sheet
@@ -0,0 +1,326 @@
+#include "lib/sheet/snapshot.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace sheet
+{
+    static const char SNAPSHOT_MAGIC[8] = {'N', 'E', 'G', 'I', 'S', 'N', 'A', 'P'};
+    static const std::uint32_t SNAPSHOT_FORMAT_VERSION = 1;
+    static const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    struct SnapshotHeader
+    {
+        char magic[8];
+        std::uint32_t formatVersion;
+        std::uint32_t byteOrderMark;
+        std::uint64_t rowCount;
+        std::uint64_t stringCount;
+        std::uint64_t stringBytes;
+        std::uint32_t sheetIdLength;
+        std::uint32_t revisionLength;
+    };
+    static_assert(sizeof(SnapshotHeader) == 48, "snapshot header must not be padded");
+
+    // Total file size for the counts in a header; the 8-byte columns come first so every
+    // column is naturally aligned in the mapping
+    static std::uint64_t expectedSize(const SnapshotHeader &header)
+    {
+        return sizeof(SnapshotHeader) + header.rowCount * sizeof(std::int64_t) +
+               (header.stringCount + 1) * sizeof(std::uint64_t) +
+               header.rowCount * sizeof(std::int32_t) +
+               4 * header.rowCount * sizeof(std::uint32_t) +
+               header.sheetIdLength + header.revisionLength + header.stringBytes;
+    }
+
+    Snapshot::Snapshot(const std::string &path)
+        : mp_data(nullptr), m_size(0), m_rowCount(0), m_stringCount(0), mp_dates(nullptr),
+          mp_stringOffsets(nullptr), mp_amounts(nullptr), mp_accounts(nullptr),
+          mp_subjects(nullptr), mp_currencies(nullptr), mp_categories(nullptr),
+          mp_strings(nullptr)
+    {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            throw std::runtime_error("failed to open snapshot " + path + ": " +
+                                     std::strerror(errno));
+        }
+
+        struct stat info = {};
+        if (fstat(fd, &info) != 0 ||
+            static_cast<std::size_t>(info.st_size) < sizeof(SnapshotHeader))
+        {
+            close(fd);
+            throw std::runtime_error("snapshot is truncated: " + path);
+        }
+
+        m_size = static_cast<std::size_t>(info.st_size);
+        void *mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            throw std::runtime_error("failed to map snapshot " + path + ": " +
+                                     std::strerror(errno));
+        }
+        mp_data = static_cast<const char *>(mapping);
+
+        try
+        {
+            validate();
+        }
+        catch (...)
+        {
+            munmap(const_cast<char *>(mp_data), m_size);
+            throw;
+        }
+    }
+
+    Snapshot::~Snapshot()
+    {
+        munmap(const_cast<char *>(mp_data), m_size);
+    }
+
+    void Snapshot::validate()
+    {
+        SnapshotHeader header;
+        std::memcpy(&header, mp_data, sizeof(header));
+        if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+            header.byteOrderMark != BYTE_ORDER_MARK)
+        {
+            throw std::runtime_error("not a ledger snapshot");
+        }
+        if (header.formatVersion != SNAPSHOT_FORMAT_VERSION)
+        {
+            throw std::runtime_error("unsupported snapshot version " +
+                                     std::to_string(header.formatVersion));
+        }
+        // Bounds the arithmetic in expectedSize() against a corrupt header
+        if (header.rowCount > m_size || header.stringCount > m_size ||
+            header.stringBytes > m_size || expectedSize(header) != m_size)
+        {
+            throw std::runtime_error("snapshot size does not match its row count");
+        }
+
+        m_rowCount = static_cast<std::size_t>(header.rowCount);
+        m_stringCount = static_cast<std::size_t>(header.stringCount);
+
+        const char *cursor = mp_data + sizeof(SnapshotHeader);
+        auto column = [&cursor](std::size_t count, std::size_t width)
+        {
+            const char *start = cursor;
+            cursor += count * width;
+            return start;
+        };
+        mp_dates = reinterpret_cast<const std::int64_t *>(column(m_rowCount, 8));
+        mp_stringOffsets = reinterpret_cast<const std::uint64_t *>(column(m_stringCount + 1, 8));
+        mp_amounts = reinterpret_cast<const std::int32_t *>(column(m_rowCount, 4));
+        mp_accounts = reinterpret_cast<const std::uint32_t *>(column(m_rowCount, 4));
+        mp_subjects = reinterpret_cast<const std::uint32_t *>(column(m_rowCount, 4));
+        mp_currencies = reinterpret_cast<const std::uint32_t *>(column(m_rowCount, 4));
+        mp_categories = reinterpret_cast<const std::uint32_t *>(column(m_rowCount, 4));
+        m_sheetId = std::string_view(column(header.sheetIdLength, 1), header.sheetIdLength);
+        m_revision = std::string_view(column(header.revisionLength, 1), header.revisionLength);
+        mp_strings = cursor;
+
+        // Checked once here so the accessors can index without bounds checks
+        if (mp_stringOffsets[0] != 0 || mp_stringOffsets[m_stringCount] != header.stringBytes)
+        {
+            throw std::runtime_error("snapshot string table is corrupt");
+        }
+        for (std::size_t i = 0; i < m_stringCount; ++i)
+        {
+            if (mp_stringOffsets[i] > mp_stringOffsets[i + 1])
+            {
+                throw std::runtime_error("snapshot string table is corrupt");
+            }
+        }
+        for (const std::uint32_t *ids : {mp_accounts, mp_subjects, mp_currencies, mp_categories})
+        {
+            for (std::size_t row = 0; row < m_rowCount; ++row)
+            {
+                if (ids[row] >= m_stringCount)
+                {
+                    throw std::runtime_error("snapshot refers to a missing string");
+                }
+            }
+        }
+    }
+
+    std::string_view Snapshot::sheetId() const
+    {
+        return m_sheetId;
+    }
+
+    std::string_view Snapshot::revision() const
+    {
+        return m_revision;
+    }
+
+    std::size_t Snapshot::rowCount() const
+    {
+        return m_rowCount;
+    }
+
+    std::string_view Snapshot::string(std::uint32_t id) const
+    {
+        if (id >= m_stringCount)
+        {
+            throw std::out_of_range("snapshot string id out of range");
+        }
+        std::uint64_t begin = mp_stringOffsets[id];
+        return std::string_view(mp_strings + begin,
+                                static_cast<std::size_t>(mp_stringOffsets[id + 1] - begin));
+    }
+
+    Transaction Snapshot::transaction(std::size_t row) const
+    {
+        if (row >= m_rowCount)
+        {
+            throw std::out_of_range("snapshot row out of range");
+        }
+        return Transaction{
+            std::string(string(mp_accounts[row])),
+            std::string(string(mp_subjects[row])),
+            std::chrono::system_clock::time_point(std::chrono::seconds(mp_dates[row])),
+            mp_amounts[row],
+            std::string(string(mp_currencies[row])),
+            std::string(string(mp_categories[row])),
+        };
+    }
+
+    std::vector<Transaction> Snapshot::transactions() const
+    {
+        std::vector<Transaction> result;
+        result.reserve(m_rowCount);
+        for (std::size_t row = 0; row < m_rowCount; ++row)
+        {
+            result.push_back(transaction(row));
+        }
+        return result;
+    }
+
+    void Snapshot::write(const std::string &path, const std::string &sheetId,
+                         const std::string &revision,
+                         const std::vector<Transaction> &transactions)
+    {
+        std::size_t rowCount = transactions.size();
+        std::vector<std::int64_t> dates(rowCount);
+        std::vector<std::int32_t> amounts(rowCount);
+        std::vector<std::uint32_t> accounts(rowCount);
+        std::vector<std::uint32_t> subjects(rowCount);
+        std::vector<std::uint32_t> currencies(rowCount);
+        std::vector<std::uint32_t> categories(rowCount);
+
+        // Views point into transactions, which outlive the table
+        std::unordered_map<std::string_view, std::uint32_t> ids;
+        std::vector<std::uint64_t> offsets = {0};
+        std::string strings;
+        auto intern = [&](const std::string &text)
+        {
+            auto inserted = ids.emplace(text, static_cast<std::uint32_t>(ids.size()));
+            if (inserted.second)
+            {
+                strings += text;
+                offsets.push_back(strings.size());
+            }
+            return inserted.first->second;
+        };
+
+        for (std::size_t row = 0; row < rowCount; ++row)
+        {
+            const Transaction &transaction = transactions[row];
+            dates[row] = std::chrono::duration_cast<std::chrono::seconds>(
+                             transaction.date.time_since_epoch())
+                             .count();
+            amounts[row] = transaction.amount;
+            accounts[row] = intern(transaction.account);
+            subjects[row] = intern(transaction.subject);
+            currencies[row] = intern(transaction.currency);
+            categories[row] = intern(transaction.category);
+        }
+
+        SnapshotHeader header = {};
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        header.formatVersion = SNAPSHOT_FORMAT_VERSION;
+        header.byteOrderMark = BYTE_ORDER_MARK;
+        header.rowCount = rowCount;
+        header.stringCount = ids.size();
+        header.stringBytes = strings.size();
+        header.sheetIdLength = static_cast<std::uint32_t>(sheetId.size());
+        header.revisionLength = static_cast<std::uint32_t>(revision.size());
+
+        std::string temporaryPath = path + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                throw std::runtime_error("failed to write snapshot: " + temporaryPath);
+            }
+
+            auto put = [&file](const void *data, std::size_t length)
+            { file.write(static_cast<const char *>(data), static_cast<std::streamsize>(length)); };
+            put(&header, sizeof(header));
+            put(dates.data(), rowCount * sizeof(std::int64_t));
+            put(offsets.data(), offsets.size() * sizeof(std::uint64_t));
+            put(amounts.data(), rowCount * sizeof(std::int32_t));
+            for (const auto *ids : {&accounts, &subjects, &currencies, &categories})
+            {
+                put(ids->data(), rowCount * sizeof(std::uint32_t));
+            }
+            put(sheetId.data(), sheetId.size());
+            put(revision.data(), revision.size());
+            put(strings.data(), strings.size());
+
+            file.flush();
+            if (!file)
+            {
+                throw std::runtime_error("failed to write snapshot: " + temporaryPath);
+            }
+        }
+
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporaryPath.c_str());
+            throw std::runtime_error("failed to replace snapshot: " + path);
+        }
+    }
+
+    std::vector<Transaction> loadTransactions(ClientInterface &client, const std::string &sheetId,
+                                              const std::string &snapshotPath)
+    {
+        // Asked before fetching, so an edit made during the download invalidates the snapshot
+        std::string revision = client.getRevision();
+
+        try
+        {
+            Snapshot snapshot(snapshotPath);
+            if (snapshot.sheetId() == sheetId && snapshot.revision() == revision)
+            {
+                return snapshot.transactions();
+            }
+        }
+        catch (const std::runtime_error &)
+        {
+            // Missing or unreadable; fetch and replace it
+        }
+
+        std::vector<Transaction> transactions = client.getTransactions();
+        try
+        {
+            Snapshot::write(snapshotPath, sheetId, revision, transactions);
+        }
+        catch (const std::runtime_error &)
+        {
+            // The snapshot is only a cache
+        }
+        return transactions;
+    }
+}  // namespace sheet
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lib/sheet.hpp"
+
+namespace sheet
+{
+    // Read-only view of a ledger snapshot file, mapped into memory.
+    //
+    // The file is columnar: after a fixed header come the dates (int64 seconds since the
+    // epoch), the string table offsets, the amounts, then one column of string ids each for
+    // account, subject, currency and category, and finally the sheet id, revision and string
+    // bytes. Every distinct string is stored once. Integers are in host byte order; a file
+    // written on a host with a different byte order is rejected.
+    class Snapshot
+    {
+      private:
+        const char *mp_data;
+        std::size_t m_size;
+        std::size_t m_rowCount;
+        std::size_t m_stringCount;
+        std::string_view m_sheetId;
+        std::string_view m_revision;
+        const std::int64_t *mp_dates;
+        const std::uint64_t *mp_stringOffsets;
+        const std::int32_t *mp_amounts;
+        const std::uint32_t *mp_accounts;
+        const std::uint32_t *mp_subjects;
+        const std::uint32_t *mp_currencies;
+        const std::uint32_t *mp_categories;
+        const char *mp_strings;
+
+        void validate();
+
+      public:
+        // Throws std::runtime_error when the file is missing, truncated or not a snapshot
+        explicit Snapshot(const std::string &path);
+        ~Snapshot();
+
+        Snapshot(const Snapshot &) = delete;
+        Snapshot &operator=(const Snapshot &) = delete;
+
+        std::string_view sheetId() const;
+        // Drive revision of the spreadsheet when the snapshot was taken
+        std::string_view revision() const;
+        std::size_t rowCount() const;
+
+        std::string_view string(std::uint32_t id) const;
+        Transaction transaction(std::size_t row) const;
+        std::vector<Transaction> transactions() const;
+
+        // Replaces the file at path atomically
+        static void write(const std::string &path, const std::string &sheetId,
+                          const std::string &revision,
+                          const std::vector<Transaction> &transactions);
+    };
+
+    // All transactions of the client's sheet. They come from the snapshot at snapshotPath
+    // when it was taken at the sheet's current revision; otherwise they are fetched and the
+    // snapshot is rewritten (failing to write it is not an error).
+    std::vector<Transaction> loadTransactions(ClientInterface &client, const std::string &sheetId,
+                                              const std::string &snapshotPath);
+}  // namespace sheet
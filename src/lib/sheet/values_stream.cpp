@@ -0,0 +1,432 @@
+#include "lib/sheet/values_stream.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+
+namespace sheet
+{
+    static bool isWhitespace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    static bool isNumberChar(char c)
+    {
+        return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+    }
+
+    static int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9')
+        {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f')
+        {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F')
+        {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    ValuesStreamParser::ValuesStreamParser(RowCallback onRow)
+        : m_onRow(std::move(onRow)), m_expect(Expect::VALUE), m_token(Token::NONE),
+          m_keepText(false), m_readingKey(false), m_escaped(false), m_unicodeDigits(0),
+          m_codepoint(0), m_highSurrogate(0), m_inValues(false), m_inRow(false), m_rowCount(0),
+          m_offset(0)
+    {
+    }
+
+    void ValuesStreamParser::feed(const char *data, std::size_t length)
+    {
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            step(data[i]);
+            ++m_offset;
+        }
+    }
+
+    void ValuesStreamParser::finish()
+    {
+        // A bare top-level number has nothing after it to end it
+        if (m_token == Token::NUMBER || m_token == Token::LITERAL)
+        {
+            step(' ');
+        }
+        if (m_expect != Expect::DONE)
+        {
+            fail("unexpected end of document");
+        }
+    }
+
+    std::size_t ValuesStreamParser::rowCount() const
+    {
+        return m_rowCount;
+    }
+
+    void ValuesStreamParser::fail(const char *reason) const
+    {
+        throw std::runtime_error(std::string("malformed values response at byte ") +
+                                 std::to_string(m_offset) + ": " + reason);
+    }
+
+    void ValuesStreamParser::step(char c)
+    {
+        switch (m_token)
+        {
+            case Token::STRING:
+                stringChar(c);
+                return;
+            case Token::NUMBER:
+                if (isNumberChar(c))
+                {
+                    m_text += c;
+                    return;
+                }
+                {
+                    char *end = nullptr;
+                    std::strtod(m_text.c_str(), &end);
+                    if (end != m_text.c_str() + m_text.size())
+                    {
+                        fail("invalid number");
+                    }
+                }
+                endScalar(Cell::Type::NUMBER);
+                break;
+            case Token::LITERAL:
+                if (c >= 'a' && c <= 'z')
+                {
+                    m_text += c;
+                    return;
+                }
+                if (m_text == "null")
+                {
+                    m_text.clear();
+                    endScalar(Cell::Type::EMPTY);
+                }
+                else if (m_text == "true" || m_text == "false")
+                {
+                    endScalar(Cell::Type::BOOLEAN);
+                }
+                else
+                {
+                    fail("invalid literal");
+                }
+                break;
+            case Token::NONE:
+                break;
+        }
+
+        // The character that ended a number or literal still needs handling
+        if (isWhitespace(c))
+        {
+            return;
+        }
+
+        switch (m_expect)
+        {
+            case Expect::VALUE:
+                startValue(c);
+                return;
+            case Expect::VALUE_OR_END:
+                if (c == ']')
+                {
+                    closeContainer(c);
+                    return;
+                }
+                startValue(c);
+                return;
+            case Expect::KEY_OR_END:
+                if (c == '}')
+                {
+                    closeContainer(c);
+                    return;
+                }
+                [[fallthrough]];
+            case Expect::KEY:
+                if (c != '"')
+                {
+                    fail("expected a key");
+                }
+                m_token = Token::STRING;
+                m_readingKey = true;
+                m_keepText = m_containers.size() == 1;
+                m_text.clear();
+                return;
+            case Expect::COLON:
+                if (c != ':')
+                {
+                    fail("expected ':'");
+                }
+                m_expect = Expect::VALUE;
+                return;
+            case Expect::COMMA_OR_END:
+                if (c == ',')
+                {
+                    m_expect = m_containers.back() == '{' ? Expect::KEY : Expect::VALUE;
+                    return;
+                }
+                if (c == '}' || c == ']')
+                {
+                    closeContainer(c);
+                    return;
+                }
+                fail("expected ',' or a closing bracket");
+            case Expect::DONE:
+                fail("data after the end of the document");
+        }
+    }
+
+    void ValuesStreamParser::startValue(char c)
+    {
+        if (c == '{' || c == '[')
+        {
+            openContainer(c);
+            return;
+        }
+
+        m_text.clear();
+        if (c == '"')
+        {
+            m_token = Token::STRING;
+            m_readingKey = false;
+            m_keepText = m_inRow && m_containers.size() == 3;
+        }
+        else if (c == '-' || (c >= '0' && c <= '9'))
+        {
+            m_token = Token::NUMBER;
+            m_text += c;
+        }
+        else if (c == 't' || c == 'f' || c == 'n')
+        {
+            m_token = Token::LITERAL;
+            m_text += c;
+        }
+        else
+        {
+            fail("expected a value");
+        }
+    }
+
+    void ValuesStreamParser::stringChar(char c)
+    {
+        if (m_unicodeDigits > 0)
+        {
+            int value = hexValue(c);
+            if (value < 0)
+            {
+                fail("invalid \\u escape");
+            }
+            m_codepoint = m_codepoint * 16 + static_cast<unsigned>(value);
+            if (--m_unicodeDigits == 0)
+            {
+                appendCodepoint(m_codepoint);
+            }
+            return;
+        }
+
+        if (m_escaped)
+        {
+            m_escaped = false;
+            char decoded = 0;
+            switch (c)
+            {
+                case '"':
+                case '\\':
+                case '/':
+                    decoded = c;
+                    break;
+                case 'b':
+                    decoded = '\b';
+                    break;
+                case 'f':
+                    decoded = '\f';
+                    break;
+                case 'n':
+                    decoded = '\n';
+                    break;
+                case 'r':
+                    decoded = '\r';
+                    break;
+                case 't':
+                    decoded = '\t';
+                    break;
+                case 'u':
+                    m_unicodeDigits = 4;
+                    m_codepoint = 0;
+                    return;
+                default:
+                    fail("invalid escape");
+            }
+            appendCodepoint(static_cast<unsigned char>(decoded));
+            return;
+        }
+
+        if (c == '\\')
+        {
+            m_escaped = true;
+            return;
+        }
+        if (c == '"')
+        {
+            endString();
+            return;
+        }
+        if (static_cast<unsigned char>(c) < 0x20)
+        {
+            fail("control character in string");
+        }
+
+        if (m_highSurrogate != 0)
+        {
+            m_highSurrogate = 0;
+            appendCodepoint(0xFFFD);
+        }
+        if (m_keepText)
+        {
+            m_text += c;
+        }
+    }
+
+    void ValuesStreamParser::appendCodepoint(unsigned codepoint)
+    {
+        if (codepoint >= 0xD800 && codepoint <= 0xDBFF)
+        {
+            if (m_highSurrogate != 0)
+            {
+                m_highSurrogate = 0;
+                appendCodepoint(0xFFFD);
+            }
+            m_highSurrogate = codepoint;
+            return;
+        }
+        if (codepoint >= 0xDC00 && codepoint <= 0xDFFF)
+        {
+            codepoint = m_highSurrogate != 0
+                            ? 0x10000 + ((m_highSurrogate - 0xD800) << 10) + (codepoint - 0xDC00)
+                            : 0xFFFD;
+            m_highSurrogate = 0;
+        }
+        else if (m_highSurrogate != 0)
+        {
+            // A lone high surrogate
+            m_highSurrogate = 0;
+            appendCodepoint(0xFFFD);
+        }
+
+        if (!m_keepText)
+        {
+            return;
+        }
+        if (codepoint < 0x80)
+        {
+            m_text += static_cast<char>(codepoint);
+        }
+        else if (codepoint < 0x800)
+        {
+            m_text += static_cast<char>(0xC0 | (codepoint >> 6));
+            m_text += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+        else if (codepoint < 0x10000)
+        {
+            m_text += static_cast<char>(0xE0 | (codepoint >> 12));
+            m_text += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            m_text += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+        else
+        {
+            m_text += static_cast<char>(0xF0 | (codepoint >> 18));
+            m_text += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+            m_text += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            m_text += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+    }
+
+    void ValuesStreamParser::endString()
+    {
+        if (m_highSurrogate != 0)
+        {
+            m_highSurrogate = 0;
+            appendCodepoint(0xFFFD);
+        }
+
+        if (m_readingKey)
+        {
+            m_token = Token::NONE;
+            if (m_containers.size() == 1)
+            {
+                m_topLevelKey = m_text;
+            }
+            m_expect = Expect::COLON;
+            return;
+        }
+        endScalar(Cell::Type::STRING);
+    }
+
+    void ValuesStreamParser::endScalar(Cell::Type type)
+    {
+        m_token = Token::NONE;
+        if (m_inRow && m_containers.size() == 3)
+        {
+            Cell cell;
+            cell.type = type;
+            cell.text = std::move(m_text);
+            m_row.push_back(std::move(cell));
+        }
+        m_text.clear();
+        afterValue();
+    }
+
+    void ValuesStreamParser::openContainer(char c)
+    {
+        std::size_t depth = m_containers.size();
+        if (depth == 1 && m_containers.front() == '{' && c == '[' && m_topLevelKey == "values")
+        {
+            m_inValues = true;
+        }
+        else if (depth == 2 && m_inValues && c == '[')
+        {
+            m_inRow = true;
+            m_row.clear();
+        }
+        else if (depth == 3 && m_inRow)
+        {
+            // Sheets never nests anything in a row; keep the column count right regardless
+            m_row.emplace_back();
+        }
+
+        m_containers.push_back(c);
+        m_expect = c == '{' ? Expect::KEY_OR_END : Expect::VALUE_OR_END;
+    }
+
+    void ValuesStreamParser::closeContainer(char c)
+    {
+        char opener = c == '}' ? '{' : '[';
+        if (m_containers.empty() || m_containers.back() != opener)
+        {
+            fail("mismatched bracket");
+        }
+        m_containers.pop_back();
+
+        std::size_t depth = m_containers.size();
+        if (depth == 2 && m_inRow)
+        {
+            m_inRow = false;
+            ++m_rowCount;
+            m_onRow(m_row);
+        }
+        else if (depth == 1 && m_inValues)
+        {
+            m_inValues = false;
+        }
+        afterValue();
+    }
+
+    void ValuesStreamParser::afterValue()
+    {
+        m_expect = m_containers.empty() ? Expect::DONE : Expect::COMMA_OR_END;
+    }
+}  // namespace sheet
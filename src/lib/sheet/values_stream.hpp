@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sheet
+{
+    // Push parser for a Sheets API ValueRange response ({"range": ..., "values": [[...]]}).
+    //
+    // Bytes can be fed in arbitrarily sized pieces as they arrive; the callback is invoked
+    // with the cells of each row of "values" as soon as that row's closing bracket is seen.
+    // Only the row being parsed is held in memory. Other members are validated and skipped.
+    class ValuesStreamParser
+    {
+      public:
+        struct Cell
+        {
+            enum class Type
+            {
+                EMPTY,
+                STRING,
+                NUMBER,
+                BOOLEAN,
+            };
+
+            Type type = Type::EMPTY;
+            // Decoded string, or the number/boolean exactly as written in the JSON
+            std::string text;
+        };
+
+        using RowCallback = std::function<void(const std::vector<Cell> &cells)>;
+
+        explicit ValuesStreamParser(RowCallback onRow);
+
+        // Throws std::runtime_error on malformed JSON
+        void feed(const char *data, std::size_t length);
+        // Throws std::runtime_error when the document is incomplete
+        void finish();
+
+        std::size_t rowCount() const;
+
+      private:
+        enum class Token
+        {
+            NONE,
+            STRING,
+            NUMBER,
+            LITERAL,
+        };
+
+        enum class Expect
+        {
+            VALUE,
+            VALUE_OR_END,
+            KEY,
+            KEY_OR_END,
+            COLON,
+            COMMA_OR_END,
+            DONE,
+        };
+
+        RowCallback m_onRow;
+        std::vector<char> m_containers;
+        Expect m_expect;
+        Token m_token;
+        std::string m_text;
+        bool m_keepText;
+        bool m_readingKey;
+        bool m_escaped;
+        int m_unicodeDigits;
+        unsigned m_codepoint;
+        unsigned m_highSurrogate;
+        std::string m_topLevelKey;
+        bool m_inValues;
+        bool m_inRow;
+        std::vector<Cell> m_row;
+        std::size_t m_rowCount;
+        std::size_t m_offset;
+
+        void step(char c);
+        void startValue(char c);
+        void stringChar(char c);
+        void appendCodepoint(unsigned codepoint);
+        void endString();
+        void endScalar(Cell::Type type);
+        void openContainer(char c);
+        void closeContainer(char c);
+        void afterValue();
+        [[noreturn]] void fail(const char *reason) const;
+    };
+}  // namespace sheet
@@ -0,0 +1,322 @@
+#include "lib/sheet/write_queue.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace sheet
+{
+    static nlohmann::json toJournalEntry(const Transaction &transaction)
+    {
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(
+                           transaction.date.time_since_epoch())
+                           .count();
+        return {
+            {"account", transaction.account},
+            {"subject", transaction.subject},
+            {"date", seconds},
+            {"amount", transaction.amount},
+            {"currency", transaction.currency},
+            {"category", transaction.category},
+        };
+    }
+
+    static Transaction fromJournalEntry(const nlohmann::json &entry)
+    {
+        Transaction transaction;
+        entry.at("account").get_to(transaction.account);
+        entry.at("subject").get_to(transaction.subject);
+        transaction.date = std::chrono::system_clock::time_point(
+            std::chrono::seconds(entry.at("date").get<long long>()));
+        entry.at("amount").get_to(transaction.amount);
+        entry.at("currency").get_to(transaction.currency);
+        entry.at("category").get_to(transaction.category);
+        return transaction;
+    }
+
+    static void writeAll(int fd, const std::string &data)
+    {
+        std::size_t offset = 0;
+        while (offset < data.size())
+        {
+            ssize_t written = write(fd, data.data() + offset, data.size() - offset);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::runtime_error("error writing journal");
+            }
+            offset += static_cast<std::size_t>(written);
+        }
+    }
+
+    static int openJournal(const std::string &path)
+    {
+        int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+        if (fd < 0)
+        {
+            throw std::runtime_error("error opening journal " + path);
+        }
+        return fd;
+    }
+
+    WriteBehindQueue::WriteBehindQueue(std::shared_ptr<ClientInterface> p_client,
+                                       std::string journalPath)
+        : mp_client(std::move(p_client)), m_journalPath(std::move(journalPath)), m_journalFd(-1),
+          m_batchSize(50), m_maxBatchSize(500), m_flushDelay(std::chrono::seconds(2)),
+          m_initialBackoff(std::chrono::seconds(1)), m_maxBackoff(std::chrono::minutes(1)),
+          m_stopping(false)
+    {
+        if (mp_client == nullptr)
+        {
+            throw std::runtime_error("client is null");
+        }
+    }
+
+    WriteBehindQueue::~WriteBehindQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        if (m_flusher.joinable())
+        {
+            m_flusher.join();
+        }
+        if (m_journalFd >= 0)
+        {
+            close(m_journalFd);
+        }
+    }
+
+    void WriteBehindQueue::setBatchSize(std::size_t batchSize, std::size_t maxBatchSize)
+    {
+        if (batchSize == 0 || maxBatchSize < batchSize)
+        {
+            throw std::runtime_error("invalid batch size");
+        }
+        m_batchSize = batchSize;
+        m_maxBatchSize = maxBatchSize;
+    }
+
+    void WriteBehindQueue::setFlushDelay(std::chrono::milliseconds flushDelay)
+    {
+        m_flushDelay = flushDelay;
+    }
+
+    void WriteBehindQueue::setRetryBackoff(std::chrono::milliseconds initialBackoff,
+                                           std::chrono::milliseconds maxBackoff)
+    {
+        m_initialBackoff = initialBackoff;
+        m_maxBackoff = std::max(initialBackoff, maxBackoff);
+    }
+
+    void WriteBehindQueue::start()
+    {
+        if (m_flusher.joinable())
+        {
+            throw std::runtime_error("write queue already started");
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        replayJournal();
+        m_flusher = std::thread(&WriteBehindQueue::flusherLoop, this);
+    }
+
+    void WriteBehindQueue::replayJournal()
+    {
+        std::ifstream journal(m_journalPath);
+        std::string line;
+        while (std::getline(journal, line))
+        {
+            if (line.empty())
+            {
+                continue;
+            }
+            try
+            {
+                m_pending.push_back(fromJournalEntry(nlohmann::json::parse(line)));
+            }
+            catch (const std::exception &e)
+            {
+                // Most likely a line cut short by a crash mid-write; it was never acknowledged
+                std::cerr << "Skipping unreadable journal entry: " << e.what() << std::endl;
+            }
+        }
+
+        if (!m_pending.empty())
+        {
+            std::cout << "Replaying " << m_pending.size() << " journaled transactions"
+                      << std::endl;
+        }
+        m_queuedAt.assign(m_pending.size(), std::chrono::steady_clock::now());
+
+        // Start from a clean journal holding exactly what is pending
+        rewriteJournal();
+    }
+
+    void WriteBehindQueue::rewriteJournal()
+    {
+        std::string contents;
+        for (const auto &transaction : m_pending)
+        {
+            contents += toJournalEntry(transaction).dump() + "\n";
+        }
+
+        std::string tempPath = m_journalPath + ".tmp";
+        int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0)
+        {
+            throw std::runtime_error("error opening journal " + tempPath);
+        }
+        try
+        {
+            writeAll(fd, contents);
+        }
+        catch (...)
+        {
+            close(fd);
+            throw;
+        }
+        if (fdatasync(fd) < 0 || close(fd) < 0)
+        {
+            throw std::runtime_error("error syncing journal " + tempPath);
+        }
+        if (rename(tempPath.c_str(), m_journalPath.c_str()) < 0)
+        {
+            throw std::runtime_error("error replacing journal " + m_journalPath);
+        }
+
+        if (m_journalFd >= 0)
+        {
+            close(m_journalFd);
+            m_journalFd = -1;
+        }
+        m_journalFd = openJournal(m_journalPath);
+    }
+
+    void WriteBehindQueue::enqueue(const Transaction &transaction)
+    {
+        std::string line = toJournalEntry(transaction).dump() + "\n";
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_journalFd < 0)
+            {
+                throw std::runtime_error("journal is not open");
+            }
+
+            writeAll(m_journalFd, line);
+            if (fdatasync(m_journalFd) < 0)
+            {
+                throw std::runtime_error("error syncing journal " + m_journalPath);
+            }
+
+            m_pending.push_back(transaction);
+            m_queuedAt.push_back(std::chrono::steady_clock::now());
+        }
+        m_condition.notify_all();
+    }
+
+    std::size_t WriteBehindQueue::pendingCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_pending.size();
+    }
+
+    void WriteBehindQueue::flusherLoop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto backoff = m_initialBackoff;
+        auto retryAt = std::chrono::steady_clock::now();
+
+        while (!m_stopping)
+        {
+            // Due once enough is queued or the oldest entry has waited long enough, but never
+            // before a failed append has backed off
+            auto dueAt = std::chrono::steady_clock::time_point::max();
+            if (!m_pending.empty())
+            {
+                bool full = m_pending.size() >= m_batchSize;
+                dueAt = full ? retryAt : std::max(retryAt, m_queuedAt.front() + m_flushDelay);
+            }
+
+            if (std::chrono::steady_clock::now() < dueAt)
+            {
+                std::size_t waiting = m_pending.size();
+                m_condition.wait_until(lock, dueAt,
+                                       [this, waiting]
+                                       { return m_stopping || m_pending.size() != waiting; });
+                continue;
+            }
+
+            if (sendBatch(lock))
+            {
+                backoff = m_initialBackoff;
+                retryAt = std::chrono::steady_clock::now();
+            }
+            else
+            {
+                retryAt = std::chrono::steady_clock::now() + backoff;
+                backoff = std::min(backoff * 2, m_maxBackoff);
+            }
+        }
+
+        // One last attempt on shutdown; whatever fails stays journaled for the next start
+        if (!m_pending.empty())
+        {
+            sendBatch(lock);
+        }
+    }
+
+    bool WriteBehindQueue::sendBatch(std::unique_lock<std::mutex> &lock)
+    {
+        std::size_t count = std::min(m_pending.size(), m_maxBatchSize);
+        std::vector<Transaction> batch(m_pending.begin(),
+                                       m_pending.begin() + static_cast<std::ptrdiff_t>(count));
+
+        // Keep accepting submissions while the append is in flight
+        lock.unlock();
+        bool sent = false;
+        try
+        {
+            mp_client->addTransactions(batch);
+            sent = true;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error appending " << count << " transactions: " << e.what()
+                      << std::endl;
+        }
+        lock.lock();
+
+        if (!sent)
+        {
+            return false;
+        }
+
+        // Anything queued meanwhile sits behind the batch, so it is still a prefix. What is
+        // left keeps the time it was queued at rather than waiting a full delay again
+        m_pending.erase(m_pending.begin(), m_pending.begin() + static_cast<std::ptrdiff_t>(count));
+        m_queuedAt.erase(m_queuedAt.begin(),
+                         m_queuedAt.begin() + static_cast<std::ptrdiff_t>(count));
+        try
+        {
+            rewriteJournal();
+        }
+        catch (const std::exception &e)
+        {
+            // The old journal is still in place; the batch may be sent again after a restart
+            std::cerr << "Error compacting journal: " << e.what() << std::endl;
+        }
+        return true;
+    }
+}  // namespace sheet
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lib/sheet.hpp"
+
+namespace sheet
+{
+    // Write-behind queue for appending transactions.
+    //
+    // enqueue() appends the transaction to a JSON-lines journal and fdatasyncs it before
+    // returning, so an acknowledged transaction survives a crash. A background thread groups
+    // queued transactions into one addTransactions() call once batchSize are waiting or the
+    // oldest has waited flushDelay, retrying failures with exponential backoff. Sent
+    // transactions are dropped from the journal; anything left in it is replayed by start().
+    // Delivery is at-least-once: a crash between a successful append and the journal rewrite
+    // sends that batch again.
+    class WriteBehindQueue
+    {
+      private:
+        std::shared_ptr<ClientInterface> mp_client;
+        std::string m_journalPath;
+        int m_journalFd;
+
+        std::size_t m_batchSize;
+        std::size_t m_maxBatchSize;
+        std::chrono::milliseconds m_flushDelay;
+        std::chrono::milliseconds m_initialBackoff;
+        std::chrono::milliseconds m_maxBackoff;
+
+        std::vector<Transaction> m_pending;
+        // When each pending transaction was queued, in the same order
+        std::vector<std::chrono::steady_clock::time_point> m_queuedAt;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_condition;
+        std::thread m_flusher;
+        bool m_stopping;
+
+        void replayJournal();
+        void rewriteJournal();
+        void flusherLoop();
+        bool sendBatch(std::unique_lock<std::mutex> &lock);
+
+      public:
+        WriteBehindQueue(std::shared_ptr<ClientInterface> p_client, std::string journalPath);
+        ~WriteBehindQueue();
+
+        WriteBehindQueue(const WriteBehindQueue &) = delete;
+        WriteBehindQueue &operator=(const WriteBehindQueue &) = delete;
+
+        // Settings are read by start(); change them before calling it
+        void setBatchSize(std::size_t batchSize, std::size_t maxBatchSize = 500);
+        void setFlushDelay(std::chrono::milliseconds flushDelay);
+        void setRetryBackoff(std::chrono::milliseconds initialBackoff,
+                             std::chrono::milliseconds maxBackoff);
+
+        // Loads transactions left in the journal and starts the flusher thread
+        void start();
+        void enqueue(const Transaction &transaction);
+        std::size_t pendingCount() const;
+    };
+}  // namespace sheet
@@ -1,5 +1,6 @@
 #include "categorizer.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <fstream>
 #include <map>
@@ -71,42 +72,96 @@ namespace marksman
 
     std::vector<sheet::TransactionRow>
     matchSubjectToCategories(const std::vector<sheet::Transaction> &transactions,
-                             const std::map<std::string, std::string> &categoryMap)
+                             const std::map<std::string, std::string> &categoryMap,
+                             int firstRow)
     {
+        return matchSubjectToCategories(transactions, CategoryMatcher(categoryMap), firstRow);
+    }
+
+    std::vector<sheet::TransactionRow>
+    matchSubjectToCategories(const std::vector<sheet::Transaction> &transactions,
+                             const CategoryMatcher &matcher, int firstRow)
+    {
+        sheet::Ledger ledger = sheet::Ledger::fromTransactions(transactions);
+
         std::vector<sheet::TransactionRow> matchedValues;
+        for (const auto &edit : matchSubjectToCategories(ledger, matcher))
+        {
+            auto mutableTrx = std::make_shared<sheet::Transaction>(transactions[edit.row]);
+            mutableTrx->category = std::string(edit.category);
+            matchedValues.push_back({mutableTrx, static_cast<int>(edit.row) + firstRow});
+        }
+        return matchedValues;
+    }
 
-        int rowNumber = 2;  // Start from row 2 (A2)
-        for (const auto &trx : transactions)
+    // Appends the edits for rows [begin, end) to matchedValues
+    static void matchRows(const sheet::Ledger &ledger, const CategoryMatcher &matcher,
+                          std::size_t begin, std::size_t end,
+                          std::vector<sheet::RowEdit> &matchedValues)
+    {
+        // Rows that already have a category are skipped with one integer comparison
+        std::uint32_t uncategorized = ledger.categories().find("");
+        for (std::size_t row = begin; row < end; ++row)
         {
-            // Skip if already has category or no subject
-            if (trx.subject.empty() || !trx.category.empty())
+            std::string_view subject = ledger.subject(row);
+            if (subject.empty() || ledger.categoryId(row) != uncategorized)
             {
-                rowNumber++;
                 continue;
             }
 
-            auto mutableTrx = std::make_shared<sheet::Transaction>(trx);
-            for (const auto &pair : categoryMap)
-            {
-                const std::string &keyword = pair.first;
-                const std::string &category = pair.second;
-
-                if (mutableTrx->subject.find(keyword) != std::string::npos)
-                {
-                    mutableTrx->category = category;
-                    break;
-                }
-            }
-
             // Only include if a match was found
-            if (!mutableTrx->category.empty())
+            const std::string *category = matcher.match(subject);
+            if (category != nullptr && !category->empty())
             {
-                matchedValues.push_back({mutableTrx, rowNumber});
+                matchedValues.push_back({sheet::RowEdit::Kind::SET_CATEGORY,
+                                         static_cast<std::uint32_t>(row), 0, *category});
             }
+        }
+    }
+
+    std::vector<sheet::RowEdit> matchSubjectToCategories(const sheet::Ledger &ledger,
+                                                         const CategoryMatcher &matcher)
+    {
+        std::vector<sheet::RowEdit> matchedValues;
+        matchRows(ledger, matcher, 0, ledger.size(), matchedValues);
+        return matchedValues;
+    }
 
-            rowNumber++;
+    std::vector<sheet::RowEdit> matchSubjectToCategories(const sheet::Ledger &ledger,
+                                                         const CategoryMatcher &matcher,
+                                                         concurrency::ThreadPool &pool,
+                                                         std::size_t chunkRows)
+    {
+        std::size_t rows = ledger.size();
+        std::size_t chunkCount = chunkRows == 0 ? 1 : (rows + chunkRows - 1) / chunkRows;
+        if (chunkCount <= 1 || pool.threadCount() == 1)
+        {
+            return matchSubjectToCategories(ledger, matcher);
         }
 
+        // Chunks are contiguous row ranges, each with its own output, so workers share
+        // nothing but the read-only ledger and matcher
+        std::vector<std::vector<sheet::RowEdit>> chunkResults(chunkCount);
+        pool.parallelFor(chunkCount,
+                         [&ledger, &matcher, rows, chunkRows, &chunkResults](std::size_t chunk)
+                         {
+                             std::size_t begin = chunk * chunkRows;
+                             std::size_t end = std::min(begin + chunkRows, rows);
+                             matchRows(ledger, matcher, begin, end, chunkResults[chunk]);
+                         });
+
+        // Chunks are in row order, so concatenating them keeps the edits in row order
+        std::size_t total = 0;
+        for (const auto &chunk : chunkResults)
+        {
+            total += chunk.size();
+        }
+        std::vector<sheet::RowEdit> matchedValues;
+        matchedValues.reserve(total);
+        for (const auto &chunk : chunkResults)
+        {
+            matchedValues.insert(matchedValues.end(), chunk.begin(), chunk.end());
+        }
         return matchedValues;
     }
 }  // namespace marksman
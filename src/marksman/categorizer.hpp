@@ -4,7 +4,11 @@
 #include <string>
 #include <vector>
 
+#include "lib/concurrency/thread_pool.hpp"
 #include "lib/sheet.hpp"
+#include "lib/sheet/ledger.hpp"
+
+#include "category_matcher.hpp"
 
 namespace marksman
 {
@@ -12,5 +16,21 @@ namespace marksman
     std::map<std::string, std::string> parseCategoryMap(const std::string &csvContent);
     std::vector<sheet::TransactionRow>
     matchSubjectToCategories(const std::vector<sheet::Transaction> &transactions,
-                             const std::map<std::string, std::string> &categoryMap);
+                             const std::map<std::string, std::string> &categoryMap,
+                             int firstRow = 2);
+    // Same, with a matcher compiled once up front; see CategoryMatcher for which keyword
+    // wins when several occur in a subject. transactions[0] is sheet row firstRow.
+    std::vector<sheet::TransactionRow>
+    matchSubjectToCategories(const std::vector<sheet::Transaction> &transactions,
+                             const CategoryMatcher &matcher, int firstRow = 2);
+    // One SET_CATEGORY edit per uncategorized row whose subject matches. The edits point
+    // into matcher, which has to outlive them.
+    std::vector<sheet::RowEdit> matchSubjectToCategories(const sheet::Ledger &ledger,
+                                                         const CategoryMatcher &matcher);
+    // Same, with the rows split into chunks of about chunkRows that are matched on pool. The
+    // result is identical to the sequential one, in row order.
+    std::vector<sheet::RowEdit> matchSubjectToCategories(const sheet::Ledger &ledger,
+                                                         const CategoryMatcher &matcher,
+                                                         concurrency::ThreadPool &pool,
+                                                         std::size_t chunkRows = 8192);
 }  // namespace marksman
@@ -0,0 +1,333 @@
+#include "category_map_cache.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "categorizer.hpp"
+
+namespace marksman
+{
+    static const char CACHE_MAGIC[8] = {'N', 'E', 'G', 'I', 'C', 'M', 'A', 'P'};
+    static const std::uint32_t CACHE_FORMAT_VERSION = 1;
+
+    struct CacheHeader
+    {
+        char magic[8];
+        std::uint32_t formatVersion;
+        std::uint32_t reserved;
+        std::uint64_t csvSize;
+        std::int64_t csvMtimeNs;
+        std::uint64_t csvHash;
+    };
+    static_assert(sizeof(CacheHeader) == 40, "cache header must not be padded");
+
+    static std::uint64_t contentHash(const std::string &content)
+    {
+        std::uint64_t hash = 14695981039346656037ULL;
+        for (char c : content)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    static std::string readFile(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Could not open category map file: " + path);
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        return buffer.str();
+    }
+
+    CategoryMapCache::CategoryMapCache(std::string csvPath, std::string cachePath)
+        : m_csvPath(std::move(csvPath)), m_cachePath(std::move(cachePath)),
+          m_lastSource(Source::NONE), m_inotifyFd(-1), m_stopFd(-1)
+    {
+    }
+
+    CategoryMapCache::~CategoryMapCache()
+    {
+        if (m_watcher.joinable())
+        {
+            std::uint64_t one = 1;
+            if (write(m_stopFd, &one, sizeof(one)) < 0)
+            {
+                std::cerr << "Failed to stop category map watcher: " << std::strerror(errno)
+                          << std::endl;
+            }
+            m_watcher.join();
+        }
+        if (m_inotifyFd >= 0)
+        {
+            close(m_inotifyFd);
+        }
+        if (m_stopFd >= 0)
+        {
+            close(m_stopFd);
+        }
+    }
+
+    std::shared_ptr<const CategoryMatcher> CategoryMapCache::matcher() const
+    {
+        return std::atomic_load(&mp_matcher);
+    }
+
+    CategoryMapCache::Source CategoryMapCache::lastSource() const
+    {
+        std::lock_guard<std::mutex> lock(m_reloadMutex);
+        return m_lastSource;
+    }
+
+    bool CategoryMapCache::reload()
+    {
+        std::lock_guard<std::mutex> lock(m_reloadMutex);
+
+        struct stat info = {};
+        if (stat(m_csvPath.c_str(), &info) != 0)
+        {
+            throw std::runtime_error("Could not stat category map file: " + m_csvPath);
+        }
+        FileKey key;
+        key.size = static_cast<std::uint64_t>(info.st_size);
+        key.mtimeNs = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 +
+                      info.st_mtim.tv_nsec;
+
+        if (std::atomic_load(&mp_matcher) != nullptr && key.size == m_loadedKey.size &&
+            key.mtimeNs == m_loadedKey.mtimeNs)
+        {
+            return false;
+        }
+
+        // Same size and timestamp as when the cache was written: trust it without reading
+        // the CSV at all
+        if (loadPrecompiled(key, nullptr))
+        {
+            return true;
+        }
+
+        std::string content = readFile(m_csvPath);
+        std::uint64_t hash = contentHash(content);
+        // Touched but not changed
+        if (loadPrecompiled(key, &hash))
+        {
+            return true;
+        }
+
+        auto matcher = std::make_shared<const CategoryMatcher>(parseCategoryMap(content));
+        writePrecompiled(key, hash, *matcher);
+        publish(std::move(matcher), key, Source::CSV);
+        return true;
+    }
+
+    bool CategoryMapCache::loadPrecompiled(const FileKey &key, const std::uint64_t *csvHash)
+    {
+        if (m_cachePath.empty())
+        {
+            return false;
+        }
+
+        std::string data;
+        try
+        {
+            data = readFile(m_cachePath);
+        }
+        catch (const std::runtime_error &)
+        {
+            return false;
+        }
+
+        CacheHeader header;
+        if (data.size() < sizeof(header))
+        {
+            return false;
+        }
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+            header.formatVersion != CACHE_FORMAT_VERSION || header.csvSize != key.size)
+        {
+            return false;
+        }
+        bool matches = csvHash == nullptr ? header.csvMtimeNs == key.mtimeNs
+                                          : header.csvHash == *csvHash;
+        if (!matches)
+        {
+            return false;
+        }
+
+        std::shared_ptr<const CategoryMatcher> matcher;
+        try
+        {
+            matcher = std::make_shared<const CategoryMatcher>(CategoryMatcher::deserialize(
+                std::string_view(data).substr(sizeof(header))));
+        }
+        catch (const std::runtime_error &e)
+        {
+            std::cerr << "Ignoring category map cache: " << e.what() << std::endl;
+            return false;
+        }
+
+        if (csvHash != nullptr)
+        {
+            // Record the new timestamp so the next start skips reading the CSV again
+            writePrecompiled(key, *csvHash, *matcher);
+        }
+        publish(std::move(matcher), key, Source::PRECOMPILED);
+        return true;
+    }
+
+    void CategoryMapCache::writePrecompiled(const FileKey &key, std::uint64_t csvHash,
+                                            const CategoryMatcher &matcher)
+    {
+        if (m_cachePath.empty())
+        {
+            return;
+        }
+
+        CacheHeader header = {};
+        std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header.formatVersion = CACHE_FORMAT_VERSION;
+        header.csvSize = key.size;
+        header.csvMtimeNs = key.mtimeNs;
+        header.csvHash = csvHash;
+
+        // A failed write only costs the next start a recompile
+        std::string temporaryPath = m_cachePath + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            std::string body = matcher.serialize();
+            file.write(body.data(), static_cast<std::streamsize>(body.size()));
+            file.flush();
+            if (!file)
+            {
+                std::cerr << "Failed to write category map cache: " << temporaryPath
+                          << std::endl;
+                std::remove(temporaryPath.c_str());
+                return;
+            }
+        }
+        if (std::rename(temporaryPath.c_str(), m_cachePath.c_str()) != 0)
+        {
+            std::cerr << "Failed to replace category map cache: " << m_cachePath << std::endl;
+            std::remove(temporaryPath.c_str());
+        }
+    }
+
+    void CategoryMapCache::publish(std::shared_ptr<const CategoryMatcher> matcher,
+                                   const FileKey &key, Source source)
+    {
+        std::atomic_store(&mp_matcher, std::move(matcher));
+        m_loadedKey = key;
+        m_lastSource = source;
+    }
+
+    void CategoryMapCache::watch()
+    {
+        if (m_watcher.joinable())
+        {
+            return;
+        }
+
+        // Editors often save by writing a new file and renaming it over the old one, which a
+        // watch on the file itself would miss, so watch the directory
+        std::filesystem::path csv(m_csvPath);
+        std::string directory = csv.has_parent_path() ? csv.parent_path().string() : ".";
+
+        m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        m_stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_inotifyFd < 0 || m_stopFd < 0 ||
+            inotify_add_watch(m_inotifyFd, directory.c_str(),
+                              IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+        {
+            // Closed here, so a later watch() starts over instead of leaking them
+            std::string reason = std::strerror(errno);
+            if (m_inotifyFd >= 0)
+            {
+                close(m_inotifyFd);
+                m_inotifyFd = -1;
+            }
+            if (m_stopFd >= 0)
+            {
+                close(m_stopFd);
+                m_stopFd = -1;
+            }
+            throw std::runtime_error("Could not watch " + directory + ": " + reason);
+        }
+
+        m_watcher = std::thread([this]() { watchLoop(); });
+    }
+
+    void CategoryMapCache::watchLoop()
+    {
+        std::string fileName = std::filesystem::path(m_csvPath).filename().string();
+        alignas(inotify_event) char buffer[4096];
+
+        while (true)
+        {
+            pollfd fds[2] = {{m_inotifyFd, POLLIN, 0}, {m_stopFd, POLLIN, 0}};
+            if (poll(fds, 2, -1) < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                std::cerr << "Category map watcher failed: " << std::strerror(errno)
+                          << std::endl;
+                return;
+            }
+            if (fds[1].revents != 0)
+            {
+                return;
+            }
+
+            bool touched = false;
+            ssize_t length = 0;
+            while ((length = read(m_inotifyFd, buffer, sizeof(buffer))) > 0)
+            {
+                for (ssize_t offset = 0; offset < length;)
+                {
+                    auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+                    if (event->len > 0 && fileName == event->name)
+                    {
+                        touched = true;
+                    }
+                    offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+                }
+            }
+            if (!touched)
+            {
+                continue;
+            }
+
+            try
+            {
+                if (reload())
+                {
+                    std::cout << "Reloaded category map " << m_csvPath << std::endl;
+                }
+            }
+            catch (const std::exception &e)
+            {
+                // Mid-replace or removed; keep matching with the previous map
+                std::cerr << "Error reloading category map: " << e.what() << std::endl;
+            }
+        }
+    }
+}  // namespace marksman
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "category_matcher.hpp"
+
+namespace marksman
+{
+    // Keeps a CategoryMatcher compiled from a category map CSV up to date.
+    //
+    // The compiled matcher is also written to cachePath (unless it is empty), keyed by the
+    // CSV's size, modification time and content hash, so a later process can skip parsing and
+    // compiling while the CSV is unchanged. Readers take the current matcher with matcher();
+    // a reload builds the new one on the side and swaps the pointer, so matching never waits
+    // for a reload and a matcher in use stays valid until its last holder drops it.
+    class CategoryMapCache
+    {
+      public:
+        enum class Source
+        {
+            NONE,
+            CSV,
+            PRECOMPILED,
+        };
+
+        CategoryMapCache(std::string csvPath, std::string cachePath);
+        ~CategoryMapCache();
+
+        CategoryMapCache(const CategoryMapCache &) = delete;
+        CategoryMapCache &operator=(const CategoryMapCache &) = delete;
+
+        // Loads the matcher if the CSV changed since the last load; true if it was replaced.
+        // Throws std::runtime_error when the CSV cannot be read; the previous matcher stays.
+        bool reload();
+        // nullptr until the first successful reload()
+        std::shared_ptr<const CategoryMatcher> matcher() const;
+        // Where the last reload got its matcher from
+        Source lastSource() const;
+
+        // Reloads from a background thread whenever the CSV is written or replaced
+        void watch();
+
+      private:
+        struct FileKey
+        {
+            std::uint64_t size = 0;
+            std::int64_t mtimeNs = 0;
+        };
+
+        std::string m_csvPath;
+        std::string m_cachePath;
+        // Only read and written through std::atomic_load/std::atomic_store
+        std::shared_ptr<const CategoryMatcher> mp_matcher;
+
+        // Serializes reloads; the fields below belong to whoever holds it
+        mutable std::mutex m_reloadMutex;
+        FileKey m_loadedKey;
+        Source m_lastSource;
+
+        int m_inotifyFd;
+        int m_stopFd;
+        std::thread m_watcher;
+
+        bool loadPrecompiled(const FileKey &key, const std::uint64_t *csvHash);
+        void writePrecompiled(const FileKey &key, std::uint64_t csvHash,
+                              const CategoryMatcher &matcher);
+        void publish(std::shared_ptr<const CategoryMatcher> matcher, const FileKey &key,
+                     Source source);
+        void watchLoop();
+    };
+}  // namespace marksman
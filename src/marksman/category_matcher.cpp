@@ -0,0 +1,322 @@
+#include "category_matcher.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace marksman
+{
+    static const char MATCHER_MAGIC[8] = {'N', 'E', 'G', 'I', 'C', 'M', 'A', 'T'};
+    static const std::uint32_t MATCHER_FORMAT_VERSION = 1;
+    static const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    CategoryMatcher::CategoryMatcher() : m_maxKeywordLength(0)
+    {
+    }
+
+    CategoryMatcher::CategoryMatcher(const std::map<std::string, std::string> &categoryMap)
+        : m_maxKeywordLength(0)
+    {
+        // Plain trie first; std::map keeps each node's children sorted by byte
+        std::vector<std::map<unsigned char, std::uint32_t>> children(1);
+        std::vector<std::uint32_t> terminal(1, NONE);
+        for (const auto &pair : categoryMap)
+        {
+            const std::string &keyword = pair.first;
+            if (keyword.empty())
+            {
+                continue;
+            }
+
+            std::uint32_t node = 0;
+            for (char c : keyword)
+            {
+                auto byte = static_cast<unsigned char>(c);
+                auto it = children[node].find(byte);
+                if (it != children[node].end())
+                {
+                    node = it->second;
+                    continue;
+                }
+
+                auto child = static_cast<std::uint32_t>(children.size());
+                children.emplace_back();
+                terminal.push_back(NONE);
+                children[node][byte] = child;
+                node = child;
+            }
+
+            terminal[node] = static_cast<std::uint32_t>(m_categories.size());
+            m_keywordLengths.push_back(static_cast<std::uint32_t>(keyword.size()));
+            m_categories.push_back(pair.second);
+            m_maxKeywordLength =
+                std::max(m_maxKeywordLength, static_cast<std::uint32_t>(keyword.size()));
+        }
+
+        // Flatten breadth-first, so shallow nodes (visited most) sit together
+        std::vector<std::uint32_t> order = {0};
+        std::vector<std::uint32_t> newId(children.size(), 0);
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            m_edgeStart.push_back(static_cast<std::uint32_t>(m_edgeBytes.size()));
+            for (const auto &edge : children[order[i]])
+            {
+                newId[edge.second] = static_cast<std::uint32_t>(order.size());
+                order.push_back(edge.second);
+                m_edgeBytes.push_back(edge.first);
+                m_edgeTargets.push_back(newId[edge.second]);
+            }
+        }
+        m_edgeStart.push_back(static_cast<std::uint32_t>(m_edgeBytes.size()));
+
+        m_rootNext.assign(256, 0);
+        for (std::uint32_t e = m_edgeStart[0]; e < m_edgeStart[1]; ++e)
+        {
+            m_rootNext[m_edgeBytes[e]] = m_edgeTargets[e];
+        }
+
+        // Breadth-first order guarantees a node's failure target is finished before it
+        m_fail.assign(order.size(), 0);
+        m_output.assign(order.size(), NONE);
+        for (std::uint32_t node = 0; node < order.size(); ++node)
+        {
+            if (node != 0)
+            {
+                std::uint32_t own = terminal[order[node]];
+                m_output[node] = own != NONE ? own : m_output[m_fail[node]];
+            }
+
+            for (std::uint32_t e = m_edgeStart[node]; e < m_edgeStart[node + 1]; ++e)
+            {
+                m_fail[m_edgeTargets[e]] = node == 0 ? 0 : next(m_fail[node], m_edgeBytes[e]);
+            }
+        }
+    }
+
+    std::uint32_t CategoryMatcher::next(std::uint32_t node, unsigned char byte) const
+    {
+        while (node != 0)
+        {
+            auto first = m_edgeBytes.begin() + m_edgeStart[node];
+            auto last = m_edgeBytes.begin() + m_edgeStart[node + 1];
+            auto it = std::lower_bound(first, last, byte);
+            if (it != last && *it == byte)
+            {
+                return m_edgeTargets[static_cast<std::size_t>(it - m_edgeBytes.begin())];
+            }
+            node = m_fail[node];
+        }
+        return m_rootNext[byte];
+    }
+
+    const std::string *CategoryMatcher::match(std::string_view subject) const
+    {
+        std::uint32_t state = 0;
+        std::uint32_t best = NONE;
+        std::uint32_t bestLength = 0;
+
+        for (char c : subject)
+        {
+            state = next(state, static_cast<unsigned char>(c));
+
+            // Only a strictly longer keyword replaces the current one, so the first of
+            // equally long keywords is kept
+            std::uint32_t keyword = m_output[state];
+            if (keyword != NONE && m_keywordLengths[keyword] > bestLength)
+            {
+                best = keyword;
+                bestLength = m_keywordLengths[keyword];
+                if (bestLength == m_maxKeywordLength)
+                {
+                    break;
+                }
+            }
+        }
+
+        return best == NONE ? nullptr : &m_categories[best];
+    }
+
+    std::size_t CategoryMatcher::keywordCount() const
+    {
+        return m_categories.size();
+    }
+
+    template <typename T> static void putValue(std::string &out, T value)
+    {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    template <typename T> static void putArray(std::string &out, const std::vector<T> &values)
+    {
+        putValue<std::uint64_t>(out, values.size());
+        out.append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+    }
+
+    // Reads back what putValue/putArray wrote, failing on truncated input
+    class MatcherReader
+    {
+      private:
+        std::string_view m_data;
+
+      public:
+        explicit MatcherReader(std::string_view data) : m_data(data)
+        {
+        }
+
+        void take(void *target, std::size_t length)
+        {
+            if (length > m_data.size())
+            {
+                throw std::runtime_error("serialized matcher is truncated");
+            }
+            std::memcpy(target, m_data.data(), length);
+            m_data.remove_prefix(length);
+        }
+
+        template <typename T> T value()
+        {
+            T result;
+            take(&result, sizeof(result));
+            return result;
+        }
+
+        template <typename T> std::vector<T> array()
+        {
+            auto count = value<std::uint64_t>();
+            if (count > m_data.size() / sizeof(T))
+            {
+                throw std::runtime_error("serialized matcher is truncated");
+            }
+            std::vector<T> result(static_cast<std::size_t>(count));
+            take(result.data(), result.size() * sizeof(T));
+            return result;
+        }
+
+        std::string string()
+        {
+            auto length = value<std::uint32_t>();
+            if (length > m_data.size())
+            {
+                throw std::runtime_error("serialized matcher is truncated");
+            }
+            std::string result(m_data.substr(0, length));
+            m_data.remove_prefix(length);
+            return result;
+        }
+
+        bool atEnd() const
+        {
+            return m_data.empty();
+        }
+    };
+
+    std::string CategoryMatcher::serialize() const
+    {
+        std::string out(MATCHER_MAGIC, sizeof(MATCHER_MAGIC));
+        putValue(out, MATCHER_FORMAT_VERSION);
+        putValue(out, BYTE_ORDER_MARK);
+        putValue(out, m_maxKeywordLength);
+        putArray(out, m_edgeStart);
+        putArray(out, m_edgeBytes);
+        putArray(out, m_edgeTargets);
+        putArray(out, m_rootNext);
+        putArray(out, m_fail);
+        putArray(out, m_output);
+        putArray(out, m_keywordLengths);
+        putValue<std::uint64_t>(out, m_categories.size());
+        for (const auto &category : m_categories)
+        {
+            putValue(out, static_cast<std::uint32_t>(category.size()));
+            out += category;
+        }
+        return out;
+    }
+
+    CategoryMatcher CategoryMatcher::deserialize(std::string_view data)
+    {
+        if (data.size() < sizeof(MATCHER_MAGIC) ||
+            std::memcmp(data.data(), MATCHER_MAGIC, sizeof(MATCHER_MAGIC)) != 0)
+        {
+            throw std::runtime_error("not a serialized category matcher");
+        }
+        MatcherReader reader(data.substr(sizeof(MATCHER_MAGIC)));
+        if (reader.value<std::uint32_t>() != MATCHER_FORMAT_VERSION ||
+            reader.value<std::uint32_t>() != BYTE_ORDER_MARK)
+        {
+            throw std::runtime_error("unsupported serialized category matcher");
+        }
+
+        CategoryMatcher matcher;
+        matcher.m_maxKeywordLength = reader.value<std::uint32_t>();
+        matcher.m_edgeStart = reader.array<std::uint32_t>();
+        matcher.m_edgeBytes = reader.array<unsigned char>();
+        matcher.m_edgeTargets = reader.array<std::uint32_t>();
+        matcher.m_rootNext = reader.array<std::uint32_t>();
+        matcher.m_fail = reader.array<std::uint32_t>();
+        matcher.m_output = reader.array<std::uint32_t>();
+        matcher.m_keywordLengths = reader.array<std::uint32_t>();
+
+        auto categoryCount = reader.value<std::uint64_t>();
+        if (categoryCount != matcher.m_keywordLengths.size())
+        {
+            throw std::runtime_error("serialized matcher has mismatched keyword tables");
+        }
+        for (std::uint64_t i = 0; i < categoryCount; ++i)
+        {
+            matcher.m_categories.push_back(reader.string());
+        }
+        if (!reader.atEnd())
+        {
+            throw std::runtime_error("trailing data after serialized matcher");
+        }
+
+        matcher.validate();
+        return matcher;
+    }
+
+    // Everything match() and next() index with, so a corrupt cache cannot read out of
+    // bounds or loop forever
+    void CategoryMatcher::validate() const
+    {
+        auto fail = []() { throw std::runtime_error("serialized matcher is inconsistent"); };
+
+        std::size_t nodes = m_fail.size();
+        if (nodes == 0 || m_output.size() != nodes || m_edgeStart.size() != nodes + 1 ||
+            m_rootNext.size() != 256 || m_edgeBytes.size() != m_edgeTargets.size() ||
+            m_edgeStart[0] != 0 || m_edgeStart[nodes] != m_edgeBytes.size() || m_fail[0] != 0)
+        {
+            fail();
+        }
+        for (std::size_t node = 0; node < nodes; ++node)
+        {
+            if (m_edgeStart[node] > m_edgeStart[node + 1] ||
+                (node != 0 && m_fail[node] >= node) ||
+                (m_output[node] != NONE && m_output[node] >= m_keywordLengths.size()))
+            {
+                fail();
+            }
+            // Children come later in breadth-first order
+            for (std::uint32_t e = m_edgeStart[node]; e < m_edgeStart[node + 1]; ++e)
+            {
+                if (m_edgeTargets[e] <= node || m_edgeTargets[e] >= nodes)
+                {
+                    fail();
+                }
+            }
+        }
+        for (std::uint32_t target : m_rootNext)
+        {
+            if (target >= nodes)
+            {
+                fail();
+            }
+        }
+        for (std::uint32_t length : m_keywordLengths)
+        {
+            if (length > m_maxKeywordLength)
+            {
+                fail();
+            }
+        }
+    }
+}  // namespace marksman
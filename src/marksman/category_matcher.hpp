@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace marksman
+{
+    // Aho-Corasick automaton over the UTF-8 bytes of every keyword in a category map.
+    //
+    // match() scans a subject once, whatever the number of keywords. When several keywords
+    // occur in the same subject the longest one wins; among equally long ones, the one that
+    // occurs first. Matching is byte-wise and case-sensitive, like std::string::find. Empty
+    // keywords are ignored.
+    class CategoryMatcher
+    {
+      public:
+        explicit CategoryMatcher(const std::map<std::string, std::string> &categoryMap);
+
+        // The category of the winning keyword, or nullptr when no keyword occurs in subject
+        const std::string *match(std::string_view subject) const;
+
+        std::size_t keywordCount() const;
+
+        // The compiled automaton as bytes, so it can be cached instead of rebuilt
+        std::string serialize() const;
+        // Throws std::runtime_error unless data came from serialize()
+        static CategoryMatcher deserialize(std::string_view data);
+
+      private:
+        static constexpr std::uint32_t NONE = UINT32_MAX;
+
+        CategoryMatcher();
+        void validate() const;
+
+        // Nodes are numbered breadth-first; node 0 is the root. The edges of node n are
+        // m_edgeBytes/m_edgeTargets[m_edgeStart[n] .. m_edgeStart[n + 1]), sorted by byte.
+        std::vector<std::uint32_t> m_edgeStart;
+        std::vector<unsigned char> m_edgeBytes;
+        std::vector<std::uint32_t> m_edgeTargets;
+        // The root is looked up on every mismatch, so it gets a direct table
+        std::vector<std::uint32_t> m_rootNext;
+        std::vector<std::uint32_t> m_fail;
+        // Longest keyword ending at each node, following failure links (NONE if there is none)
+        std::vector<std::uint32_t> m_output;
+
+        std::vector<std::uint32_t> m_keywordLengths;
+        std::vector<std::string> m_categories;
+        std::uint32_t m_maxKeywordLength;
+
+        std::uint32_t next(std::uint32_t node, unsigned char byte) const;
+    };
+}  // namespace marksman
@@ -1,125 +1,211 @@
 #include "duplifinder.hpp"
 
 #include <algorithm>
-#include <cmath>
-#include <map>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <string_view>
+#include <unordered_map>
 
 namespace marksman
 {
-    std::vector<sheet::TransactionRow>
-    findPossibleDuplicates(const std::vector<sheet::Transaction> &transactions)
+    static std::string_view trimmedAccount(std::string_view account)
+    {
+        std::size_t end = account.find_last_not_of(" \t");
+        return end == std::string_view::npos ? std::string_view() : account.substr(0, end + 1);
+    }
+
+    static bool markedNotDuplicate(const sheet::Ledger &ledger, std::size_t row)
     {
-        // Create a vector of pairs with row numbers and copies of transactions
-        std::vector<std::pair<int, sheet::Transaction>> txnsWithRows;
-        int rowNumber = 2;  // Start from row 2 (A2)
-        for (const auto &trx : transactions)
+        std::string_view subject = ledger.subject(row);
+        return !subject.empty() && subject[0] == '!';
+    }
+
+    static bool hasTimeOfDay(const sheet::Ledger &ledger, std::size_t row)
+    {
+        // Only minutes and seconds count; imports without a time land on the hour
+        return ledger.date(row) % 3600 != 0;
+    }
+
+    // Assigns every candidate a dense id for its (trimmed account, amount) pair, using an
+    // open-addressing table keyed on interned account ids
+    static std::vector<std::uint32_t> bucketIds(const sheet::Ledger &ledger,
+                                                const std::vector<std::uint32_t> &candidates,
+                                                std::uint32_t &bucketCount)
+    {
+        // Accounts differing only in trailing whitespace share an id
+        const sheet::StringPool &accounts = ledger.accounts();
+        std::vector<std::uint32_t> trimmedIds(accounts.size());
         {
-            // Skip ones already marked as duplicate
-            if (!trx.subject.empty() && trx.subject[0] == '?')
+            std::unordered_map<std::string_view, std::uint32_t> seen;
+            for (std::uint32_t id = 0; id < accounts.size(); ++id)
             {
-                rowNumber++;
-                continue;
+                auto inserted = seen.emplace(trimmedAccount(accounts.view(id)), id);
+                trimmedIds[id] = inserted.first->second;
             }
-            txnsWithRows.push_back({rowNumber, trx});
-            rowNumber++;
         }
 
-        // Group by amount
-        std::map<int, std::vector<size_t>> groupedByAmount;
-        for (size_t i = 0; i < txnsWithRows.size(); ++i)
+        struct Slot
         {
-            groupedByAmount[txnsWithRows[i].second.amount].push_back(i);
+            std::uint32_t account = 0;
+            std::int64_t amount = 0;
+            std::uint32_t bucket = UINT32_MAX;
+        };
+
+        std::size_t capacity = 16;
+        while (capacity < candidates.size() * 2)
+        {
+            capacity *= 2;
         }
+        std::vector<Slot> slots(capacity);
 
-        // Sort each group by date
-        for (auto &pair : groupedByAmount)
+        std::vector<std::uint32_t> ids(candidates.size());
+        bucketCount = 0;
+        for (std::size_t i = 0; i < candidates.size(); ++i)
         {
-            std::sort(pair.second.begin(), pair.second.end(), [&txnsWithRows](size_t a, size_t b)
-                      { return txnsWithRows[a].second.date < txnsWithRows[b].second.date; });
+            std::uint32_t account = trimmedIds[ledger.accountId(candidates[i])];
+            std::int64_t amount = ledger.amount(candidates[i]);
+
+            std::uint64_t hash = (static_cast<std::uint64_t>(amount) ^
+                                  (static_cast<std::uint64_t>(account) << 32)) *
+                                 0x9E3779B97F4A7C15ULL;
+            std::size_t slot = static_cast<std::size_t>(hash >> 32) & (capacity - 1);
+            while (slots[slot].bucket != UINT32_MAX &&
+                   (slots[slot].amount != amount || slots[slot].account != account))
+            {
+                slot = (slot + 1) & (capacity - 1);
+            }
+
+            if (slots[slot].bucket == UINT32_MAX)
+            {
+                slots[slot] = Slot{account, amount, bucketCount++};
+            }
+            ids[i] = slots[slot].bucket;
         }
 
-        // Find possible duplicates
-        std::vector<sheet::TransactionRow> possibleDuplicates;
-        for (const auto &group : groupedByAmount)
+        return ids;
+    }
+
+    std::vector<sheet::RowEdit> findPossibleDuplicates(const sheet::Ledger &ledger,
+                                                       std::chrono::seconds window)
+    {
+        // Indices of transactions not already marked as duplicate
+        std::vector<std::uint32_t> candidates;
+        candidates.reserve(ledger.size());
+        for (std::size_t i = 0; i < ledger.size(); ++i)
         {
-            const auto &indices = group.second;
-            for (size_t i = 0; i < indices.size() - 1; ++i)
+            std::string_view subject = ledger.subject(i);
+            if (subject.empty() || subject[0] != '?')
             {
-                const auto &current = txnsWithRows[indices[i]];
-                const auto &next = txnsWithRows[indices[i + 1]];
+                candidates.push_back(static_cast<std::uint32_t>(i));
+            }
+        }
 
-                auto timeDiff = next.second.date - current.second.date;
-                // Convert to seconds first, then to days
-                auto secondsDiff = std::chrono::duration_cast<std::chrono::seconds>(timeDiff);
-                // Use ceiling division to properly account for partial days
-                long daysDiff = (secondsDiff.count() + 86399) / (24 * 3600);
+        std::uint32_t bucketCount = 0;
+        std::vector<std::uint32_t> ids = bucketIds(ledger, candidates, bucketCount);
 
-                std::string account1 = current.second.account;
-                std::string account2 = next.second.account;
+        // Lay the buckets out back to back (counting sort), then order each by date
+        std::vector<std::uint32_t> bucketStart(bucketCount + 1, 0);
+        for (std::uint32_t id : ids)
+        {
+            bucketStart[id + 1]++;
+        }
+        for (std::uint32_t b = 0; b < bucketCount; ++b)
+        {
+            bucketStart[b + 1] += bucketStart[b];
+        }
+        std::vector<std::uint32_t> ordered(candidates.size());
+        std::vector<std::uint32_t> fill(bucketStart.begin(), bucketStart.end() - 1);
+        for (std::size_t i = 0; i < candidates.size(); ++i)
+        {
+            ordered[fill[ids[i]]++] = candidates[i];
+        }
 
-                // Trim whitespace for comparison
-                account1.erase(account1.find_last_not_of(" \t") + 1);
-                account2.erase(account2.find_last_not_of(" \t") + 1);
+        const std::vector<std::int64_t> &dates = ledger.dates();
+        auto byDate = [&dates](std::uint32_t a, std::uint32_t b)
+        {
+            if (dates[a] != dates[b])
+            {
+                return dates[a] < dates[b];
+            }
+            return a < b;
+        };
 
-                if (std::abs(daysDiff) <= 2 && account1 == account2)
-                {
-                    // Skip if both marked as not duplicate
-                    bool currentMarkedNotDupe =
-                        !current.second.subject.empty() && current.second.subject[0] == '!';
-                    bool nextMarkedNotDupe =
-                        !next.second.subject.empty() && next.second.subject[0] == '!';
+        std::vector<bool> isDuplicate(ledger.size(), false);
+        std::vector<bool> isOriginal(ledger.size(), false);
+        std::vector<sheet::RowEdit> possibleDuplicates;
 
-                    if (currentMarkedNotDupe && nextMarkedNotDupe)
+        for (std::uint32_t b = 0; b < bucketCount; ++b)
+        {
+            auto first = ordered.begin() + bucketStart[b];
+            auto last = ordered.begin() + bucketStart[b + 1];
+            if (last - first < 2)
+            {
+                continue;
+            }
+            std::sort(first, last, byDate);
+
+            // Every later transaction within the window of this one is a candidate pair
+            for (auto i = first; i != last; ++i)
+            {
+                for (auto j = i + 1; j != last; ++j)
+                {
+                    if (dates[*j] - dates[*i] > window.count())
+                    {
+                        break;
+                    }
+                    if (isDuplicate[*i] || isDuplicate[*j])
                     {
                         continue;
                     }
 
-                    // If the latter is marked as not duplicate, flip
-                    bool flip = !currentMarkedNotDupe && nextMarkedNotDupe;
-
-                    // Check if we should flip based on time of day
-                    if (!flip)
+                    bool currentMarkedNotDupe = markedNotDuplicate(ledger, *i);
+                    bool nextMarkedNotDupe = markedNotDuplicate(ledger, *j);
+                    if (currentMarkedNotDupe && nextMarkedNotDupe)
                     {
-                        // Extract time of day (minutes and seconds)
-                        auto currentTimeOfDay = std::chrono::duration_cast<std::chrono::seconds>(
-                                                    current.second.date.time_since_epoch()) %
-                                                std::chrono::seconds(86400);
-                        auto nextTimeOfDay = std::chrono::duration_cast<std::chrono::seconds>(
-                                                 next.second.date.time_since_epoch()) %
-                                             std::chrono::seconds(86400);
-
-                        auto currentMinutes = (currentTimeOfDay.count() / 60) % 60;
-                        auto currentSeconds = currentTimeOfDay.count() % 60;
-                        auto nextMinutes = (nextTimeOfDay.count() / 60) % 60;
-                        auto nextSeconds = nextTimeOfDay.count() % 60;
-
-                        // Flip if current has 00:00 and next has non-00 minutes/seconds
-                        if (currentMinutes == 0 && currentSeconds == 0 &&
-                            (nextMinutes != 0 || nextSeconds != 0))
-                        {
-                            flip = true;
-                        }
+                        continue;
                     }
 
-                    int originalRow = flip ? next.first : current.first;
-                    const sheet::Transaction &duplicateTxn = flip ? current.second : next.second;
-                    int duplicateRow = flip ? current.first : next.first;
+                    // Mark the earlier one instead if the later is confirmed, or if the earlier
+                    // has no time of day while the later does
+                    bool flip = nextMarkedNotDupe ||
+                                (!currentMarkedNotDupe && !hasTimeOfDay(ledger, *i) &&
+                                 hasTimeOfDay(ledger, *j));
 
-                    auto clonedDuplicate = std::make_shared<sheet::Transaction>(duplicateTxn);
-                    std::string originalSubject = clonedDuplicate->subject;
-                    if (!originalSubject.empty())
+                    std::uint32_t original = flip ? *j : *i;
+                    std::uint32_t duplicate = flip ? *i : *j;
+                    if (isOriginal[duplicate])
                     {
-                        originalSubject = " " + originalSubject;
+                        continue;
                     }
-                    clonedDuplicate->subject =
-                        "?dupof(" + std::to_string(originalRow) + ")" + originalSubject;
+                    isOriginal[original] = true;
+                    isDuplicate[duplicate] = true;
 
-                    possibleDuplicates.push_back({clonedDuplicate, duplicateRow});
+                    possibleDuplicates.push_back(
+                        {sheet::RowEdit::Kind::MARK_DUPLICATE, duplicate, original, {}});
                 }
             }
         }
 
+        std::sort(possibleDuplicates.begin(), possibleDuplicates.end(),
+                  [](const sheet::RowEdit &a, const sheet::RowEdit &b) { return a.row < b.row; });
+        return possibleDuplicates;
+    }
+
+    std::vector<sheet::TransactionRow>
+    findPossibleDuplicates(const std::vector<sheet::Transaction> &transactions,
+                           std::chrono::seconds window, int firstRow)
+    {
+        sheet::Ledger ledger = sheet::Ledger::fromTransactions(transactions);
+
+        std::vector<sheet::TransactionRow> possibleDuplicates;
+        for (const auto &edit : findPossibleDuplicates(ledger, window))
+        {
+            auto clonedDuplicate = std::make_shared<sheet::Transaction>(transactions[edit.row]);
+            clonedDuplicate->subject = sheet::duplicateSubject(
+                static_cast<int>(edit.original) + firstRow, clonedDuplicate->subject);
+            possibleDuplicates.push_back({clonedDuplicate, static_cast<int>(edit.row) + firstRow});
+        }
         return possibleDuplicates;
     }
 }  // namespace marksman
@@ -1,11 +1,32 @@
 #pragma once
 
+#include <chrono>
 #include <vector>
 
 #include "lib/sheet.hpp"
+#include "lib/sheet/ledger.hpp"
 
 namespace marksman
 {
+    // Pairs up transactions on the same account (ignoring trailing whitespace) with the same
+    // amount whose dates are at most `window` apart, and picks the duplicate of each pair; it
+    // gets marked with its subject prefixed by "?dupof(<row of the original>)".
+    //
+    // Every pair inside the window is considered, not just neighbours, and the work is linear
+    // in the number of transactions plus candidate pairs. A row is marked at most once, and a
+    // row already kept as the original of one pair is not marked as a duplicate of another.
+    // Rows whose subject starts with '?' (already marked) are ignored; pairs where both start
+    // with '!' (confirmed not duplicates) are skipped.
+    //
+    // Returns one MARK_DUPLICATE edit per duplicate, ordered by row.
+    std::vector<sheet::RowEdit>
+    findPossibleDuplicates(const sheet::Ledger &ledger,
+                           std::chrono::seconds window = std::chrono::hours(48));
+
+    // Same, on copies of the rows. transactions[0] is taken to be sheet row firstRow, so a
+    // slice fetched from further down the sheet gets the right row numbers.
     std::vector<sheet::TransactionRow>
-    findPossibleDuplicates(const std::vector<sheet::Transaction> &transactions);
-}
+    findPossibleDuplicates(const std::vector<sheet::Transaction> &transactions,
+                           std::chrono::seconds window = std::chrono::hours(48),
+                           int firstRow = 2);
+}  // namespace marksman
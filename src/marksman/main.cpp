@@ -1,16 +1,27 @@
+#include <algorithm>
 #include <chrono>
 #include <curl/curl.h>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <sstream>
+#include <thread>
 
-#include "lib/external/exec.hpp"
+#include "lib/auth/static_provider.hpp"
 #include "lib/network/requester.hpp"
+#include "lib/network/retrying_requester.hpp"
 #include "lib/sheet/client.hpp"
+#include "lib/sheet/ledger.hpp"
+#include "lib/sheet/snapshot.hpp"
 
 #include "categorizer.hpp"
+#include "category_map_cache.hpp"
 #include "duplifinder.hpp"
+#include "run_state.hpp"
+#include "scheduler.hpp"
+
+static const std::chrono::seconds DUPLICATE_WINDOW = std::chrono::hours(48);
 
 std::string getCurrentTimestampUTC()
 {
@@ -23,78 +34,259 @@ std::string getCurrentTimestampUTC()
     return oss.str();
 }
 
-void markDuplicates(sheet::Client &client, const std::vector<sheet::Transaction> &values)
+void markDuplicates(sheet::Client &client, const sheet::Ledger &ledger, int firstRow)
 {
-    auto possibleDuplicates = marksman::findPossibleDuplicates(values);
+    auto possibleDuplicates = marksman::findPossibleDuplicates(ledger, DUPLICATE_WINDOW);
 
     std::cout << getCurrentTimestampUTC() << " Found " << possibleDuplicates.size()
               << " possible duplicates" << std::endl;
 
-    if (possibleDuplicates.empty())
+    client.queueEdits(ledger, possibleDuplicates, firstRow);
+}
+
+void setCategories(sheet::Client &client, const sheet::Ledger &ledger, int firstRow,
+                   marksman::CategoryMapCache &categoryMap, concurrency::ThreadPool &pool)
+{
+    categoryMap.reload();
+    auto matcher = categoryMap.matcher();
+
+    auto matchedValues = marksman::matchSubjectToCategories(ledger, *matcher, pool);
+
+    std::cout << getCurrentTimestampUTC() << " Found " << matchedValues.size()
+              << " subject-to-category matches" << std::endl;
+
+    client.queueEdits(ledger, matchedValues, firstRow);
+}
+
+// False if some updates could not be written
+bool flushUpdates(sheet::Client &client)
+{
+    std::size_t pending = client.pendingUpdateCount();
+    if (pending == 0)
     {
-        return;
+        return true;
     }
 
     try
     {
-        client.markDuplicatesInSheet(possibleDuplicates);
-        std::cout << getCurrentTimestampUTC() << " Marked all of them as possible duplicates"
-                  << std::endl;
+        client.flushUpdates();
+        std::cout << getCurrentTimestampUTC() << " Wrote " << pending
+                  << " cell updates to Google Sheets" << std::endl;
+        return true;
     }
     catch (const std::exception &e)
     {
         std::cerr << getCurrentTimestampUTC() << " Marking error: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Rows firstRow onwards, straight into a ledger
+sheet::Ledger fetchLedger(sheet::Client &client, const std::string &sheetId, int firstRow)
+{
+    // Reuse the local snapshot while the sheet is unchanged
+    const char *snapshotPath = std::getenv("LEDGER_SNAPSHOT_FILE");
+    if (firstRow == 2 && snapshotPath != nullptr && *snapshotPath != '\0')
+    {
+        return sheet::Ledger::fromTransactions(
+            sheet::loadTransactions(client, sheetId, snapshotPath));
     }
+
+    sheet::Ledger ledger;
+    client.streamTransactionsFrom(firstRow, [&ledger](sheet::Transaction &&transaction)
+                                  { ledger.append(transaction); });
+    return ledger;
 }
 
-void setCategories(sheet::Client &client, const std::vector<sheet::Transaction> &values)
+// What survives between cycles: connections, tokens, the matcher and the run state
+struct Context
 {
-    auto categoryMapCsv = marksman::readCategoryMapFile();
-    auto categoryMap = marksman::parseCategoryMap(categoryMapCsv);
-    auto matchedValues = marksman::matchSubjectToCategories(values, categoryMap);
+    std::shared_ptr<network::Requester> requester;
+    std::shared_ptr<network::RetryingRequester> retryingRequester;
+    std::unique_ptr<sheet::Client> client;
+    std::string sheetId;
+    std::string statePath;
+    std::unique_ptr<marksman::CategoryMapCache> categoryMap;
+    std::unique_ptr<concurrency::ThreadPool> pool;
+    std::optional<marksman::RunState> state;
+};
 
-    std::cout << getCurrentTimestampUTC() << " Found " << matchedValues.size()
-              << " subject-to-category matches" << std::endl;
+std::string getEnvOr(const char *name, const std::string &fallback)
+{
+    const char *value = std::getenv(name);
+    return value != nullptr && *value != '\0' ? value : fallback;
+}
 
-    if (matchedValues.empty())
+// The state of the previous process, when there is a usable state file
+std::optional<marksman::RunState> loadState(const std::string &statePath)
+{
+    if (statePath.empty())
     {
-        return;
+        return std::nullopt;
     }
 
     try
     {
-        client.setCategoriesInSheet(matchedValues);
-        std::cout << getCurrentTimestampUTC() << " Marked the categories for all of them"
+        marksman::RunState state;
+        if (marksman::loadRunState(statePath, state))
+        {
+            return state;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << getCurrentTimestampUTC() << " Ignoring state file: " << e.what()
+                  << std::endl;
+    }
+    return std::nullopt;
+}
+
+void runCycle(Context &context)
+{
+    // Pick up from the tail of the previous cycle, or check the whole sheet
+    int firstRow = 2;
+    if (context.state && context.state->sheetId == context.sheetId)
+    {
+        firstRow = context.state->tailStartRow;
+    }
+
+    sheet::Ledger ledger = fetchLedger(*context.client, context.sheetId, firstRow);
+    if (firstRow != 2 && !marksman::tailMatches(*context.state, ledger))
+    {
+        std::cout << getCurrentTimestampUTC()
+                  << " Rows changed since the last run, checking the whole sheet" << std::endl;
+        firstRow = 2;
+        ledger = fetchLedger(*context.client, context.sheetId, firstRow);
+    }
+    else if (firstRow != 2 &&
+             marksman::reachesBeforeTail(*context.state, ledger, DUPLICATE_WINDOW))
+    {
+        std::cout << getCurrentTimestampUTC()
+                  << " New rows are back-dated past the tail, checking the whole sheet"
                   << std::endl;
+        firstRow = 2;
+        ledger = fetchLedger(*context.client, context.sheetId, firstRow);
+    }
+    std::cout << getCurrentTimestampUTC() << " Fetched " << ledger.size()
+              << " transactions from Google Sheets (from row " << firstRow << ")" << std::endl;
+
+    markDuplicates(*context.client, ledger, firstRow);
+    setCategories(*context.client, ledger, firstRow, *context.categoryMap, *context.pool);
+
+    // Only move forward once the updates are in the sheet; otherwise the next run redoes them
+    if (flushUpdates(*context.client))
+    {
+        context.state =
+            marksman::advanceRunState(context.sheetId, ledger, firstRow, DUPLICATE_WINDOW);
+        if (!context.statePath.empty())
+        {
+            marksman::saveRunState(context.statePath, *context.state);
+        }
+    }
+
+    auto stats = context.requester->getStats();
+    std::cout << getCurrentTimestampUTC() << " Made " << stats.requests << " requests ("
+              << stats.reusedConnections << " on reused connections, "
+              << context.retryingRequester->retryCount() << " retries so far)" << std::endl;
+}
+
+// Runs a cycle every MARKSMAN_INTERVAL_SECONDS (+/- MARKSMAN_JITTER_SECONDS) until SIGTERM
+// or SIGINT; SIGUSR1 runs one right away
+void runDaemon(Context &context, marksman::CycleScheduler &scheduler)
+{
+    try
+    {
+        context.categoryMap->watch();
     }
     catch (const std::exception &e)
     {
-        std::cerr << "Marking error: " << e.what() << std::endl;
+        std::cerr << getCurrentTimestampUTC() << " Not watching the category map: " << e.what()
+                  << std::endl;
+    }
+
+    while (true)
+    {
+        try
+        {
+            runCycle(context);
+        }
+        catch (const std::exception &e)
+        {
+            // Keep going; the next cycle retries from the last saved state
+            std::cerr << getCurrentTimestampUTC() << " Cycle failed: " << e.what() << std::endl;
+        }
+
+        auto delay = scheduler.nextDelay();
+        std::cout << getCurrentTimestampUTC() << " Next cycle in "
+                  << std::chrono::duration_cast<std::chrono::seconds>(delay).count() << "s"
+                  << std::endl;
+        auto wake = scheduler.wait(delay);
+        if (wake == marksman::CycleScheduler::Wake::STOP)
+        {
+            std::cout << getCurrentTimestampUTC() << " Stopping" << std::endl;
+            return;
+        }
+        if (wake == marksman::CycleScheduler::Wake::TRIGGER)
+        {
+            std::cout << getCurrentTimestampUTC() << " Cycle triggered by SIGUSR1" << std::endl;
+        }
     }
 }
 
-int main()
+int main(int argc, char *argv[])
 {
     char *sheetId = std::getenv("SHEET_ID");
     if (sheetId == nullptr)
         throw std::runtime_error("SHEET_ID not found in env");
 
+    bool daemon = argc >= 2 && std::string(argv[1]) == "--daemon";
+
+    // Signals have to be blocked before curl, the pool or the watcher start any thread
+    std::unique_ptr<marksman::CycleScheduler> scheduler;
+    if (daemon)
+    {
+        scheduler = std::make_unique<marksman::CycleScheduler>(
+            std::chrono::seconds(std::stol(getEnvOr("MARKSMAN_INTERVAL_SECONDS", "300"))),
+            std::chrono::seconds(std::stol(getEnvOr("MARKSMAN_JITTER_SECONDS", "30"))));
+    }
+
     curl_global_init(CURL_GLOBAL_DEFAULT);
 
     try
     {
-        auto requester = std::make_shared<network::Requester>();
-        auto shellExec = std::make_shared<external::ShellExec>();
+        Context context;
+        context.requester = std::make_shared<network::Requester>();
+        context.retryingRequester = std::make_shared<network::RetryingRequester>(context.requester);
+        auto tokenProvider = auth::tokenProviderFromEnv(context.retryingRequester);
+
+        context.client =
+            std::make_unique<sheet::Client>(context.retryingRequester, tokenProvider);
+        context.client->setSheetId(sheetId);
+        context.sheetId = sheetId;
 
-        sheet::Client client(requester, shellExec);
-        client.setSheetId(sheetId);
+        // The compiled map is kept in CATEGORY_MAP_CACHE_FILE, when set, between runs
+        const char *categoryMapPath = std::getenv("CATEGORY_MAP_FILE");
+        if (categoryMapPath == nullptr)
+        {
+            throw std::runtime_error("CATEGORY_MAP_FILE environment variable not set");
+        }
+        context.categoryMap = std::make_unique<marksman::CategoryMapCache>(
+            categoryMapPath, getEnvOr("CATEGORY_MAP_CACHE_FILE", ""));
+        context.pool = std::make_unique<concurrency::ThreadPool>(
+            std::max(1u, std::thread::hardware_concurrency()));
 
-        auto sheetValues = client.getTransactions();
-        std::cout << getCurrentTimestampUTC() << " Fetched " << sheetValues.size()
-                  << " transactions from Google Sheets" << std::endl;
+        // With a state file only the rows that can still change are fetched and checked
+        context.statePath = getEnvOr("MARKSMAN_STATE_FILE", "");
+        context.state = loadState(context.statePath);
 
-        markDuplicates(client, sheetValues);
-        setCategories(client, sheetValues);
+        if (daemon)
+        {
+            runDaemon(context, *scheduler);
+        }
+        else
+        {
+            runCycle(context);
+        }
 
         curl_global_cleanup();
         return 0;
@@ -0,0 +1,206 @@
+#include "run_state.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace marksman
+{
+    static const char *STATE_HEADER = "marksman-state 2";
+
+    static void fnv1a(std::uint64_t &hash, const void *data, std::size_t length)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    static void fnv1a(std::uint64_t &hash, std::string_view text)
+    {
+        fnv1a(hash, text.data(), text.size());
+        // Keeps ("ab", "c") apart from ("a", "bc")
+        fnv1a(hash, "", 1);
+    }
+
+    std::uint64_t rowFingerprint(const sheet::Ledger &ledger, std::size_t row)
+    {
+        std::uint64_t hash = 14695981039346656037ULL;
+        fnv1a(hash, ledger.account(row));
+        fnv1a(hash, ledger.currency(row));
+
+        std::int64_t seconds = ledger.date(row);
+        fnv1a(hash, &seconds, sizeof(seconds));
+        return hash;
+    }
+
+    bool loadRunState(const std::string &path, RunState &state)
+    {
+        std::ifstream file(path);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        std::string line;
+        if (!std::getline(file, line) || line != STATE_HEADER)
+        {
+            throw std::runtime_error("unrecognised state file: " + path);
+        }
+
+        RunState loaded;
+        while (std::getline(file, line))
+        {
+            std::istringstream fields(line);
+            std::string key;
+            fields >> key;
+            if (key == "sheet")
+            {
+                fields >> loaded.sheetId;
+            }
+            else if (key == "next-row")
+            {
+                fields >> loaded.nextRow;
+            }
+            else if (key == "tail-start-row")
+            {
+                fields >> loaded.tailStartRow;
+            }
+            else if (key == "cutoff")
+            {
+                fields >> loaded.cutoff;
+            }
+            else if (key == "tail")
+            {
+                std::uint64_t hash = 0;
+                fields >> std::hex >> hash;
+                loaded.tailHashes.push_back(hash);
+            }
+            else if (!key.empty())
+            {
+                throw std::runtime_error("unknown key in state file: " + key);
+            }
+
+            if (fields.fail())
+            {
+                throw std::runtime_error("malformed state file line: " + line);
+            }
+        }
+
+        int tailLength = loaded.nextRow - loaded.tailStartRow;
+        if (loaded.tailStartRow < 2 || tailLength < 0 ||
+            loaded.tailHashes.size() != static_cast<std::size_t>(tailLength))
+        {
+            throw std::runtime_error("inconsistent state file: " + path);
+        }
+
+        state = std::move(loaded);
+        return true;
+    }
+
+    void saveRunState(const std::string &path, const RunState &state)
+    {
+        std::string temporaryPath = path + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::trunc);
+            if (!file.is_open())
+            {
+                throw std::runtime_error("failed to write state file: " + temporaryPath);
+            }
+
+            file << STATE_HEADER << "\n";
+            file << "sheet " << state.sheetId << "\n";
+            file << "next-row " << state.nextRow << "\n";
+            file << "tail-start-row " << state.tailStartRow << "\n";
+            file << "cutoff " << state.cutoff << "\n";
+            file << std::hex;
+            for (std::uint64_t hash : state.tailHashes)
+            {
+                file << "tail " << hash << "\n";
+            }
+
+            file.flush();
+            if (!file)
+            {
+                throw std::runtime_error("failed to write state file: " + temporaryPath);
+            }
+        }
+
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporaryPath.c_str());
+            throw std::runtime_error("failed to replace state file: " + path);
+        }
+    }
+
+    bool tailMatches(const RunState &state, const sheet::Ledger &ledger)
+    {
+        if (ledger.size() < state.tailHashes.size())
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < state.tailHashes.size(); ++i)
+        {
+            if (rowFingerprint(ledger, i) != state.tailHashes[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool reachesBeforeTail(const RunState &state, const sheet::Ledger &ledger,
+                           std::chrono::seconds window)
+    {
+        // A row pairs with rows at most one window older, and those before the tail are all
+        // older than the cutoff
+        const std::vector<std::int64_t> &dates = ledger.dates();
+        for (std::size_t i = state.tailHashes.size(); i < dates.size(); ++i)
+        {
+            if (dates[i] - window.count() < state.cutoff)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    RunState advanceRunState(const std::string &sheetId, const sheet::Ledger &ledger,
+                             int firstRow, std::chrono::seconds window)
+    {
+        RunState state;
+        state.sheetId = sheetId;
+        state.nextRow = firstRow + static_cast<int>(ledger.size());
+        state.tailStartRow = state.nextRow;
+        if (ledger.empty())
+        {
+            // Nothing is known about the dates of rows before firstRow
+            state.cutoff = firstRow > 2 ? INT64_MAX : INT64_MIN;
+            return state;
+        }
+
+        const std::vector<std::int64_t> &dates = ledger.dates();
+        std::int64_t newest = *std::max_element(dates.begin(), dates.end());
+
+        // The earliest row still within one window of the newest transaction; everything
+        // from there on can pair with rows added later
+        state.cutoff = newest - window.count();
+        std::size_t tailStart = 0;
+        while (dates[tailStart] < state.cutoff)
+        {
+            ++tailStart;
+        }
+
+        state.tailStartRow = firstRow + static_cast<int>(tailStart);
+        state.tailHashes.reserve(ledger.size() - tailStart);
+        for (std::size_t i = tailStart; i < ledger.size(); ++i)
+        {
+            state.tailHashes.push_back(rowFingerprint(ledger, i));
+        }
+        return state;
+    }
+}  // namespace marksman
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "lib/sheet/ledger.hpp"
+
+namespace marksman
+{
+    // What an incremental run needs to remember about the previous one.
+    //
+    // Rows before tailStartRow are dated before cutoff, one duplicate window before the newest
+    // transaction seen, and are never fetched again. That is only safe while new rows are
+    // dated late enough not to pair with them; clerk accepts any date, so a back-dated row
+    // calls for a full run (see reachesBeforeTail). The tail itself is refetched and
+    // fingerprinted: if any of its rows changed (rows were inserted or deleted above it) the
+    // state no longer describes the sheet.
+    struct RunState
+    {
+        std::string sheetId;
+        // First row not processed yet
+        int nextRow = 2;
+        int tailStartRow = 2;
+        // Every row before tailStartRow is dated earlier than this (seconds since the epoch)
+        std::int64_t cutoff = INT64_MIN;
+        // Fingerprints of rows tailStartRow .. nextRow - 1
+        std::vector<std::uint64_t> tailHashes;
+    };
+
+    // Covers only the columns marksman never writes to (account, date and currency), so
+    // marking a row or setting its category does not invalidate the tail
+    std::uint64_t rowFingerprint(const sheet::Ledger &ledger, std::size_t row);
+
+    // False when the file does not exist; throws std::runtime_error when it is malformed
+    bool loadRunState(const std::string &path, RunState &state);
+    // Replaces the file atomically
+    void saveRunState(const std::string &path, const RunState &state);
+
+    // Whether ledger, fetched from state.tailStartRow, still starts with the tail
+    bool tailMatches(const RunState &state, const sheet::Ledger &ledger);
+
+    // Whether a row of ledger, fetched from state.tailStartRow, that is new since the state
+    // was saved could pair with a row before the tail
+    bool reachesBeforeTail(const RunState &state, const sheet::Ledger &ledger,
+                           std::chrono::seconds window);
+
+    // The state after processing ledger, which starts at sheet row firstRow and runs to the
+    // end of the sheet
+    RunState advanceRunState(const std::string &sheetId, const sheet::Ledger &ledger,
+                             int firstRow, std::chrono::seconds window);
+}  // namespace marksman
@@ -0,0 +1,75 @@
+#include "scheduler.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <stdexcept>
+
+namespace marksman
+{
+    CycleScheduler::CycleScheduler(std::chrono::milliseconds interval,
+                                   std::chrono::milliseconds jitter)
+        : m_interval(interval), m_jitter(jitter), m_random(std::random_device()())
+    {
+        if (interval.count() <= 0 || jitter.count() < 0)
+        {
+            throw std::runtime_error("cycle interval must be positive and jitter non-negative");
+        }
+
+        sigemptyset(&m_signals);
+        sigaddset(&m_signals, SIGUSR1);
+        sigaddset(&m_signals, SIGTERM);
+        sigaddset(&m_signals, SIGINT);
+        int error = pthread_sigmask(SIG_BLOCK, &m_signals, &m_previousMask);
+        if (error != 0)
+        {
+            throw std::runtime_error(std::string("failed to block signals: ") +
+                                     std::strerror(error));
+        }
+    }
+
+    CycleScheduler::~CycleScheduler()
+    {
+        pthread_sigmask(SIG_SETMASK, &m_previousMask, nullptr);
+    }
+
+    std::chrono::milliseconds CycleScheduler::nextDelay()
+    {
+        std::uniform_int_distribution<long long> offset(-m_jitter.count(), m_jitter.count());
+        auto delay = m_interval + std::chrono::milliseconds(offset(m_random));
+        return delay.count() < 0 ? std::chrono::milliseconds(0) : delay;
+    }
+
+    CycleScheduler::Wake CycleScheduler::wait(std::chrono::milliseconds delay)
+    {
+        auto deadline = std::chrono::steady_clock::now() + delay;
+        while (true)
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                deadline - std::chrono::steady_clock::now());
+            if (remaining.count() < 0)
+            {
+                remaining = std::chrono::nanoseconds(0);
+            }
+
+            timespec timeout = {};
+            timeout.tv_sec = static_cast<time_t>(remaining.count() / 1000000000);
+            timeout.tv_nsec = static_cast<long>(remaining.count() % 1000000000);
+
+            int signal = sigtimedwait(&m_signals, nullptr, &timeout);
+            if (signal == SIGUSR1)
+            {
+                return Wake::TRIGGER;
+            }
+            if (signal == SIGTERM || signal == SIGINT)
+            {
+                return Wake::STOP;
+            }
+            if (signal < 0 && errno == EAGAIN)
+            {
+                return Wake::TIMER;
+            }
+            // EINTR from some other signal: keep waiting out the same deadline
+        }
+    }
+}  // namespace marksman
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <csignal>
+#include <random>
+
+namespace marksman
+{
+    // Paces the cycles of the long-running mode and turns signals into wake-ups.
+    //
+    // SIGUSR1 starts a cycle right away; SIGTERM and SIGINT stop the daemon. The constructor
+    // blocks those signals in the calling thread and wait() collects them with sigtimedwait,
+    // so nothing runs in a signal handler. Construct it before starting any other thread so
+    // every thread inherits the mask and the signals cannot be delivered elsewhere.
+    class CycleScheduler
+    {
+      public:
+        enum class Wake
+        {
+            TIMER,
+            TRIGGER,
+            STOP,
+        };
+
+        CycleScheduler(std::chrono::milliseconds interval, std::chrono::milliseconds jitter);
+        ~CycleScheduler();
+
+        CycleScheduler(const CycleScheduler &) = delete;
+        CycleScheduler &operator=(const CycleScheduler &) = delete;
+
+        // The interval moved by a uniformly random amount within +/- jitter, so several
+        // instances do not hit the API in lockstep
+        std::chrono::milliseconds nextDelay();
+        // Sleeps for delay unless a signal arrives first
+        Wake wait(std::chrono::milliseconds delay);
+
+      private:
+        std::chrono::milliseconds m_interval;
+        std::chrono::milliseconds m_jitter;
+        std::mt19937_64 m_random;
+        sigset_t m_signals;
+        sigset_t m_previousMask;
+    };
+}  // namespace marksman
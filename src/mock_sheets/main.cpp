@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "lib/network/http_server.hpp"
+
+#include "service.hpp"
+
+static std::string getEnvOr(const char *name, const std::string &fallback)
+{
+    const char *value = std::getenv(name);
+    return value != nullptr && *value != '\0' ? value : fallback;
+}
+
+// count transaction rows under a header row, the same on every start
+static std::vector<std::vector<nlohmann::json>> makeTransactionRows(std::size_t count)
+{
+    static const char *const ACCOUNTS[] = {"Cash", "BCA", "Jenius", "Credit Card"};
+    static const char *const SUBJECTS[] = {"Indomaret", "Starbucks", "Grab", "PLN",
+                                           "Netflix",   "Lunch",     "Rent", "Salary"};
+
+    std::vector<std::vector<nlohmann::json>> rows;
+    rows.reserve(count + 1);
+    rows.push_back({"Account", "Subject", "Date", "Amount", "Currency", "Category"});
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        // Sheets serial days from 2024-01-01, about 50 rows a day
+        double date = 45292.0 + static_cast<double>(i) / 50.0;
+        rows.push_back({ACCOUNTS[i % 4],
+                        std::string(SUBJECTS[(i / 4) % 8]) + " #" + std::to_string(i), date,
+                        -1000 * static_cast<long long>(i % 97 + 1), "IDR", nullptr});
+    }
+    return rows;
+}
+
+int main()
+{
+    mock_sheets::Faults faults;
+    faults.latency =
+        std::chrono::milliseconds(std::stol(getEnvOr("MOCK_SHEETS_LATENCY_MS", "0")));
+    faults.latencyJitter =
+        std::chrono::milliseconds(std::stol(getEnvOr("MOCK_SHEETS_LATENCY_JITTER_MS", "0")));
+    faults.errorRate = std::stod(getEnvOr("MOCK_SHEETS_ERROR_RATE", "0"));
+    faults.rateLimitRate = std::stod(getEnvOr("MOCK_SHEETS_RATE_LIMIT_RATE", "0"));
+    faults.retryAfterSeconds = std::stoi(getEnvOr("MOCK_SHEETS_RETRY_AFTER_SECONDS", "1"));
+
+    auto service = std::make_shared<mock_sheets::Service>(
+        faults, std::stoull(getEnvOr("MOCK_SHEETS_SEED", "1")));
+
+    // Start with MOCK_SHEETS_ROWS transactions in SHEET_ID, so there is something to read
+    std::string sheetId = getEnvOr("SHEET_ID", "");
+    std::size_t rows = std::stoul(getEnvOr("MOCK_SHEETS_ROWS", "0"));
+    if (!sheetId.empty() && rows > 0)
+    {
+        service->setValues(sheetId, "Transactions", makeTransactionRows(rows));
+        std::cout << "Seeded " << sheetId << " with " << rows << " transactions" << std::endl;
+    }
+
+    auto server = std::make_shared<network::HttpServer>();
+    int port = std::stoi(getEnvOr("MOCK_SHEETS_PORT", "8090"));
+    server->setPort(port);
+    server->setMaxBodySize(64 * 1024 * 1024);
+    server->setRequestHandler(
+        [service](const std::string &path, const std::string &method, const std::string &body)
+        { return service->handle(path, method, body); });
+
+    // Injected latency sleeps on a worker, so concurrent requests still overlap
+    std::size_t workers = std::stoul(getEnvOr("MOCK_SHEETS_WORKERS", "16"));
+    server->setWorkerPool(workers, workers * 16);
+
+    std::cout << "Serving on port " << port << "; point clients at it with"
+              << " SHEETS_API_BASE_URL=http://localhost:" << port << "/v4/spreadsheets/"
+              << " DRIVE_API_BASE_URL=http://localhost:" << port << "/drive/v3/files/"
+              << " GOOGLE_ACCESS_TOKEN=mock" << std::endl;
+    server->start();
+    server->run();
+}
@@ -0,0 +1,563 @@
+#include "service.hpp"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+
+namespace mock_sheets
+{
+    static const std::string SHEETS_PREFIX = "/v4/spreadsheets/";
+    static const std::string DRIVE_PREFIX = "/drive/v3/files/";
+    static const std::string APPEND_SUFFIX = ":append";
+
+    static network::HttpResponse jsonResponse(int code, const nlohmann::json &body)
+    {
+        return network::HttpResponse{code, body.dump(), "application/json", {}};
+    }
+
+    // Shaped like the errors of the real APIs
+    static network::HttpResponse errorResponse(int code, const std::string &status,
+                                               const std::string &message)
+    {
+        return jsonResponse(
+            code, {{"error", {{"code", code}, {"message", message}, {"status", status}}}});
+    }
+
+    static std::string percentDecode(const std::string &text)
+    {
+        std::string decoded;
+        decoded.reserve(text.size());
+        for (std::size_t i = 0; i < text.size(); ++i)
+        {
+            if (text[i] == '%' && i + 2 < text.size() &&
+                std::isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+                std::isxdigit(static_cast<unsigned char>(text[i + 2])))
+            {
+                decoded += static_cast<char>(std::stoi(text.substr(i + 1, 2), nullptr, 16));
+                i += 2;
+            }
+            else
+            {
+                decoded += text[i];
+            }
+        }
+        return decoded;
+    }
+
+    // Days since 1970-01-01 of a proleptic Gregorian date
+    static long long daysFromCivil(long long year, unsigned month, unsigned day)
+    {
+        year -= month <= 2 ? 1 : 0;
+        long long era = (year >= 0 ? year : year - 399) / 400;
+        auto yearOfEra = static_cast<unsigned>(year - era * 400);
+        unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+        unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + static_cast<long long>(dayOfEra) - 719468;
+    }
+
+    // How Sheets stores a USER_ENTERED string: numbers and dates become numbers
+    static nlohmann::json userEntered(const std::string &text)
+    {
+        if (text.empty())
+        {
+            return nullptr;
+        }
+
+        char first = text.front();
+        if (std::isdigit(static_cast<unsigned char>(first)) || first == '-' || first == '+' ||
+            first == '.')
+        {
+            char *end = nullptr;
+            if (text.find_first_of(".eE") == std::string::npos)
+            {
+                long long integer = std::strtoll(text.c_str(), &end, 10);
+                if (end == text.c_str() + text.size())
+                {
+                    return integer;
+                }
+            }
+            double number = std::strtod(text.c_str(), &end);
+            if (end == text.c_str() + text.size())
+            {
+                return number;
+            }
+        }
+
+        int year = 0;
+        unsigned month = 0, day = 0, hour = 0, minute = 0, second = 0;
+        int length = 0;
+        int fields = std::sscanf(text.c_str(), "%4d-%2u-%2u%n %2u:%2u:%2u%n", &year, &month,
+                                 &day, &length, &hour, &minute, &second, &length);
+        if ((fields == 3 || fields == 6) && static_cast<std::size_t>(length) == text.size() &&
+            month >= 1 && month <= 12 && day >= 1 && day <= 31 && hour < 24 && minute < 60 &&
+            second < 60)
+        {
+            // Sheets counts days from 1899-12-30, 25569 days before the epoch
+            double serial = static_cast<double>(daysFromCivil(year, month, day) + 25569) +
+                            (hour * 3600 + minute * 60 + second) / 86400.0;
+            return serial;
+        }
+
+        return text;
+    }
+
+    static std::size_t columnIndex(const std::string &letters)
+    {
+        std::size_t index = 0;
+        for (char c : letters)
+        {
+            index = index * 26 + static_cast<std::size_t>(c - 'A' + 1);
+        }
+        return index - 1;
+    }
+
+    static std::string columnLetters(std::size_t index)
+    {
+        std::string letters;
+        for (++index; index > 0; index = (index - 1) / 26)
+        {
+            letters.insert(letters.begin(), static_cast<char>('A' + (index - 1) % 26));
+        }
+        return letters;
+    }
+
+    Service::Service(Faults faults, std::uint64_t seed) : m_faults(faults), m_random(seed)
+    {
+    }
+
+    void Service::setFaults(const Faults &faults)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_faults = faults;
+    }
+
+    void Service::setValues(const std::string &spreadsheetId, const std::string &sheetName,
+                            const std::vector<std::vector<nlohmann::json>> &rows)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Spreadsheet &spreadsheet = m_spreadsheets[spreadsheetId];
+        spreadsheet.sheets[sheetName] = rows;
+        ++spreadsheet.version;
+    }
+
+    std::vector<std::vector<nlohmann::json>> Service::values(const std::string &spreadsheetId,
+                                                             const std::string &sheetName)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_spreadsheets[spreadsheetId].sheets[sheetName];
+    }
+
+    std::uint64_t Service::version(const std::string &spreadsheetId)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_spreadsheets[spreadsheetId].version;
+    }
+
+    network::HttpResponse Service::handle(const std::string &path, const std::string &method,
+                                          const std::string &body)
+    {
+        network::HttpResponse fault = injectFault();
+        if (fault.code != 0)
+        {
+            return fault;
+        }
+
+        try
+        {
+            return route(percentDecode(path), method, body);
+        }
+        catch (const std::exception &e)
+        {
+            return errorResponse(400, "INVALID_ARGUMENT", e.what());
+        }
+    }
+
+    network::HttpResponse Service::injectFault()
+    {
+        std::chrono::milliseconds delay{0};
+        double roll = 0.0;
+        Faults faults;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            faults = m_faults;
+            delay = faults.latency;
+            if (faults.latencyJitter.count() > 0)
+            {
+                std::uniform_int_distribution<long long> jitter(0, faults.latencyJitter.count());
+                delay += std::chrono::milliseconds(jitter(m_random));
+            }
+            roll = std::uniform_real_distribution<double>(0.0, 1.0)(m_random);
+        }
+
+        // Sleep outside the lock so slow requests still overlap
+        if (delay.count() > 0)
+        {
+            std::this_thread::sleep_for(delay);
+        }
+
+        if (roll < faults.rateLimitRate)
+        {
+            network::HttpResponse response = errorResponse(
+                429, "RESOURCE_EXHAUSTED", "Quota exceeded for quota metric 'Read requests'");
+            response.headers.emplace_back("Retry-After",
+                                          std::to_string(faults.retryAfterSeconds));
+            return response;
+        }
+        if (roll < faults.rateLimitRate + faults.errorRate)
+        {
+            return errorResponse(503, "UNAVAILABLE", "The service is currently unavailable.");
+        }
+        return network::HttpResponse{0, "", "", {}};
+    }
+
+    network::HttpResponse Service::route(const std::string &path, const std::string &method,
+                                         const std::string &body)
+    {
+        if (path.compare(0, DRIVE_PREFIX.size(), DRIVE_PREFIX) == 0)
+        {
+            std::string spreadsheetId = path.substr(DRIVE_PREFIX.size());
+            if (method != "GET" || spreadsheetId.empty() ||
+                spreadsheetId.find('/') != std::string::npos)
+            {
+                return errorResponse(404, "NOT_FOUND", "Not found: " + path);
+            }
+            // Drive sends the version, an int64, as a string
+            return jsonResponse(200, {{"version", std::to_string(version(spreadsheetId))}});
+        }
+
+        if (path.compare(0, SHEETS_PREFIX.size(), SHEETS_PREFIX) != 0)
+        {
+            return errorResponse(404, "NOT_FOUND", "Not found: " + path);
+        }
+
+        std::string rest = path.substr(SHEETS_PREFIX.size());
+        std::size_t slash = rest.find('/');
+        if (slash == std::string::npos || slash == 0)
+        {
+            return errorResponse(404, "NOT_FOUND", "Not found: " + path);
+        }
+        std::string spreadsheetId = rest.substr(0, slash);
+        std::string operation = rest.substr(slash + 1);
+
+        if (operation == "values:batchUpdate" && method == "POST")
+        {
+            return batchUpdate(spreadsheetId, nlohmann::json::parse(body));
+        }
+        if (operation.compare(0, 7, "values/") != 0)
+        {
+            return errorResponse(404, "NOT_FOUND", "Not found: " + path);
+        }
+
+        std::string a1 = operation.substr(7);
+        bool append = a1.size() > APPEND_SUFFIX.size() &&
+                      a1.compare(a1.size() - APPEND_SUFFIX.size(), APPEND_SUFFIX.size(),
+                                 APPEND_SUFFIX) == 0;
+        if (append && method == "POST")
+        {
+            a1.resize(a1.size() - APPEND_SUFFIX.size());
+            return appendValues(spreadsheetId, parseRange(a1), nlohmann::json::parse(body));
+        }
+        if (!append && method == "GET")
+        {
+            return getValues(spreadsheetId, parseRange(a1));
+        }
+        if (!append && method == "PUT")
+        {
+            return updateValues(spreadsheetId, parseRange(a1), nlohmann::json::parse(body));
+        }
+        return errorResponse(404, "NOT_FOUND", "Not found: " + method + " " + path);
+    }
+
+    Service::Range Service::parseRange(const std::string &a1)
+    {
+        Range range;
+        std::size_t bang = a1.rfind('!');
+        if (bang == std::string::npos)
+        {
+            // A bare sheet name is the whole sheet
+            range.sheet = a1;
+        }
+        else
+        {
+            range.sheet = a1.substr(0, bang);
+            if (range.sheet.size() >= 2 && range.sheet.front() == '\'' &&
+                range.sheet.back() == '\'')
+            {
+                range.sheet = range.sheet.substr(1, range.sheet.size() - 2);
+            }
+        }
+        if (range.sheet.empty())
+        {
+            throw std::runtime_error("Unable to parse range: " + a1);
+        }
+        if (bang == std::string::npos)
+        {
+            return range;
+        }
+
+        // Cell references like "A2", "A" or "2"
+        std::string cells = a1.substr(bang + 1);
+        std::size_t position = 0;
+        auto reference = [&cells, &position, &a1](std::size_t &column, std::size_t &row)
+        {
+            std::string letters;
+            while (position < cells.size() &&
+                   std::isupper(static_cast<unsigned char>(cells[position])))
+            {
+                letters += cells[position++];
+            }
+            std::string digits;
+            while (position < cells.size() &&
+                   std::isdigit(static_cast<unsigned char>(cells[position])))
+            {
+                digits += cells[position++];
+            }
+            if ((letters.empty() && digits.empty()) || letters.size() > 3 || digits.size() > 7 ||
+                (!digits.empty() && std::stoul(digits) == 0))
+            {
+                throw std::runtime_error("Unable to parse range: " + a1);
+            }
+            column = letters.empty() ? SIZE_MAX : columnIndex(letters);
+            row = digits.empty() ? SIZE_MAX : std::stoul(digits) - 1;
+        };
+
+        std::size_t startColumn = 0, startRow = 0;
+        reference(startColumn, startRow);
+        range.firstColumn = startColumn == SIZE_MAX ? 0 : startColumn;
+        range.firstRow = startRow == SIZE_MAX ? 0 : startRow;
+
+        if (position == cells.size())
+        {
+            // A single cell
+            range.endColumn = startColumn == SIZE_MAX ? SIZE_MAX : startColumn + 1;
+            range.endRow = startRow == SIZE_MAX ? SIZE_MAX : startRow + 1;
+            return range;
+        }
+        if (cells[position++] != ':')
+        {
+            throw std::runtime_error("Unable to parse range: " + a1);
+        }
+
+        std::size_t endColumn = 0, endRow = 0;
+        reference(endColumn, endRow);
+        if (position != cells.size() ||
+            (endColumn != SIZE_MAX && endColumn < range.firstColumn) ||
+            (endRow != SIZE_MAX && endRow < range.firstRow))
+        {
+            throw std::runtime_error("Unable to parse range: " + a1);
+        }
+        range.endColumn = endColumn == SIZE_MAX ? SIZE_MAX : endColumn + 1;
+        range.endRow = endRow == SIZE_MAX ? SIZE_MAX : endRow + 1;
+        return range;
+    }
+
+    std::string Service::formatRange(const std::string &sheet, std::size_t firstColumn,
+                                     std::size_t firstRow, std::size_t columns, std::size_t rows)
+    {
+        std::string range =
+            sheet + "!" + columnLetters(firstColumn) + std::to_string(firstRow + 1);
+        if (columns > 1 || rows > 1)
+        {
+            range += ":" + columnLetters(firstColumn + std::max<std::size_t>(columns, 1) - 1) +
+                     std::to_string(firstRow + std::max<std::size_t>(rows, 1));
+        }
+        return range;
+    }
+
+    network::HttpResponse Service::getValues(const std::string &spreadsheetId,
+                                             const Range &range)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const Grid &grid = m_spreadsheets[spreadsheetId].sheets[range.sheet];
+
+        nlohmann::json rows = nlohmann::json::array();
+        std::size_t lastRow = std::min(range.endRow, grid.size());
+        std::size_t columns = 0;
+        for (std::size_t r = range.firstRow; r < lastRow; ++r)
+        {
+            const std::vector<nlohmann::json> &cells = grid[r];
+            std::size_t end = std::min(range.endColumn, cells.size());
+            // Like Sheets, trailing empty cells are left out and empty cells inside are ""
+            while (end > range.firstColumn && cells[end - 1].is_null())
+            {
+                --end;
+            }
+
+            nlohmann::json row = nlohmann::json::array();
+            for (std::size_t c = range.firstColumn; c < end; ++c)
+            {
+                row.push_back(cells[c].is_null() ? nlohmann::json("") : cells[c]);
+            }
+            columns = std::max(columns, row.size());
+            rows.push_back(std::move(row));
+        }
+        while (!rows.empty() && rows.back().empty())
+        {
+            rows.erase(rows.size() - 1);
+        }
+
+        nlohmann::json response = {
+            {"range", formatRange(range.sheet, range.firstColumn, range.firstRow, columns,
+                                  rows.size())},
+            {"majorDimension", "ROWS"},
+        };
+        // An empty range has no "values" at all
+        if (!rows.empty())
+        {
+            response["values"] = std::move(rows);
+        }
+        return jsonResponse(200, response);
+    }
+
+    void Service::checkWrite(const Range &range, const nlohmann::json &values)
+    {
+        if (!values.is_array())
+        {
+            throw std::runtime_error("values must be an array of rows");
+        }
+        for (std::size_t r = 0; r < values.size(); ++r)
+        {
+            if (!values[r].is_array())
+            {
+                throw std::runtime_error("values must be an array of rows");
+            }
+            if ((range.endRow != SIZE_MAX && range.firstRow + r >= range.endRow) ||
+                (range.endColumn != SIZE_MAX &&
+                 range.firstColumn + values[r].size() > range.endColumn))
+            {
+                throw std::runtime_error("Requested writing outside of the range");
+            }
+        }
+    }
+
+    std::size_t Service::write(Spreadsheet &spreadsheet, const Range &range,
+                               const nlohmann::json &values)
+    {
+        // Check before touching anything, so a bad request changes nothing
+        checkWrite(range, values);
+
+        Grid &grid = spreadsheet.sheets[range.sheet];
+        std::size_t cells = 0;
+        for (std::size_t r = 0; r < values.size(); ++r)
+        {
+            std::size_t row = range.firstRow + r;
+            if (grid.size() <= row)
+            {
+                grid.resize(row + 1);
+            }
+            for (std::size_t c = 0; c < values[r].size(); ++c)
+            {
+                std::size_t column = range.firstColumn + c;
+                if (grid[row].size() <= column)
+                {
+                    grid[row].resize(column + 1);
+                }
+                const nlohmann::json &value = values[r][c];
+                grid[row][column] = value.is_string() ? userEntered(value.get<std::string>())
+                                                      : value;
+                ++cells;
+            }
+        }
+        ++spreadsheet.version;
+        return cells;
+    }
+
+    network::HttpResponse Service::updateValues(const std::string &spreadsheetId,
+                                                const Range &range, const nlohmann::json &request)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const nlohmann::json &values = request.at("values");
+        std::size_t cells = write(m_spreadsheets[spreadsheetId], range, values);
+
+        std::size_t columns = 0;
+        for (const auto &row : values)
+        {
+            columns = std::max(columns, row.size());
+        }
+        return jsonResponse(
+            200, {{"spreadsheetId", spreadsheetId},
+                  {"updatedRange", formatRange(range.sheet, range.firstColumn, range.firstRow,
+                                               columns, values.size())},
+                  {"updatedRows", values.size()},
+                  {"updatedColumns", columns},
+                  {"updatedCells", cells}});
+    }
+
+    network::HttpResponse Service::appendValues(const std::string &spreadsheetId,
+                                                const Range &range, const nlohmann::json &request)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Spreadsheet &spreadsheet = m_spreadsheets[spreadsheetId];
+        const Grid &grid = spreadsheet.sheets[range.sheet];
+
+        // The new rows go right after the last row with anything in the range's columns
+        std::size_t next = range.firstRow;
+        for (std::size_t r = range.firstRow; r < grid.size(); ++r)
+        {
+            std::size_t end = std::min(range.endColumn, grid[r].size());
+            for (std::size_t c = range.firstColumn; c < end; ++c)
+            {
+                if (!grid[r][c].is_null())
+                {
+                    next = r + 1;
+                    break;
+                }
+            }
+        }
+
+        Range target = range;
+        target.firstRow = next;
+        target.endRow = SIZE_MAX;
+        const nlohmann::json &values = request.at("values");
+        std::size_t cells = write(spreadsheet, target, values);
+
+        std::size_t columns = 0;
+        for (const auto &row : values)
+        {
+            columns = std::max(columns, row.size());
+        }
+        return jsonResponse(
+            200, {{"spreadsheetId", spreadsheetId},
+                  {"updates",
+                   {{"spreadsheetId", spreadsheetId},
+                    {"updatedRange", formatRange(range.sheet, range.firstColumn, next, columns,
+                                                 values.size())},
+                    {"updatedRows", values.size()},
+                    {"updatedColumns", columns},
+                    {"updatedCells", cells}}}});
+    }
+
+    network::HttpResponse Service::batchUpdate(const std::string &spreadsheetId,
+                                               const nlohmann::json &request)
+    {
+        // Check every entry first; like the real API, one bad entry fails the whole batch
+        const nlohmann::json &data = request.at("data");
+        std::vector<Range> ranges;
+        for (const auto &entry : data)
+        {
+            ranges.push_back(parseRange(entry.at("range").get<std::string>()));
+        }
+
+        for (std::size_t i = 0; i < ranges.size(); ++i)
+        {
+            checkWrite(ranges[i], data[i].at("values"));
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Spreadsheet &spreadsheet = m_spreadsheets[spreadsheetId];
+        std::uint64_t version = spreadsheet.version;
+        std::size_t totalCells = 0;
+        for (std::size_t i = 0; i < ranges.size(); ++i)
+        {
+            totalCells += write(spreadsheet, ranges[i], data[i].at("values"));
+        }
+        // One batch is one revision
+        spreadsheet.version = version + 1;
+
+        return jsonResponse(200, {{"spreadsheetId", spreadsheetId},
+                                  {"totalUpdatedRanges", ranges.size()},
+                                  {"totalUpdatedCells", totalCells}});
+    }
+}  // namespace mock_sheets
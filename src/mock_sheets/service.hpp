@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lib/network.hpp"
+
+namespace mock_sheets
+{
+    // What goes wrong, and how slowly, before a request is served
+    struct Faults
+    {
+        std::chrono::milliseconds latency{0};
+        // Added to latency, uniformly between 0 and this
+        std::chrono::milliseconds latencyJitter{0};
+        // Share of requests answered with 503
+        double errorRate = 0.0;
+        // Share of requests answered with 429 and a Retry-After header
+        double rateLimitRate = 0.0;
+        int retryAfterSeconds = 1;
+    };
+
+    // In-memory stand-in for the parts of the Sheets v4 and Drive v3 APIs that sheet::Client
+    // uses: values get, update, append and batchUpdate, and the Drive file version.
+    //
+    // Spreadsheets come into existence, empty, the first time they are addressed. Cells keep
+    // JSON values; written strings are interpreted like USER_ENTERED input, so numbers and
+    // "YYYY-MM-DD hh:mm:ss" dates become numbers (dates as Sheets serial days), and are
+    // read back as stored, like UNFORMATTED_VALUE. The version of a spreadsheet goes up with
+    // every write. handle() is safe to call from several threads at once.
+    class Service
+    {
+      public:
+        explicit Service(Faults faults = {}, std::uint64_t seed = 1);
+
+        void setFaults(const Faults &faults);
+
+        // Replaces the contents of a sheet, starting at A1
+        void setValues(const std::string &spreadsheetId, const std::string &sheetName,
+                       const std::vector<std::vector<nlohmann::json>> &rows);
+        std::vector<std::vector<nlohmann::json>> values(const std::string &spreadsheetId,
+                                                        const std::string &sheetName);
+        std::uint64_t version(const std::string &spreadsheetId);
+
+        // A network::RequestHandler: path relative to the server root, e.g.
+        // "/v4/spreadsheets/<id>/values/Transactions!A2:F" or "/drive/v3/files/<id>"
+        network::HttpResponse handle(const std::string &path, const std::string &method,
+                                     const std::string &body);
+
+      private:
+        using Grid = std::vector<std::vector<nlohmann::json>>;
+
+        struct Spreadsheet
+        {
+            std::map<std::string, Grid> sheets;
+            std::uint64_t version = 1;
+        };
+
+        struct Range
+        {
+            std::string sheet;
+            std::size_t firstColumn = 0;
+            std::size_t firstRow = 0;
+            // One past the last; SIZE_MAX when open-ended, as in "A2:F" or "A:D"
+            std::size_t endColumn = SIZE_MAX;
+            std::size_t endRow = SIZE_MAX;
+        };
+
+        std::mutex m_mutex;
+        Faults m_faults;
+        std::mt19937_64 m_random;
+        std::map<std::string, Spreadsheet> m_spreadsheets;
+
+        static Range parseRange(const std::string &a1);
+        static std::string formatRange(const std::string &sheet, std::size_t firstColumn,
+                                       std::size_t firstRow, std::size_t columns,
+                                       std::size_t rows);
+
+        network::HttpResponse injectFault();
+        network::HttpResponse route(const std::string &path, const std::string &method,
+                                    const std::string &body);
+        network::HttpResponse getValues(const std::string &spreadsheetId, const Range &range);
+        static void checkWrite(const Range &range, const nlohmann::json &values);
+        std::size_t write(Spreadsheet &spreadsheet, const Range &range,
+                          const nlohmann::json &values);
+        network::HttpResponse updateValues(const std::string &spreadsheetId, const Range &range,
+                                           const nlohmann::json &request);
+        network::HttpResponse appendValues(const std::string &spreadsheetId, const Range &range,
+                                           const nlohmann::json &request);
+        network::HttpResponse batchUpdate(const std::string &spreadsheetId,
+                                          const nlohmann::json &request);
+    };
+}  // namespace mock_sheets
@@ -1,29 +1,273 @@
 #include "discord.hpp"
 
-#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <future>
 #include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
 #include "lib/network.hpp"
 
 namespace reporter
 {
-    Discord::Discord(std::shared_ptr<network::RequesterInterface> p_requester, std::string botToken)
-        : mp_requester(std::move(p_requester)), m_botToken(botToken)
+    using Clock = network::TokenBucket::Clock;
+
+    // Discord's documented defaults; the response headers take over once they arrive
+    static const std::size_t GLOBAL_REQUESTS_PER_SECOND = 50;
+    static const std::size_t CHANNEL_MESSAGES = 5;
+    static const std::chrono::seconds CHANNEL_PERIOD(5);
+    static const int MAX_ATTEMPTS = 5;
+
+    static bool isContinuationByte(char c)
+    {
+        return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+    }
+
+    static std::size_t codepointCount(const std::string &text, std::size_t begin,
+                                      std::size_t end)
     {
+        std::size_t count = 0;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            count += isContinuationByte(text[i]) ? 0u : 1u;
+        }
+        return count;
     }
 
-    void Discord::sendMessage(std::string channelId, std::string content)
+    std::vector<std::string> splitMessage(const std::string &content, std::size_t limit)
     {
-        std::string url = "https://discord.com/api/channels/" + channelId + "/messages";
-        std::vector<std::string> headers = {
-            "Authorization: Bot " + m_botToken,
-            "Content-Type: application/json",
+        if (limit == 0)
+        {
+            throw std::runtime_error("message limit must be positive");
+        }
+
+        std::vector<std::string> messages;
+        std::string current;
+        std::size_t currentLength = 0;
+        auto flush = [&messages, &current, &currentLength]()
+        {
+            if (current.find_first_not_of(" \t\n") != std::string::npos)
+            {
+                messages.push_back(std::move(current));
+            }
+            current.clear();
+            currentLength = 0;
         };
 
+        std::size_t lineStart = 0;
+        while (lineStart < content.size())
+        {
+            std::size_t lineEnd = std::min(content.find('\n', lineStart), content.size());
+            std::size_t lineLength = codepointCount(content, lineStart, lineEnd);
+
+            if (lineLength > limit)
+            {
+                // No line boundary to cut at: cut the line itself into full pieces
+                flush();
+                std::size_t pieceStart = lineStart;
+                while (pieceStart < lineEnd)
+                {
+                    std::size_t pieceEnd = pieceStart;
+                    std::size_t pieceLength = 0;
+                    while (pieceEnd < lineEnd && pieceLength < limit)
+                    {
+                        ++pieceEnd;
+                        while (pieceEnd < lineEnd && isContinuationByte(content[pieceEnd]))
+                        {
+                            ++pieceEnd;
+                        }
+                        ++pieceLength;
+                    }
+                    current.assign(content, pieceStart, pieceEnd - pieceStart);
+                    currentLength = pieceLength;
+                    if (pieceEnd < lineEnd)
+                    {
+                        flush();
+                    }
+                    pieceStart = pieceEnd;
+                }
+            }
+            else
+            {
+                std::size_t separator = current.empty() ? 0 : 1;
+                if (currentLength + separator + lineLength > limit)
+                {
+                    flush();
+                    separator = 0;
+                }
+                if (separator != 0)
+                {
+                    current += '\n';
+                }
+                current.append(content, lineStart, lineEnd - lineStart);
+                currentLength += separator + lineLength;
+            }
+            lineStart = lineEnd + 1;
+        }
+        flush();
+        return messages;
+    }
+
+    // A header or JSON value in seconds, fractions allowed
+    static bool parseSeconds(const std::string &text, Clock::duration &out)
+    {
+        char *end = nullptr;
+        double seconds = std::strtod(text.c_str(), &end);
+        if (text.empty() || end != text.c_str() + text.size() || !(seconds >= 0))
+        {
+            return false;
+        }
+        out = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+        return true;
+    }
+
+    // How long a 429 asks to wait: the precise body value, then the headers, then a second
+    static Clock::duration retryAfter(const network::Response &response, bool &global)
+    {
+        Clock::duration delay = std::chrono::seconds(1);
+        global = response.header("x-ratelimit-global") == "true" ||
+                 response.header("x-ratelimit-scope") == "global";
+
+        nlohmann::json body = nlohmann::json::parse(response.body, nullptr, false);
+        if (body.is_object() && body.contains("retry_after") && body["retry_after"].is_number())
+        {
+            global = global || (body.contains("global") && body["global"].is_boolean() &&
+                                body["global"].get<bool>());
+            double seconds = body["retry_after"].get<double>();
+            if (seconds >= 0)
+            {
+                return std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(seconds));
+            }
+        }
+        if (!parseSeconds(response.header("x-ratelimit-reset-after"), delay))
+        {
+            parseSeconds(response.header("retry-after"), delay);
+        }
+        return delay;
+    }
+
+    Discord::Discord(std::shared_ptr<network::RequesterInterface> p_requester, std::string botToken,
+                     std::string baseUrl)
+        : mp_requester(std::move(p_requester)), m_botToken(std::move(botToken)),
+          m_baseUrl(std::move(baseUrl)),
+          m_global(GLOBAL_REQUESTS_PER_SECOND, std::chrono::seconds(1))
+    {
+        if (m_baseUrl.empty() || m_baseUrl.back() != '/')
+        {
+            m_baseUrl += '/';
+        }
+    }
+
+    network::TokenBucket &Discord::channelBucket(const std::string &channelId)
+    {
+        auto it = m_channels.find(channelId);
+        if (it == m_channels.end())
+        {
+            it = m_channels
+                     .emplace(channelId, network::TokenBucket(CHANNEL_MESSAGES, CHANNEL_PERIOD))
+                     .first;
+        }
+        return it->second;
+    }
+
+    void Discord::waitForTurn(const std::string &channelId)
+    {
+        Clock::time_point at;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Clock::time_point now = Clock::now();
+            at = std::max(m_global.take(now), channelBucket(channelId).take(now));
+        }
+        std::this_thread::sleep_until(at);
+    }
+
+    void Discord::post(const std::string &channelId, const std::string &message)
+    {
         nlohmann::json body = nlohmann::json::object();
-        body["content"] = content;
+        body["content"] = message;
+        network::Request request{
+            "POST",
+            m_baseUrl + "channels/" + channelId + "/messages",
+            {"Authorization: Bot " + m_botToken, "Content-Type: application/json"},
+            body.dump(),
+        };
+
+        for (int attempt = 1;; ++attempt)
+        {
+            waitForTurn(channelId);
+            network::Response response = mp_requester->sendAsync(request).get();
+            Clock::time_point now = Clock::now();
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                network::TokenBucket &bucket = channelBucket(channelId);
+                Clock::duration resetAfter;
+                std::string remaining = response.header("x-ratelimit-remaining");
+                if (!remaining.empty() &&
+                    parseSeconds(response.header("x-ratelimit-reset-after"), resetAfter))
+                {
+                    bucket.update(std::strtoul(remaining.c_str(), nullptr, 10), resetAfter, now);
+                }
+
+                if (response.code == 429)
+                {
+                    bool global = false;
+                    Clock::duration delay = retryAfter(response, global);
+                    (global ? m_global : bucket).pauseUntil(now + delay);
+                }
+            }
+
+            if (response.code >= 200 && response.code < 300)
+            {
+                return;
+            }
+            if (response.code != 429 || attempt == MAX_ATTEMPTS)
+            {
+                throw std::runtime_error("Discord refused a message to channel " + channelId +
+                                         " with " + std::to_string(response.code) + ": " +
+                                         response.body);
+            }
+        }
+    }
+
+    void Discord::sendMessage(const std::string &channelId, const std::string &content)
+    {
+        for (const auto &message : splitMessage(content))
+        {
+            post(channelId, message);
+        }
+    }
+
+    void Discord::sendMessage(const std::vector<std::string> &channelIds,
+                              const std::string &content)
+    {
+        // Each channel has its own limit, so they only share the global one
+        std::vector<std::future<void>> deliveries;
+        deliveries.reserve(channelIds.size());
+        for (const auto &channelId : channelIds)
+        {
+            deliveries.push_back(std::async(std::launch::async, [this, &channelId, &content]()
+                                            { sendMessage(channelId, content); }));
+        }
 
-        mp_requester->postRequest(url, headers, body.dump());
+        std::string errors;
+        for (auto &delivery : deliveries)
+        {
+            try
+            {
+                delivery.get();
+            }
+            catch (const std::exception &e)
+            {
+                errors += errors.empty() ? e.what() : std::string("; ") + e.what();
+            }
+        }
+        if (!errors.empty())
+        {
+            throw std::runtime_error(errors);
+        }
     }
 }  // namespace reporter
@@ -1,21 +1,52 @@
 #pragma once
 
+#include <cstddef>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "lib/network.hpp"
+#include "lib/network/token_bucket.hpp"
 
 namespace reporter
 {
+    // Longest message Discord accepts, in characters
+    constexpr std::size_t MESSAGE_LIMIT = 2000;
+
+    // content as messages of at most limit characters (code points), cut between lines where
+    // possible and otherwise between code points. Blank pieces are dropped, since Discord
+    // rejects empty messages.
+    std::vector<std::string> splitMessage(const std::string &content,
+                                          std::size_t limit = MESSAGE_LIMIT);
+
     class Discord
     {
       private:
         std::shared_ptr<network::RequesterInterface> mp_requester;
         std::string m_botToken;
+        std::string m_baseUrl;
+
+        // Guards the buckets; requests are sent and waited for outside it
+        std::mutex m_mutex;
+        network::TokenBucket m_global;
+        std::map<std::string, network::TokenBucket> m_channels;
+
+        void post(const std::string &channelId, const std::string &message);
+        // Sleeps until both the global and the channel's limit allow another request
+        void waitForTurn(const std::string &channelId);
+        network::TokenBucket &channelBucket(const std::string &channelId);
 
       public:
-        Discord(std::shared_ptr<network::RequesterInterface> p_requester, std::string botToken);
+        Discord(std::shared_ptr<network::RequesterInterface> p_requester, std::string botToken,
+                std::string baseUrl = "https://discord.com/api/");
 
-        void sendMessage(std::string channelId, std::string content);
+        // Posts content as one or more messages, in order, waiting out rate limits. Throws
+        // std::runtime_error when a message is refused, or still rate limited after a few
+        // attempts.
+        void sendMessage(const std::string &channelId, const std::string &content);
+        // The same for every channel, concurrently; throws once all are done if any failed
+        void sendMessage(const std::vector<std::string> &channelIds, const std::string &content);
     };
 }  // namespace reporter
@@ -1,14 +1,21 @@
 #include <algorithm>
 #include <curl/curl.h>
 #include <iostream>
-#include <map>
+#include <sstream>
+#include <thread>
 #include <time.h>
 
-#include "lib/external/exec.hpp"
+#include "lib/auth/static_provider.hpp"
 #include "lib/network/requester.hpp"
+#include "lib/network/retrying_requester.hpp"
 #include "lib/sheet/client.hpp"
+#include "lib/sheet/ledger.hpp"
+#include "lib/sheet/snapshot.hpp"
 
 #include "discord.hpp"
+#include "period.hpp"
+#include "report.hpp"
+#include "rollup.hpp"
 
 int main(int argc, char *argv[])
 {
@@ -22,115 +29,102 @@ int main(int argc, char *argv[])
     if (sheetId == nullptr)
         throw std::runtime_error("SHEET_ID not found in env");
 
-    uint hours = 24 * 7;
-    if (argc >= 2)
-    {
-        hours = static_cast<uint>(std::stoul(argv[1]));
-    }
+    // A number of hours back from now, or a period for parsePeriod, or "wow" for the last 7
+    // days next to the 7 days before
+    std::string periodSpec = argc >= 2 ? argv[1] : std::to_string(24 * 7);
+    bool byHours = !periodSpec.empty() &&
+                   periodSpec.find_first_not_of("0123456789") == std::string::npos;
 
     curl_global_init(CURL_GLOBAL_DEFAULT);
 
     try
     {
-        // Get time point of 7 days ago
-        auto oneWeekAgo = std::chrono::system_clock::now() - std::chrono::hours(hours);
+        auto now = std::chrono::duration_cast<std::chrono::seconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
 
         // Get transactions
+        // Discord does its own rate limiting, so only Google requests go through the retries
         auto requester = std::make_shared<network::Requester>();
-        auto exec = std::make_shared<external::ShellExec>();
-        sheet::Client client(requester, exec);
+        auto googleRequester = std::make_shared<network::RetryingRequester>(requester);
+        auto tokenProvider = auth::tokenProviderFromEnv(googleRequester);
+        sheet::Client client(googleRequester, tokenProvider);
         client.setSheetId(sheetId);
-        auto transactions = client.getTransactions();
 
-        // Sort (newest first)
-        std::sort(transactions.begin(), transactions.end(),
-                  [](sheet::Transaction a, sheet::Transaction b) { return a.date > b.date; });
+        sheet::Ledger ledger;
+        // Reuse the local snapshot while the sheet is unchanged
+        char *snapshotPath = std::getenv("LEDGER_SNAPSHOT_FILE");
+        if (snapshotPath != nullptr && *snapshotPath != '\0')
+        {
+            ledger = sheet::Ledger::fromTransactions(
+                sheet::loadTransactions(client, sheetId, snapshotPath));
+        }
+        else
+        {
+            client.streamTransactions([&ledger](sheet::Transaction &&transaction)
+                                      { ledger.append(transaction); });
+        }
 
-        // Get transactions of the past week
-        std::size_t endIndex;
-        for (endIndex = 0; endIndex < transactions.size(); ++endIndex)
+        std::string linesMerged;
+        if (byHours)
+        {
+            auto since = now - static_cast<std::int64_t>(std::stoul(periodSpec)) * 3600;
+            concurrency::ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+            linesMerged = reporter::formatReport(reporter::totalsSince(ledger, since, pool));
+        }
+        else
         {
-            if (transactions[endIndex].date < oneWeekAgo)
+            // Day buckets, so each period is a sum over buckets rather than another pass
+            reporter::DailyRollup rollup;
+            rollup.append(ledger);
+
+            std::string label;
+            if (periodSpec == "wow")
             {
-                break;
+                reporter::Period week = reporter::parsePeriod("week", now);
+                reporter::Period weekBefore = reporter::previousPeriod(week);
+                label = week.label + " vs " + weekBefore.label;
+                linesMerged = reporter::formatComparison(rollup.totals(week),
+                                                         rollup.totals(weekBefore));
             }
-
-            // Give default category name if unspecified
-            if (transactions[endIndex].category.length() < 1)
+            else
             {
-                transactions[endIndex].category = "Uncategorized";
+                reporter::Period period = reporter::parsePeriod(periodSpec, now);
+                label = period.label;
+                linesMerged = reporter::formatReport(rollup.totals(period));
             }
-        }
-
-        // Calculate totals
-        using TotalsByCurrency = std::map<std::string, int>;
-        using TotalsByCategory = std::map<std::string, TotalsByCurrency>;
-        TotalsByCategory totals;
-        {
-            for (std::size_t i = 0; i < endIndex; ++i)
+            if (!linesMerged.empty())
             {
-                const auto &t = transactions[i];
-                if (totals.count(t.category) == 0)
-                {
-                    totals[t.category] = TotalsByCurrency{};
-                }
-
-                auto &byCategory = totals[t.category];
-                if (byCategory.count(t.currency) == 0)
-                {
-                    byCategory[t.currency] = 0;
-                }
-                byCategory[t.currency] += t.amount;
+                linesMerged = "__" + label + "__\n" + linesMerged;
             }
         }
-
-        auto toNumericString = [](const int &numeric) -> std::string
+        if (linesMerged.empty())
+        {
+            std::cout << "No transactions to report" << std::endl;
+        }
+        else
         {
-            std::string from = std::to_string(numeric);
-            std::string to = "";
-            int c = 0;
-            for (std::size_t i = from.size(); i >= 0; --i)
+            // DISCORD_CHANNEL_ID can list several channels, separated by commas
+            std::vector<std::string> channelIds;
+            std::istringstream channels(discordChannelId);
+            std::string channelId;
+            while (std::getline(channels, channelId, ','))
             {
-                to.insert(0, 1, from[i]);
-                if (++c > 3 && i != 0)
+                channelId.erase(0, channelId.find_first_not_of(' '));
+                channelId.erase(channelId.find_last_not_of(' ') + 1);
+                if (!channelId.empty())
                 {
-                    to.insert(0, 1, ',');
-                    c = 0;
+                    channelIds.push_back(channelId);
                 }
             }
-            return to;
-        };
-
-        std::vector<std::string> lines;
-        for (auto &byCategory : totals)
-        {
-            std::string amounts = "";
-            for (auto &byCurrency : byCategory.second)
-            {
-                amounts += toNumericString(std::abs(byCurrency.second)) + " " + byCurrency.first;
-                amounts += " | ";
-            }
-            amounts.erase(amounts.size() - 3, 3);
-            lines.push_back("**" + byCategory.first + "**: " + amounts);
-        }
 
-        std::string linesMerged;
-        auto iter = lines.begin();
-        while (true)
-        {
-            linesMerged += *iter;
-            if (++iter != lines.end())
-            {
-                linesMerged += "\n";
-            }
-            else
-            {
-                break;
-            }
+            const char *discordBaseUrl = std::getenv("DISCORD_API_BASE_URL");
+            reporter::Discord discord(requester, discordBotToken,
+                                      discordBaseUrl != nullptr && *discordBaseUrl != '\0'
+                                          ? discordBaseUrl
+                                          : "https://discord.com/api/");
+            discord.sendMessage(channelIds, linesMerged);
         }
-
-        reporter::Discord discord(requester, discordBotToken);
-        discord.sendMessage(discordChannelId, linesMerged);
     }
     catch (std::exception &e)
     {
@@ -0,0 +1,119 @@
+#include "period.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+
+namespace reporter
+{
+    static const std::int64_t SECONDS_PER_DAY = 24 * 60 * 60;
+
+    // Proleptic Gregorian calendar; see howardhinnant.github.io/date_algorithms.html
+    std::int64_t daysFromCivil(int year, unsigned month, unsigned day)
+    {
+        std::int64_t y = static_cast<std::int64_t>(year) - (month <= 2 ? 1 : 0);
+        std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+        auto yearOfEra = static_cast<unsigned>(y - era * 400);
+        unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+        unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + static_cast<std::int64_t>(dayOfEra) - 719468;
+    }
+
+    void civilFromDays(std::int64_t days, int &year, unsigned &month, unsigned &day)
+    {
+        days += 719468;
+        std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        auto dayOfEra = static_cast<unsigned>(days - era * 146097);
+        unsigned yearOfEra =
+            (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        unsigned monthIndex = (5 * dayOfYear + 2) / 153;
+        day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+        month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+        year = static_cast<int>(static_cast<std::int64_t>(yearOfEra) + era * 400 +
+                                (month <= 2 ? 1 : 0));
+    }
+
+    std::int64_t dayOf(std::int64_t date)
+    {
+        // Rounded down, also before the epoch
+        std::int64_t day = date / SECONDS_PER_DAY;
+        return date % SECONDS_PER_DAY < 0 ? day - 1 : day;
+    }
+
+    static std::int64_t parseDay(const std::string &text)
+    {
+        int year = 0;
+        unsigned month = 0, day = 0;
+        int length = 0;
+        if (std::sscanf(text.c_str(), "%4d-%2u-%2u%n", &year, &month, &day, &length) != 3 ||
+            static_cast<std::size_t>(length) != text.size() || month < 1 || month > 12 ||
+            day < 1 || day > 31)
+        {
+            throw std::runtime_error("invalid date: " + text);
+        }
+
+        // Reject days past the end of the month instead of rolling over
+        std::int64_t days = daysFromCivil(year, month, day);
+        int checkYear = 0;
+        unsigned checkMonth = 0, checkDay = 0;
+        civilFromDays(days, checkYear, checkMonth, checkDay);
+        if (checkMonth != month)
+        {
+            throw std::runtime_error("invalid date: " + text);
+        }
+        return days;
+    }
+
+    Period parsePeriod(const std::string &spec, std::int64_t now)
+    {
+        std::int64_t today = dayOf(now);
+        int year = 0;
+        unsigned month = 0, day = 0;
+        civilFromDays(today, year, month, day);
+
+        if (spec == "week")
+        {
+            return {today - 6, today + 1, "Last 7 days"};
+        }
+        if (spec == "month")
+        {
+            return {daysFromCivil(year, month, 1), today + 1, "Month to date"};
+        }
+        if (spec == "ytd")
+        {
+            return {daysFromCivil(year, 1, 1), today + 1, "Year to date"};
+        }
+
+        std::size_t separator = spec.find("..");
+        if (separator != std::string::npos)
+        {
+            std::int64_t first = parseDay(spec.substr(0, separator));
+            std::int64_t last = parseDay(spec.substr(separator + 2));
+            if (last < first)
+            {
+                throw std::runtime_error("period ends before it starts: " + spec);
+            }
+            return {first, last + 1, formatDay(first) + " to " + formatDay(last)};
+        }
+
+        throw std::runtime_error("unknown period: " + spec);
+    }
+
+    Period previousPeriod(const Period &period)
+    {
+        std::int64_t length = period.endDay - period.firstDay;
+        return {period.firstDay - length, period.firstDay,
+                formatDay(period.firstDay - length) + " to " + formatDay(period.firstDay - 1)};
+    }
+
+    std::string formatDay(std::int64_t day)
+    {
+        int year = 0;
+        unsigned month = 0, dayOfMonth = 0;
+        civilFromDays(day, year, month, dayOfMonth);
+
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", year, month, dayOfMonth);
+        return buffer;
+    }
+}  // namespace reporter
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace reporter
+{
+    // Whole UTC days, as days since 1970-01-01, from firstDay up to but not including endDay
+    struct Period
+    {
+        std::int64_t firstDay;
+        std::int64_t endDay;
+        std::string label;
+    };
+
+    std::int64_t daysFromCivil(int year, unsigned month, unsigned day);
+    void civilFromDays(std::int64_t days, int &year, unsigned &month, unsigned &day);
+    // The day a date (seconds since the epoch) falls on
+    std::int64_t dayOf(std::int64_t date);
+
+    // The report periods ending with today (the day of now):
+    //   "week"                    the last 7 days
+    //   "month"                   this calendar month so far
+    //   "ytd"                     this year so far
+    //   "YYYY-MM-DD..YYYY-MM-DD"  those days, both included
+    // Throws std::runtime_error on anything else
+    Period parsePeriod(const std::string &spec, std::int64_t now);
+    // The period of the same length right before period
+    Period previousPeriod(const Period &period);
+    std::string formatDay(std::int64_t day);
+}  // namespace reporter
@@ -0,0 +1,193 @@
+#include "report.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace reporter
+{
+    static void sumRows(const sheet::Ledger &ledger, std::int64_t from, std::int64_t until,
+                        std::size_t begin, std::size_t end, SumTable &sums)
+    {
+        const std::vector<std::int64_t> &dates = ledger.dates();
+        const std::vector<std::int64_t> &amounts = ledger.amounts();
+        const std::vector<std::uint32_t> &categories = ledger.categoryIds();
+        const std::vector<std::uint32_t> &currencies = ledger.currencyIds();
+
+        for (std::size_t row = begin; row < end; ++row)
+        {
+            if (dates[row] < from || dates[row] >= until)
+            {
+                continue;
+            }
+            sums.add(categories[row], currencies[row], amounts[row]);
+        }
+    }
+
+    SumTable sumsBetween(const sheet::Ledger &ledger, std::int64_t from, std::int64_t until)
+    {
+        SumTable sums;
+        sumRows(ledger, from, until, 0, ledger.size(), sums);
+        return sums;
+    }
+
+    SumTable sumsBetween(const sheet::Ledger &ledger, std::int64_t from, std::int64_t until,
+                         concurrency::ThreadPool &pool, std::size_t minChunkRows)
+    {
+        std::size_t rows = ledger.size();
+        std::size_t chunkCount =
+            std::min(pool.threadCount(),
+                     minChunkRows == 0 ? rows : (rows + minChunkRows - 1) / minChunkRows);
+        if (chunkCount <= 1)
+        {
+            return sumsBetween(ledger, from, until);
+        }
+
+        // Each range has its own table, so workers share nothing but the read-only ledger
+        std::vector<SumTable> chunkSums(chunkCount);
+        std::size_t chunkRows = (rows + chunkCount - 1) / chunkCount;
+        pool.parallelFor(chunkCount,
+                         [&ledger, from, until, rows, chunkRows, &chunkSums](std::size_t chunk)
+                         {
+                             std::size_t begin = std::min(chunk * chunkRows, rows);
+                             std::size_t end = std::min(begin + chunkRows, rows);
+                             sumRows(ledger, from, until, begin, end, chunkSums[chunk]);
+                         });
+
+        for (std::size_t chunk = 1; chunk < chunkCount; ++chunk)
+        {
+            chunkSums[0].merge(chunkSums[chunk]);
+        }
+        return std::move(chunkSums[0]);
+    }
+
+    TotalsByCategory totalsFromSums(const sheet::Ledger &ledger, const SumTable &sums)
+    {
+        // Names are looked up once per (category, currency), not per row
+        TotalsByCategory totals;
+        for (const SumTable::Entry &entry : sums.entries())
+        {
+            std::string_view category = ledger.categories().view(entry.category);
+            std::string_view currency = ledger.currencies().view(entry.currency);
+            std::string name = category.empty() ? "Uncategorized" : std::string(category);
+            totals[name][std::string(currency)] += entry.sum;
+        }
+        return totals;
+    }
+
+    TotalsByCategory totalsBetween(const sheet::Ledger &ledger, std::int64_t from,
+                                   std::int64_t until)
+    {
+        return totalsFromSums(ledger, sumsBetween(ledger, from, until));
+    }
+
+    TotalsByCategory totalsSince(const sheet::Ledger &ledger, std::int64_t since)
+    {
+        return totalsBetween(ledger, since, INT64_MAX);
+    }
+
+    TotalsByCategory totalsSince(const sheet::Ledger &ledger, std::int64_t since,
+                                 concurrency::ThreadPool &pool)
+    {
+        return totalsFromSums(ledger, sumsBetween(ledger, since, INT64_MAX, pool));
+    }
+
+    static std::uint64_t magnitude(std::int64_t amount)
+    {
+        // Negating INT64_MIN overflows; its magnitude still fits unsigned
+        return amount < 0 ? 0 - static_cast<std::uint64_t>(amount)
+                          : static_cast<std::uint64_t>(amount);
+    }
+
+    static std::string groupThousands(std::uint64_t value)
+    {
+        std::string digits = std::to_string(value);
+
+        std::string formatted;
+        for (std::size_t i = 0; i < digits.size(); ++i)
+        {
+            if (i != 0 && (digits.size() - i) % 3 == 0)
+            {
+                formatted += ',';
+            }
+            formatted += digits[i];
+        }
+        return formatted;
+    }
+
+    std::string formatAmount(std::int64_t amount)
+    {
+        return (amount < 0 ? "-" : "") + groupThousands(magnitude(amount));
+    }
+
+    std::string formatReport(const TotalsByCategory &totals)
+    {
+        std::string report;
+        for (const auto &byCategory : totals)
+        {
+            if (!report.empty())
+            {
+                report += "\n";
+            }
+
+            std::string amounts;
+            for (const auto &byCurrency : byCategory.second)
+            {
+                if (!amounts.empty())
+                {
+                    amounts += " | ";
+                }
+                // Spending and income are both shown as magnitudes
+                amounts += groupThousands(magnitude(byCurrency.second)) + " " + byCurrency.first;
+            }
+            report += "**" + byCategory.first + "**: " + amounts;
+        }
+        return report;
+    }
+
+    std::string formatComparison(const TotalsByCategory &current,
+                                 const TotalsByCategory &previous)
+    {
+        // Every (category, currency) of either period, in name order
+        std::map<std::string, std::map<std::string, std::pair<std::int64_t, std::int64_t>>>
+            merged;
+        for (const auto &byCategory : current)
+        {
+            for (const auto &byCurrency : byCategory.second)
+            {
+                merged[byCategory.first][byCurrency.first].first = byCurrency.second;
+            }
+        }
+        for (const auto &byCategory : previous)
+        {
+            for (const auto &byCurrency : byCategory.second)
+            {
+                merged[byCategory.first][byCurrency.first].second = byCurrency.second;
+            }
+        }
+
+        std::string report;
+        for (const auto &byCategory : merged)
+        {
+            if (!report.empty())
+            {
+                report += "\n";
+            }
+
+            std::string amounts;
+            for (const auto &byCurrency : byCategory.second)
+            {
+                if (!amounts.empty())
+                {
+                    amounts += " | ";
+                }
+                std::uint64_t now = magnitude(byCurrency.second.first);
+                std::uint64_t before = magnitude(byCurrency.second.second);
+                std::string change = now >= before ? "+" + groupThousands(now - before)
+                                                   : "-" + groupThousands(before - now);
+                amounts += groupThousands(now) + " " + byCurrency.first + " (" + change + ")";
+            }
+            report += "**" + byCategory.first + "**: " + amounts;
+        }
+        return report;
+    }
+}  // namespace reporter
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "lib/concurrency/thread_pool.hpp"
+#include "lib/sheet/ledger.hpp"
+
+#include "sum_table.hpp"
+
+namespace reporter
+{
+    using TotalsByCurrency = std::map<std::string, std::int64_t>;
+    using TotalsByCategory = std::map<std::string, TotalsByCurrency>;
+
+    // Sums the amounts of rows dated in [from, until) (seconds since the epoch) per category
+    // and currency id, in one pass over the ledger in row order; rows need not be sorted
+    SumTable sumsBetween(const sheet::Ledger &ledger, std::int64_t from, std::int64_t until);
+    // Same, with the rows split into one contiguous range per thread of pool, each summed into
+    // its own table and merged at the end. Ranges are at least minChunkRows long, so small
+    // ledgers stay on the calling thread.
+    SumTable sumsBetween(const sheet::Ledger &ledger, std::int64_t from, std::int64_t until,
+                         concurrency::ThreadPool &pool, std::size_t minChunkRows = 65536);
+    // The sums by name. Rows without a category are counted as "Uncategorized".
+    TotalsByCategory totalsFromSums(const sheet::Ledger &ledger, const SumTable &sums);
+
+    TotalsByCategory totalsBetween(const sheet::Ledger &ledger, std::int64_t from,
+                                   std::int64_t until);
+    // Rows dated at or after since
+    TotalsByCategory totalsSince(const sheet::Ledger &ledger, std::int64_t since);
+    TotalsByCategory totalsSince(const sheet::Ledger &ledger, std::int64_t since,
+                                 concurrency::ThreadPool &pool);
+
+    // 1234567 -> "1,234,567"
+    std::string formatAmount(std::int64_t amount);
+
+    // One "**Category**: 1,000 IDR | 5 USD" line per category, amounts without sign; empty
+    // when there are no totals
+    std::string formatReport(const TotalsByCategory &totals);
+    // Like formatReport, over the categories of both, with the change in magnitude from
+    // previous after each amount: "**Food**: 125,000 IDR (+12,000)"
+    std::string formatComparison(const TotalsByCategory &current,
+                                 const TotalsByCategory &previous);
+}  // namespace reporter
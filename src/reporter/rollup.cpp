@@ -0,0 +1,236 @@
+#include "rollup.hpp"
+
+#include <algorithm>
+
+namespace reporter
+{
+    static std::int64_t monthIndex(int year, unsigned month)
+    {
+        return static_cast<std::int64_t>(year) * 12 + month - 1;
+    }
+
+    std::size_t DailyRollup::GroupHash::operator()(
+        const std::pair<std::uint64_t, std::uint32_t> &key) const
+    {
+        std::uint64_t hash = (key.first ^ (static_cast<std::uint64_t>(key.second) << 17)) *
+                             0x9E3779B97F4A7C15ULL;
+        return static_cast<std::size_t>(hash ^ (hash >> 32));
+    }
+
+    DailyRollup::DailyRollup() : m_firstDay(0), m_firstMonth(0)
+    {
+    }
+
+    std::uint32_t DailyRollup::groupOf(std::uint32_t category, std::uint32_t currency,
+                                       std::uint32_t account)
+    {
+        auto key = std::make_pair(static_cast<std::uint64_t>(category) << 32 | currency, account);
+        auto it = m_groupIds.find(key);
+        if (it != m_groupIds.end())
+        {
+            return it->second;
+        }
+
+        auto id = static_cast<std::uint32_t>(m_groups.size());
+        m_groups.push_back({category, currency, account});
+        m_groupIds.emplace(key, id);
+        return id;
+    }
+
+    void DailyRollup::append(const sheet::Ledger &ledger, std::size_t fromRow)
+    {
+        // The ledger's ids mapped to ours, filled in as they are first seen
+        const std::uint32_t NONE = sheet::StringPool::NONE;
+        std::vector<std::uint32_t> categories(ledger.categories().size(), NONE);
+        std::vector<std::uint32_t> currencies(ledger.currencies().size(), NONE);
+        std::vector<std::uint32_t> accounts(ledger.accounts().size(), NONE);
+        auto translate = [](std::vector<std::uint32_t> &ids, const sheet::StringPool &from,
+                            sheet::StringPool &to, std::uint32_t id)
+        {
+            if (ids[id] == NONE)
+            {
+                ids[id] = to.intern(from.view(id));
+            }
+            return ids[id];
+        };
+
+        // Consecutive rows mostly share a group, so remember the last one
+        std::uint32_t lastKey[3] = {NONE, NONE, NONE};
+        std::uint32_t lastGroup = 0;
+        for (std::size_t row = fromRow; row < ledger.size(); ++row)
+        {
+            std::uint32_t category = ledger.categoryId(row);
+            std::uint32_t currency = ledger.currencyId(row);
+            std::uint32_t account = ledger.accountId(row);
+            if (category != lastKey[0] || currency != lastKey[1] || account != lastKey[2])
+            {
+                lastGroup = groupOf(translate(categories, ledger.categories(), m_categories,
+                                              category),
+                                    translate(currencies, ledger.currencies(), m_currencies,
+                                              currency),
+                                    translate(accounts, ledger.accounts(), m_accounts, account));
+                lastKey[0] = category;
+                lastKey[1] = currency;
+                lastKey[2] = account;
+            }
+            addToGroup(ledger.date(row), lastGroup, ledger.amount(row));
+        }
+    }
+
+    void DailyRollup::add(std::int64_t date, std::string_view category,
+                          std::string_view currency, std::string_view account,
+                          std::int64_t amount)
+    {
+        addToGroup(date,
+                   groupOf(m_categories.intern(category), m_currencies.intern(currency),
+                           m_accounts.intern(account)),
+                   amount);
+    }
+
+    void DailyRollup::addToGroup(std::int64_t date, std::uint32_t group, std::int64_t amount)
+    {
+        std::int64_t day = dayOf(date);
+        int year = 0;
+        unsigned month = 0, dayOfMonth = 0;
+        civilFromDays(day, year, month, dayOfMonth);
+
+        addToBucket(bucketAt(m_days, m_firstDay, day), group, amount);
+        addToBucket(bucketAt(m_months, m_firstMonth, monthIndex(year, month)), group, amount);
+    }
+
+    void DailyRollup::addToBucket(Bucket &bucket, std::uint32_t group, std::int64_t amount)
+    {
+        for (auto &entry : bucket)
+        {
+            if (entry.first == group)
+            {
+                entry.second += amount;
+                return;
+            }
+        }
+        bucket.emplace_back(group, amount);
+    }
+
+    DailyRollup::Bucket &DailyRollup::bucketAt(std::vector<Bucket> &buckets,
+                                               std::int64_t &first, std::int64_t index)
+    {
+        if (buckets.empty())
+        {
+            first = index;
+        }
+        if (index < first)
+        {
+            // An earlier row than any so far; rare, as sheets are mostly in date order
+            buckets.insert(buckets.begin(), static_cast<std::size_t>(first - index), Bucket());
+            first = index;
+        }
+        auto offset = static_cast<std::size_t>(index - first);
+        if (offset >= buckets.size())
+        {
+            buckets.resize(offset + 1);
+        }
+        return buckets[offset];
+    }
+
+    void DailyRollup::accumulate(const Period &period, std::vector<std::int64_t> &sums,
+                                 std::vector<bool> &present) const
+    {
+        sums.assign(m_groups.size(), 0);
+        present.assign(m_groups.size(), false);
+        if (m_days.empty())
+        {
+            return;
+        }
+
+        auto addBucket = [&sums, &present](const Bucket &bucket)
+        {
+            for (const auto &entry : bucket)
+            {
+                sums[entry.first] += entry.second;
+                present[entry.first] = true;
+            }
+        };
+
+        std::int64_t lastDay = m_firstDay + static_cast<std::int64_t>(m_days.size());
+        std::int64_t endDay = std::min(period.endDay, lastDay);
+        std::int64_t day = std::max(period.firstDay, m_firstDay);
+        while (day < endDay)
+        {
+            int year = 0;
+            unsigned month = 0, dayOfMonth = 0;
+            civilFromDays(day, year, month, dayOfMonth);
+
+            // A whole month in the window comes from its month bucket
+            if (dayOfMonth == 1)
+            {
+                std::int64_t nextMonth = month == 12 ? daysFromCivil(year + 1, 1, 1)
+                                                     : daysFromCivil(year, month + 1, 1);
+                if (nextMonth <= period.endDay)
+                {
+                    addBucket(m_months[static_cast<std::size_t>(monthIndex(year, month) -
+                                                                m_firstMonth)]);
+                    day = nextMonth;
+                    continue;
+                }
+            }
+
+            addBucket(m_days[static_cast<std::size_t>(day - m_firstDay)]);
+            ++day;
+        }
+    }
+
+    std::vector<std::int64_t> DailyRollup::sums(const Period &period) const
+    {
+        std::vector<std::int64_t> sums;
+        std::vector<bool> present;
+        accumulate(period, sums, present);
+        return sums;
+    }
+
+    TotalsByCategory DailyRollup::totals(const Period &period) const
+    {
+        std::vector<std::int64_t> sums;
+        std::vector<bool> present;
+        accumulate(period, sums, present);
+
+        // A group with rows in the period is reported even when they add up to 0
+        TotalsByCategory totals;
+        for (std::uint32_t id = 0; id < m_groups.size(); ++id)
+        {
+            if (!present[id])
+            {
+                continue;
+            }
+            std::string_view category = m_categories.view(m_groups[id].category);
+            std::string_view currency = m_currencies.view(m_groups[id].currency);
+            std::string name = category.empty() ? "Uncategorized" : std::string(category);
+            totals[name][std::string(currency)] += sums[id];
+        }
+        return totals;
+    }
+
+    std::size_t DailyRollup::groupCount() const
+    {
+        return m_groups.size();
+    }
+
+    const DailyRollup::Group &DailyRollup::group(std::uint32_t id) const
+    {
+        return m_groups.at(id);
+    }
+
+    const sheet::StringPool &DailyRollup::categories() const
+    {
+        return m_categories;
+    }
+
+    const sheet::StringPool &DailyRollup::currencies() const
+    {
+        return m_currencies;
+    }
+
+    const sheet::StringPool &DailyRollup::accounts() const
+    {
+        return m_accounts;
+    }
+}  // namespace reporter
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lib/sheet/ledger.hpp"
+
+#include "period.hpp"
+#include "report.hpp"
+
+namespace reporter
+{
+    // Per-day and per-month partial sums of the amounts of a ledger by (category, currency,
+    // account), so that the totals of any run of whole days are a sum over a few buckets
+    // instead of a pass over every row.
+    //
+    // A window is answered from the month buckets for the calendar months it fully covers
+    // and from day buckets for the rest, so a year takes at most about 12 + 60 buckets.
+    // Rows are added as they are appended to the sheet; a row that changed can be taken back
+    // out by adding it again with the amount negated. Names are interned in the rollup's own
+    // pools, so it can keep taking rows from one ledger after another.
+    class DailyRollup
+    {
+      public:
+        // Interned in categories(), currencies() and accounts()
+        struct Group
+        {
+            std::uint32_t category;
+            std::uint32_t currency;
+            std::uint32_t account;
+        };
+
+        DailyRollup();
+
+        DailyRollup(const DailyRollup &) = delete;
+        DailyRollup &operator=(const DailyRollup &) = delete;
+
+        // Adds rows fromRow onwards; pass the previous size of the ledger to add only the rows
+        // appended since
+        void append(const sheet::Ledger &ledger, std::size_t fromRow = 0);
+        void add(std::int64_t date, std::string_view category, std::string_view currency,
+                 std::string_view account, std::int64_t amount);
+
+        // The sums of every group over period, indexed by group id
+        std::vector<std::int64_t> sums(const Period &period) const;
+        // The same, by category and currency name; "" is counted as "Uncategorized"
+        TotalsByCategory totals(const Period &period) const;
+
+        std::size_t groupCount() const;
+        const Group &group(std::uint32_t id) const;
+        const sheet::StringPool &categories() const;
+        const sheet::StringPool &currencies() const;
+        const sheet::StringPool &accounts() const;
+
+      private:
+        // (group id, sum) pairs; a day rarely has more than a few dozen groups
+        using Bucket = std::vector<std::pair<std::uint32_t, std::int64_t>>;
+
+        struct GroupHash
+        {
+            std::size_t operator()(const std::pair<std::uint64_t, std::uint32_t> &key) const;
+        };
+
+        sheet::StringPool m_categories;
+        sheet::StringPool m_currencies;
+        sheet::StringPool m_accounts;
+        std::vector<Group> m_groups;
+        // ((category << 32) | currency, account) -> group id
+        std::unordered_map<std::pair<std::uint64_t, std::uint32_t>, std::uint32_t, GroupHash>
+            m_groupIds;
+
+        // m_days[i] is day m_firstDay + i; m_months[i] is month m_firstMonth + i, counted as
+        // year * 12 + month - 1
+        std::int64_t m_firstDay;
+        std::vector<Bucket> m_days;
+        std::int64_t m_firstMonth;
+        std::vector<Bucket> m_months;
+
+        std::uint32_t groupOf(std::uint32_t category, std::uint32_t currency,
+                              std::uint32_t account);
+        void accumulate(const Period &period, std::vector<std::int64_t> &sums,
+                        std::vector<bool> &present) const;
+        void addToGroup(std::int64_t date, std::uint32_t group, std::int64_t amount);
+        static void addToBucket(Bucket &bucket, std::uint32_t group, std::int64_t amount);
+        static Bucket &bucketAt(std::vector<Bucket> &buckets, std::int64_t &first,
+                                std::int64_t index);
+    };
+}  // namespace reporter
@@ -0,0 +1,133 @@
+#include "sum_table.hpp"
+
+#include <stdexcept>
+
+namespace reporter
+{
+    static std::uint64_t packKey(std::uint32_t category, std::uint32_t currency)
+    {
+        return static_cast<std::uint64_t>(category) << 32 | currency;
+    }
+
+    SumTable::SumTable(std::size_t expectedKeys) : m_size(0), m_shift(64 - 4)
+    {
+        // Start at 16 slots and keep at most half of them used
+        std::size_t capacity = 16;
+        while (capacity < expectedKeys * 2)
+        {
+            capacity *= 2;
+            --m_shift;
+        }
+        m_keys.assign(capacity, EMPTY);
+        m_sums.assign(capacity, 0);
+    }
+
+    std::size_t SumTable::slotOf(std::uint64_t key) const
+    {
+        // Fibonacci hashing: the top bits of the product are well mixed
+        return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ULL) >> m_shift);
+    }
+
+    void SumTable::add(std::uint32_t category, std::uint32_t currency, std::int64_t amount)
+    {
+        std::uint64_t key = packKey(category, currency);
+        if (key == EMPTY)
+        {
+            throw std::runtime_error("sum table key is reserved");
+        }
+
+        std::size_t mask = m_keys.size() - 1;
+        for (std::size_t slot = slotOf(key);; slot = (slot + 1) & mask)
+        {
+            if (m_keys[slot] == key)
+            {
+                m_sums[slot] += amount;
+                return;
+            }
+            if (m_keys[slot] == EMPTY)
+            {
+                if ((m_size + 1) * 2 > m_keys.size())
+                {
+                    grow();
+                    add(category, currency, amount);
+                    return;
+                }
+                m_keys[slot] = key;
+                m_sums[slot] = amount;
+                ++m_size;
+                return;
+            }
+        }
+    }
+
+    void SumTable::merge(const SumTable &other)
+    {
+        for (std::size_t slot = 0; slot < other.m_keys.size(); ++slot)
+        {
+            std::uint64_t key = other.m_keys[slot];
+            if (key != EMPTY)
+            {
+                add(static_cast<std::uint32_t>(key >> 32), static_cast<std::uint32_t>(key),
+                    other.m_sums[slot]);
+            }
+        }
+    }
+
+    std::size_t SumTable::size() const
+    {
+        return m_size;
+    }
+
+    bool SumTable::empty() const
+    {
+        return m_size == 0;
+    }
+
+    std::int64_t SumTable::sum(std::uint32_t category, std::uint32_t currency) const
+    {
+        std::uint64_t key = packKey(category, currency);
+        std::size_t mask = m_keys.size() - 1;
+        for (std::size_t slot = slotOf(key); m_keys[slot] != EMPTY; slot = (slot + 1) & mask)
+        {
+            if (m_keys[slot] == key)
+            {
+                return m_sums[slot];
+            }
+        }
+        return 0;
+    }
+
+    std::vector<SumTable::Entry> SumTable::entries() const
+    {
+        std::vector<Entry> entries;
+        entries.reserve(m_size);
+        for (std::size_t slot = 0; slot < m_keys.size(); ++slot)
+        {
+            if (m_keys[slot] != EMPTY)
+            {
+                entries.push_back({static_cast<std::uint32_t>(m_keys[slot] >> 32),
+                                   static_cast<std::uint32_t>(m_keys[slot]), m_sums[slot]});
+            }
+        }
+        return entries;
+    }
+
+    void SumTable::grow()
+    {
+        std::vector<std::uint64_t> keys(m_keys.size() * 2, EMPTY);
+        std::vector<std::int64_t> sums(m_sums.size() * 2, 0);
+        keys.swap(m_keys);
+        sums.swap(m_sums);
+        --m_shift;
+        m_size = 0;
+
+        for (std::size_t slot = 0; slot < keys.size(); ++slot)
+        {
+            if (keys[slot] != EMPTY)
+            {
+                add(static_cast<std::uint32_t>(keys[slot] >> 32),
+                    static_cast<std::uint32_t>(keys[slot]), sums[slot]);
+            }
+        }
+    }
+}  // namespace reporter
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace reporter
+{
+    // Running sums keyed by a (category id, currency id) pair, with the ids interned in one
+    // Ledger's pools.
+    //
+    // Open addressing with linear probing over a power-of-two array of packed 64-bit keys, so
+    // adding to a key that is already there is a hash, a probe or two and an addition, and
+    // only growing allocates.
+    class SumTable
+    {
+      public:
+        struct Entry
+        {
+            std::uint32_t category;
+            std::uint32_t currency;
+            std::int64_t sum;
+        };
+
+        explicit SumTable(std::size_t expectedKeys = 16);
+
+        void add(std::uint32_t category, std::uint32_t currency, std::int64_t amount);
+        // Adds every sum of other into this table
+        void merge(const SumTable &other);
+
+        std::size_t size() const;
+        bool empty() const;
+        // Zero when the pair was never added
+        std::int64_t sum(std::uint32_t category, std::uint32_t currency) const;
+        // The keys that were added to, in no particular order
+        std::vector<Entry> entries() const;
+
+      private:
+        // (StringPool::NONE, StringPool::NONE), which no row of a ledger has
+        static constexpr std::uint64_t EMPTY = UINT64_MAX;
+
+        std::vector<std::uint64_t> m_keys;
+        std::vector<std::int64_t> m_sums;
+        std::size_t m_size;
+        unsigned m_shift;
+
+        std::size_t slotOf(std::uint64_t key) const;
+        void grow();
+    };
+}  // namespace reporter
@@ -0,0 +1,153 @@
+#include "lib/auth/service_account.hpp"
+
+#include <algorithm>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+
+#include "lib/network/requester.hpp"
+
+class MockTokenRequester : public network::Requester
+{
+  public:
+    MOCK_METHOD(std::string, postRequest,
+                (const std::string &url, const std::vector<std::string> &headers,
+                 const std::string &body),
+                ());
+};
+
+class ServiceAccountTest : public ::testing::Test
+{
+  protected:
+    EVP_PKEY *key = nullptr;
+
+    void SetUp() override
+    {
+        key = EVP_RSA_gen(2048);
+        ASSERT_NE(key, nullptr);
+    }
+
+    void TearDown() override
+    {
+        EVP_PKEY_free(key);
+    }
+
+    std::string serviceAccountJson()
+    {
+        BIO *bio = BIO_new(BIO_s_mem());
+        PEM_write_bio_PrivateKey(bio, key, nullptr, nullptr, 0, nullptr, nullptr);
+        char *data = nullptr;
+        long length = BIO_get_mem_data(bio, &data);
+        std::string pem(data, static_cast<std::size_t>(length));
+        BIO_free(bio);
+
+        nlohmann::json json = {
+            {"client_email", "marksman@example.iam.gserviceaccount.com"},
+            {"private_key", pem},
+            {"token_uri", "https://oauth2.example.com/token"},
+        };
+        return json.dump();
+    }
+
+    static std::string base64UrlDecode(std::string input)
+    {
+        std::replace(input.begin(), input.end(), '-', '+');
+        std::replace(input.begin(), input.end(), '_', '/');
+        while (input.size() % 4 != 0)
+        {
+            input.push_back('=');
+        }
+
+        std::string output(input.size(), '\0');
+        int length = EVP_DecodeBlock(reinterpret_cast<unsigned char *>(output.data()),
+                                     reinterpret_cast<const unsigned char *>(input.data()),
+                                     static_cast<int>(input.size()));
+        auto padding = std::count(input.begin(), input.end(), '=');
+        output.resize(static_cast<std::size_t>(length - padding));
+        return output;
+    }
+
+    static std::string assertionFromBody(const std::string &body)
+    {
+        std::string marker = "&assertion=";
+        return body.substr(body.find(marker) + marker.size());
+    }
+};
+
+TEST_F(ServiceAccountTest, SignsAssertionWithServiceAccountKey)
+{
+    auto requester = std::make_shared<MockTokenRequester>();
+
+    std::string sentBody;
+    EXPECT_CALL(*requester,
+                postRequest("https://oauth2.example.com/token",
+                            testing::Contains("Content-Type: application/x-www-form-urlencoded"),
+                            testing::_))
+        .WillOnce(testing::DoAll(testing::SaveArg<2>(&sentBody),
+                                 testing::Return(R"({"access_token":"minted","expires_in":3600})")));
+
+    auth::ServiceAccountTokenProvider provider(requester, serviceAccountJson());
+    EXPECT_EQ(provider.getAccessToken("scope-a"), "minted");
+
+    std::string assertion = assertionFromBody(sentBody);
+    size_t firstDot = assertion.find('.');
+    size_t secondDot = assertion.find('.', firstDot + 1);
+    ASSERT_NE(secondDot, std::string::npos);
+
+    auto header = nlohmann::json::parse(base64UrlDecode(assertion.substr(0, firstDot)));
+    EXPECT_EQ(header["alg"], "RS256");
+
+    auto claims = nlohmann::json::parse(
+        base64UrlDecode(assertion.substr(firstDot + 1, secondDot - firstDot - 1)));
+    EXPECT_EQ(claims["iss"], "marksman@example.iam.gserviceaccount.com");
+    EXPECT_EQ(claims["scope"], "scope-a");
+    EXPECT_EQ(claims["aud"], "https://oauth2.example.com/token");
+    EXPECT_EQ(claims["exp"].get<long>() - claims["iat"].get<long>(), 3600);
+
+    std::string signingInput = assertion.substr(0, secondDot);
+    std::string signature = base64UrlDecode(assertion.substr(secondDot + 1));
+
+    EVP_MD_CTX *context = EVP_MD_CTX_new();
+    EVP_DigestVerifyInit(context, nullptr, EVP_sha256(), nullptr, key);
+    EVP_DigestVerifyUpdate(context, signingInput.data(), signingInput.size());
+    int verified =
+        EVP_DigestVerifyFinal(context, reinterpret_cast<const unsigned char *>(signature.data()),
+                              signature.size());
+    EVP_MD_CTX_free(context);
+
+    EXPECT_EQ(verified, 1);
+}
+
+TEST_F(ServiceAccountTest, CachesTokenPerScope)
+{
+    auto requester = std::make_shared<MockTokenRequester>();
+
+    EXPECT_CALL(*requester, postRequest(testing::_, testing::_, testing::_))
+        .Times(testing::Exactly(2))
+        .WillOnce(testing::Return(R"({"access_token":"token-a","expires_in":3600})"))
+        .WillOnce(testing::Return(R"({"access_token":"token-b","expires_in":3600})"));
+
+    auth::ServiceAccountTokenProvider provider(requester, serviceAccountJson());
+    EXPECT_EQ(provider.getAccessToken("scope-a"), "token-a");
+    EXPECT_EQ(provider.getAccessToken("scope-a"), "token-a");
+    EXPECT_EQ(provider.getAccessToken("scope-b"), "token-b");
+    EXPECT_EQ(provider.getAccessToken("scope-b"), "token-b");
+}
+
+TEST_F(ServiceAccountTest, RefreshesTokenWithinMarginOfExpiry)
+{
+    auto requester = std::make_shared<MockTokenRequester>();
+
+    // Expires in 2 minutes, which is inside the default 5 minute refresh margin
+    EXPECT_CALL(*requester, postRequest(testing::_, testing::_, testing::_))
+        .Times(testing::Exactly(2))
+        .WillOnce(testing::Return(R"({"access_token":"short-lived","expires_in":120})"))
+        .WillOnce(testing::Return(R"({"access_token":"renewed","expires_in":120})"));
+
+    auth::ServiceAccountTokenProvider provider(requester, serviceAccountJson());
+    EXPECT_EQ(provider.getAccessToken("scope-a"), "short-lived");
+    EXPECT_EQ(provider.getAccessToken("scope-a"), "renewed");
+}
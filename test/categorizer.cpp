@@ -2,6 +2,7 @@
 
 #include <gtest/gtest.h>
 #include <memory>
+#include <random>
 
 #include "lib/sheet.hpp"
 
@@ -169,9 +170,9 @@ TEST_F(CategorizerTest, PreservesSubjectAfterMatching)
     EXPECT_EQ(result[0].transaction->category, "Manga");
 }
 
-TEST_F(CategorizerTest, MatchesFirstKeywordFound)
+TEST_F(CategorizerTest, MatchesLongestKeywordFound)
 {
-    // If subject contains multiple keywords, should match the first one found in the map
+    // If subject contains multiple keywords, the longest one (in bytes) wins
     std::vector<sheet::Transaction> transactions = {
         createTransaction("Account1", "Game at STEAMGAMES.COM and 喜久屋書店")};
 
@@ -179,9 +180,8 @@ TEST_F(CategorizerTest, MatchesFirstKeywordFound)
     auto result = marksman::matchSubjectToCategories(transactions, categoryMap);
 
     EXPECT_EQ(result.size(), 1);
-    // Should match one of them (depends on map iteration order)
-    EXPECT_TRUE(result[0].transaction->category == "Games" ||
-                result[0].transaction->category == "Manga");
+    // "喜久屋書店" is 15 bytes of UTF-8, "STEAMGAMES.COM" 14
+    EXPECT_EQ(result[0].transaction->category, "Manga");
 }
 
 TEST_F(CategorizerTest, CaseSensitiveMatching)
@@ -243,3 +243,134 @@ TEST_F(CategorizerTest, PartialKeywordMatch)
     // Should not match because we search for full keyword "関西電力"
     EXPECT_EQ(result.size(), 0);
 }
+
+// ============ Category Matcher Tests ============
+
+TEST_F(CategorizerTest, MatcherPrefersLongestKeyword)
+{
+    marksman::CategoryMatcher matcher({
+        {"AMAZON", "Shopping"},
+        {"AMAZON PRIME", "Subscriptions"},
+        {"PRIME", "Other"},
+    });
+
+    ASSERT_NE(matcher.match("AMAZON PRIME VIDEO"), nullptr);
+    EXPECT_EQ(*matcher.match("AMAZON PRIME VIDEO"), "Subscriptions");
+    EXPECT_EQ(*matcher.match("AMAZON.CO.JP"), "Shopping");
+    EXPECT_EQ(*matcher.match("PRIME NOW"), "Other");
+    EXPECT_EQ(matcher.match("AMAZO"), nullptr);
+}
+
+TEST_F(CategorizerTest, MatcherPrefersLeftmostAmongEquallyLongKeywords)
+{
+    marksman::CategoryMatcher matcher({{"喜久屋書店", "Manga"}, {"関西電力", "Services"},
+                                       {"ABCD", "Letters"}, {"WXYZ", "Other"}});
+
+    // "喜久屋書店" is 15 bytes, "関西電力" 12
+    EXPECT_EQ(*matcher.match("関西電力 喜久屋書店"), "Manga");
+    EXPECT_EQ(*matcher.match("WXYZ then ABCD"), "Other");
+    EXPECT_EQ(*matcher.match("ABCD then WXYZ"), "Letters");
+}
+
+TEST_F(CategorizerTest, MatcherFindsKeywordsThroughFailureLinks)
+{
+    marksman::CategoryMatcher matcher({{"he", "A"}, {"she", "B"}, {"hers", "C"}, {"his", "D"}});
+
+    EXPECT_EQ(*matcher.match("ushers"), "C");
+    EXPECT_EQ(*matcher.match("ushe"), "B");
+    EXPECT_EQ(*matcher.match("ahisx"), "D");
+    EXPECT_EQ(matcher.match("hxs"), nullptr);
+}
+
+TEST_F(CategorizerTest, MatcherAgreesWithNaiveSearch)
+{
+    std::map<std::string, std::string> categoryMap;
+    const std::string alphabet = "abc";
+    std::mt19937 random(42);
+    for (int i = 0; i < 40; ++i)
+    {
+        std::string keyword;
+        for (std::size_t length = 1 + random() % 5; length > 0; --length)
+        {
+            keyword += alphabet[random() % alphabet.size()];
+        }
+        categoryMap[keyword] = "category-" + keyword;
+    }
+    marksman::CategoryMatcher matcher(categoryMap);
+
+    for (int i = 0; i < 500; ++i)
+    {
+        std::string subject;
+        for (std::size_t length = random() % 20; length > 0; --length)
+        {
+            subject += alphabet[random() % alphabet.size()];
+        }
+
+        // Longest keyword wins, then the one occurring first
+        const std::string *expected = nullptr;
+        std::size_t bestLength = 0;
+        std::size_t bestPosition = 0;
+        for (const auto &pair : categoryMap)
+        {
+            std::size_t position = subject.find(pair.first);
+            if (position == std::string::npos)
+            {
+                continue;
+            }
+            if (pair.first.size() > bestLength ||
+                (pair.first.size() == bestLength && position < bestPosition))
+            {
+                expected = &pair.second;
+                bestLength = pair.first.size();
+                bestPosition = position;
+            }
+        }
+
+        const std::string *actual = matcher.match(subject);
+        if (expected == nullptr)
+        {
+            EXPECT_EQ(actual, nullptr) << subject;
+        }
+        else
+        {
+            ASSERT_NE(actual, nullptr) << subject;
+            EXPECT_EQ(*actual, *expected) << subject;
+        }
+    }
+}
+
+TEST_F(CategorizerTest, ParallelMatchingEqualsSequential)
+{
+    std::map<std::string, std::string> categoryMap;
+    for (int i = 0; i < 200; ++i)
+    {
+        categoryMap["shop" + std::to_string(i)] = "Category " + std::to_string(i % 17);
+    }
+    marksman::CategoryMatcher matcher(categoryMap);
+
+    std::mt19937 random(7);
+    sheet::Ledger ledger;
+    for (int i = 0; i < 5000; ++i)
+    {
+        std::string subject = "Paid at shop" + std::to_string(random() % 400);
+        ledger.append(createTransaction("Account1", subject, random() % 5 == 0 ? "Set" : ""));
+    }
+
+    auto sequential = marksman::matchSubjectToCategories(ledger, matcher);
+    ASSERT_FALSE(sequential.empty());
+
+    for (std::size_t threads : {1u, 3u, 8u})
+    {
+        concurrency::ThreadPool pool(threads);
+        for (std::size_t chunkRows : {1u, 64u, 777u, 10000u})
+        {
+            auto parallel = marksman::matchSubjectToCategories(ledger, matcher, pool, chunkRows);
+            ASSERT_EQ(parallel.size(), sequential.size());
+            for (std::size_t i = 0; i < parallel.size(); ++i)
+            {
+                EXPECT_EQ(parallel[i].row, sequential[i].row);
+                EXPECT_EQ(parallel[i].category, sequential[i].category);
+            }
+        }
+    }
+}
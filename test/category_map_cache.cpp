@@ -0,0 +1,179 @@
+#include "marksman/category_map_cache.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "test_utils.hpp"
+
+class CategoryMapCacheTest : public ::testing::Test
+{
+  protected:
+    std::filesystem::path directory;
+    std::string csvPath;
+    std::string cachePath;
+
+    void SetUp() override
+    {
+        directory = testTempPath("category_map_");
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        csvPath = (directory / "category_map.csv").string();
+        cachePath = (directory / "category_map.bin").string();
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    // Writes a new file and renames it into place, the way most editors save
+    void replaceCsv(const std::string &content)
+    {
+        std::string temporary = csvPath + ".new";
+        std::ofstream(temporary) << content;
+        std::filesystem::rename(temporary, csvPath);
+    }
+};
+
+TEST_F(CategoryMapCacheTest, SerializedMatcherMatchesLikeTheOriginal)
+{
+    marksman::CategoryMatcher original(
+        {{"he", "A"}, {"she", "B"}, {"his", "C"}, {"hers", "D"}, {"関西電力", "Services"}});
+    auto copy = marksman::CategoryMatcher::deserialize(original.serialize());
+
+    EXPECT_EQ(copy.keywordCount(), original.keywordCount());
+    for (const char *subject : {"ushers", "ahisx", "hxs", "Payment to 関西電力", ""})
+    {
+        const std::string *expected = original.match(subject);
+        const std::string *actual = copy.match(subject);
+        ASSERT_EQ(expected == nullptr, actual == nullptr) << subject;
+        if (expected != nullptr)
+        {
+            EXPECT_EQ(*actual, *expected) << subject;
+        }
+    }
+}
+
+TEST_F(CategoryMapCacheTest, RejectsCorruptSerializedMatcher)
+{
+    std::string data = marksman::CategoryMatcher({{"abc", "A"}, {"bcd", "B"}}).serialize();
+
+    EXPECT_THROW(marksman::CategoryMatcher::deserialize("garbage"), std::runtime_error);
+    EXPECT_THROW(marksman::CategoryMatcher::deserialize(data.substr(0, data.size() - 1)),
+                 std::runtime_error);
+
+    // Damaged tables are either rejected or still safe to match with
+    for (std::size_t i = 8; i < data.size(); ++i)
+    {
+        std::string corrupt = data;
+        corrupt[i] = '\x7f';
+        try
+        {
+            auto matcher = marksman::CategoryMatcher::deserialize(corrupt);
+            matcher.match("abcdabcd");
+        }
+        catch (const std::runtime_error &)
+        {
+        }
+    }
+}
+
+TEST_F(CategoryMapCacheTest, SecondStartUsesPrecompiledMap)
+{
+    replaceCsv("Coffee,Food\nTrain,Transport\n");
+
+    {
+        marksman::CategoryMapCache cache(csvPath, cachePath);
+        EXPECT_TRUE(cache.reload());
+        EXPECT_EQ(cache.lastSource(), marksman::CategoryMapCache::Source::CSV);
+        EXPECT_FALSE(cache.reload());
+    }
+    ASSERT_TRUE(std::filesystem::exists(cachePath));
+
+    marksman::CategoryMapCache cache(csvPath, cachePath);
+    EXPECT_TRUE(cache.reload());
+    EXPECT_EQ(cache.lastSource(), marksman::CategoryMapCache::Source::PRECOMPILED);
+    EXPECT_EQ(*cache.matcher()->match("Morning Coffee"), "Food");
+}
+
+TEST_F(CategoryMapCacheTest, TouchedButUnchangedCsvReusesPrecompiledMap)
+{
+    replaceCsv("Coffee,Food\n");
+    marksman::CategoryMapCache(csvPath, cachePath).reload();
+
+    std::filesystem::last_write_time(csvPath, std::filesystem::last_write_time(csvPath) +
+                                                  std::chrono::seconds(5));
+
+    marksman::CategoryMapCache cache(csvPath, cachePath);
+    EXPECT_TRUE(cache.reload());
+    EXPECT_EQ(cache.lastSource(), marksman::CategoryMapCache::Source::PRECOMPILED);
+}
+
+TEST_F(CategoryMapCacheTest, ReloadSwapsMatcherWithoutInvalidatingOldOne)
+{
+    replaceCsv("Coffee,Food\n");
+    marksman::CategoryMapCache cache(csvPath, "");
+    cache.reload();
+    auto before = cache.matcher();
+
+    replaceCsv("Coffee,Drinks\nTrain,Transport\n");
+    EXPECT_TRUE(cache.reload());
+    EXPECT_EQ(cache.lastSource(), marksman::CategoryMapCache::Source::CSV);
+
+    EXPECT_EQ(*before->match("Coffee"), "Food");
+    EXPECT_EQ(*cache.matcher()->match("Coffee"), "Drinks");
+    EXPECT_EQ(*cache.matcher()->match("Train"), "Transport");
+}
+
+TEST_F(CategoryMapCacheTest, KeepsPreviousMatcherWhenCsvDisappears)
+{
+    replaceCsv("Coffee,Food\n");
+    marksman::CategoryMapCache cache(csvPath, "");
+    cache.reload();
+
+    std::filesystem::remove(csvPath);
+    EXPECT_THROW(cache.reload(), std::runtime_error);
+    EXPECT_EQ(*cache.matcher()->match("Coffee"), "Food");
+}
+
+TEST_F(CategoryMapCacheTest, WatchReloadsWhenCsvIsReplaced)
+{
+    replaceCsv("Coffee,Food\n");
+    marksman::CategoryMapCache cache(csvPath, cachePath);
+    cache.reload();
+    cache.watch();
+
+    replaceCsv("Coffee,Drinks\n");
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (*cache.matcher()->match("Coffee") != "Drinks" &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(*cache.matcher()->match("Coffee"), "Drinks");
+}
+
+TEST_F(CategoryMapCacheTest, FailedWatchLeavesNoDescriptorsBehind)
+{
+    std::filesystem::path missing = directory / "missing";
+    marksman::CategoryMapCache cache((missing / "category_map.csv").string(), cachePath);
+
+    auto openFds = []()
+    {
+        auto entries = std::filesystem::directory_iterator("/proc/self/fd");
+        return std::distance(entries, std::filesystem::directory_iterator());
+    };
+    auto before = openFds();
+    for (int i = 0; i < 3; ++i)
+    {
+        EXPECT_THROW(cache.watch(), std::runtime_error);
+    }
+    EXPECT_EQ(openFds(), before);
+
+    // A retry once the directory exists works
+    std::filesystem::create_directories(missing);
+    EXPECT_NO_THROW(cache.watch());
+}
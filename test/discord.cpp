@@ -0,0 +1,147 @@
+#include "reporter/discord.hpp"
+
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+
+#include "test_utils.hpp"
+
+// The URL and message text of every post
+static std::vector<std::pair<std::string, std::string>>
+postedMessages(ScriptedRequester &requester)
+{
+    std::vector<std::pair<std::string, std::string>> posts;
+    for (const network::Request &request : requester.sent())
+    {
+        posts.emplace_back(request.url,
+                           nlohmann::json::parse(request.body)["content"].get<std::string>());
+    }
+    return posts;
+}
+
+static std::size_t codepoints(const std::string &text)
+{
+    std::size_t count = 0;
+    for (char c : text)
+    {
+        count += (static_cast<unsigned char>(c) & 0xC0) == 0x80 ? 0u : 1u;
+    }
+    return count;
+}
+
+TEST(DiscordTest, SplitsOnLineBoundaries)
+{
+    EXPECT_EQ(reporter::splitMessage("a\nbb\nccc", 5),
+              (std::vector<std::string>{"a\nbb", "ccc"}));
+    EXPECT_EQ(reporter::splitMessage("short", 2000), (std::vector<std::string>{"short"}));
+    EXPECT_TRUE(reporter::splitMessage("\n\n", 2000).empty());
+
+    std::string report;
+    for (int i = 0; i < 300; ++i)
+    {
+        report += "Food: " + std::to_string(i * 1000) + " IDR\n";
+    }
+    auto messages = reporter::splitMessage(report);
+    ASSERT_GT(messages.size(), 1u);
+    std::string joined;
+    for (const auto &message : messages)
+    {
+        EXPECT_LE(message.size(), reporter::MESSAGE_LIMIT);
+        EXPECT_NE(message.back(), '\n');
+        joined += message + "\n";
+    }
+    EXPECT_EQ(joined, report);
+}
+
+TEST(DiscordTest, CutsLongLinesBetweenCodepoints)
+{
+    // 7 two-byte characters, then a short line
+    std::string line;
+    for (int i = 0; i < 7; ++i)
+    {
+        line += "\xC3\xA9";
+    }
+    auto messages = reporter::splitMessage(line + "\no", 3);
+
+    ASSERT_EQ(messages.size(), 3u);
+    EXPECT_EQ(codepoints(messages[0]), 3u);
+    EXPECT_EQ(codepoints(messages[1]), 3u);
+    EXPECT_EQ(messages[2], "\xC3\xA9\no");
+    EXPECT_EQ(messages[0] + messages[1] + messages[2], line + "\no");
+}
+
+TEST(DiscordTest, PostsEveryPieceInOrder)
+{
+    auto requester = std::make_shared<ScriptedRequester>();
+    reporter::Discord discord(requester, "token", "http://mock/api");
+
+    std::string report(1500, 'a');
+    report += "\n" + std::string(1500, 'b');
+    discord.sendMessage("42", report);
+
+    auto posted = postedMessages(*requester);
+    ASSERT_EQ(posted.size(), 2u);
+    EXPECT_EQ(posted[0].first, "http://mock/api/channels/42/messages");
+    EXPECT_EQ(posted[0].second, std::string(1500, 'a'));
+    EXPECT_EQ(posted[1].second, std::string(1500, 'b'));
+}
+
+TEST(DiscordTest, RetriesAfterARateLimit)
+{
+    auto requester = std::make_shared<ScriptedRequester>();
+    requester->queue({429,
+                      R"({"message": "You are being rate limited.", "retry_after": 0.05,
+                          "global": false})",
+                      {{"retry-after", "1"}}});
+    // A malformed flag is ignored rather than failing the retry
+    requester->queue({429, R"({"retry_after": 0.01, "global": "yes"})", {}});
+    reporter::Discord discord(requester, "token", "http://mock/api/");
+
+    auto start = std::chrono::steady_clock::now();
+    discord.sendMessage("42", "hello");
+
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(60));
+    auto posted = postedMessages(*requester);
+    ASSERT_EQ(posted.size(), 3u);
+    EXPECT_EQ(posted[2].second, "hello");
+}
+
+TEST(DiscordTest, GivesUpOnErrorsAndPersistentLimits)
+{
+    auto requester = std::make_shared<ScriptedRequester>();
+    requester->queue({403, R"({"message": "Missing Access"})", {}});
+    reporter::Discord discord(requester, "token", "http://mock/api/");
+    EXPECT_THROW(discord.sendMessage("42", "hello"), std::runtime_error);
+    EXPECT_EQ(postedMessages(*requester).size(), 1u);
+
+    auto limited = std::make_shared<ScriptedRequester>();
+    for (int i = 0; i < 5; ++i)
+    {
+        limited->queue({429, "", {{"x-ratelimit-reset-after", "0.001"}}});
+    }
+    reporter::Discord limitedDiscord(limited, "token", "http://mock/api/");
+    EXPECT_THROW(limitedDiscord.sendMessage("42", "hello"), std::runtime_error);
+    EXPECT_EQ(postedMessages(*limited).size(), 5u);
+}
+
+TEST(DiscordTest, DeliversToEveryChannel)
+{
+    auto requester = std::make_shared<ScriptedRequester>();
+    requester->queue({404, R"({"message": "Unknown Channel"})", {}});
+    reporter::Discord discord(requester, "token", "http://mock/api/");
+
+    // The first request fails, whichever channel sent it; the others still get through
+    EXPECT_THROW(discord.sendMessage(std::vector<std::string>{"1", "2", "3"}, "report"),
+                 std::runtime_error);
+
+    auto posted = postedMessages(*requester);
+    ASSERT_EQ(posted.size(), 3u);
+    std::vector<std::string> urls;
+    for (const auto &post : posted)
+    {
+        urls.push_back(post.first);
+    }
+    std::sort(urls.begin(), urls.end());
+    EXPECT_EQ(urls, (std::vector<std::string>{"http://mock/api/channels/1/messages",
+                                              "http://mock/api/channels/2/messages",
+                                              "http://mock/api/channels/3/messages"}));
+}
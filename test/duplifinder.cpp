@@ -162,3 +162,47 @@ TEST(Marksman, EdgeCase_AlmostThreeDaysApart)
 
     EXPECT_EQ(duplicates.size(), 0);
 }
+
+TEST(Marksman, FindsEveryDuplicateOfATriple)
+{
+    std::vector<sheet::Transaction> transactions = {
+        {"Bank A", "Charge 1", makeTimePoint(2025, 1, 1, 10, 5, 0), 5000, "IDR", ""},
+        {"Bank A", "Charge 2", makeTimePoint(2025, 1, 1, 11, 30, 0), 5000, "IDR", ""},
+        {"Bank A", "Charge 3", makeTimePoint(2025, 1, 2, 9, 15, 0), 5000, "IDR", ""},
+    };
+
+    auto duplicates = marksman::findPossibleDuplicates(transactions);
+
+    ASSERT_EQ(duplicates.size(), 2);
+    EXPECT_EQ(duplicates[0].row, 3);
+    EXPECT_EQ(duplicates[0].transaction->subject, "?dupof(2) Charge 2");
+    EXPECT_EQ(duplicates[1].row, 4);
+    EXPECT_EQ(duplicates[1].transaction->subject, "?dupof(2) Charge 3");
+}
+
+TEST(Marksman, PairsAcrossInterleavedAccounts)
+{
+    std::vector<sheet::Transaction> transactions = {
+        // Bank B sits between the Bank A pair once sorted by date
+        {"Bank A", "Trx A1", makeTimePoint(2025, 1, 1, 10, 0, 0), 7000, "IDR", ""},
+        {"Bank B", "Trx B1", makeTimePoint(2025, 1, 1, 12, 0, 0), 7000, "IDR", ""},
+        {"Bank A ", "Trx A2", makeTimePoint(2025, 1, 1, 14, 0, 0), 7000, "IDR", ""},
+    };
+
+    auto duplicates = marksman::findPossibleDuplicates(transactions);
+
+    ASSERT_EQ(duplicates.size(), 1);
+    EXPECT_EQ(duplicates[0].row, 4);
+    EXPECT_EQ(duplicates[0].transaction->subject, "?dupof(2) Trx A2");
+}
+
+TEST(Marksman, UsesConfiguredWindow)
+{
+    std::vector<sheet::Transaction> transactions = {
+        {"Bank A", "Transaction 1", makeTimePoint(2025, 1, 1, 10, 0, 0), 100000, "IDR", ""},
+        {"Bank A", "Transaction 2", makeTimePoint(2025, 1, 1, 16, 0, 0), 100000, "IDR", ""},
+    };
+
+    EXPECT_EQ(marksman::findPossibleDuplicates(transactions, std::chrono::hours(6)).size(), 1);
+    EXPECT_EQ(marksman::findPossibleDuplicates(transactions, std::chrono::hours(5)).size(), 0);
+}
@@ -0,0 +1,179 @@
+#include "lib/network/http_parser.hpp"
+
+#include <gtest/gtest.h>
+#include <string>
+
+using Status = network::HttpRequestParser::Status;
+
+TEST(HttpParser, ParsesSimpleGet)
+{
+    network::HttpRequestParser parser;
+    std::string request = "GET /assets/app.js?v=3 HTTP/1.1\r\nHost: localhost\r\n"
+                          "Accept-Encoding: gzip, br\r\n\r\n";
+    parser.feed(request.data(), request.size());
+
+    ASSERT_EQ(parser.parse(), Status::COMPLETE);
+    EXPECT_EQ(parser.method(), "GET");
+    EXPECT_EQ(parser.target(), "/assets/app.js?v=3");
+    EXPECT_EQ(parser.path(), "/assets/app.js");
+    EXPECT_EQ(parser.version(), "HTTP/1.1");
+    EXPECT_EQ(parser.header("accept-encoding"), "gzip, br");
+    EXPECT_EQ(parser.header("HOST"), "localhost");
+    EXPECT_EQ(parser.header("missing"), "");
+    EXPECT_TRUE(parser.body().empty());
+    EXPECT_TRUE(parser.keepAlive());
+}
+
+TEST(HttpParser, WaitsForFullContentLengthBody)
+{
+    network::HttpRequestParser parser;
+    std::string request = "POST / HTTP/1.1\r\nContent-Length: 11\r\n\r\nhello world";
+
+    // One byte at a time, as if every TCP segment carried a single byte
+    for (std::size_t i = 0; i + 1 < request.size(); ++i)
+    {
+        parser.feed(&request[i], 1);
+        EXPECT_EQ(parser.parse(), Status::INCOMPLETE);
+    }
+    parser.feed(&request.back(), 1);
+
+    ASSERT_EQ(parser.parse(), Status::COMPLETE);
+    EXPECT_EQ(parser.body(), "hello world");
+}
+
+TEST(HttpParser, KeepsBodiesLargerThanOneRead)
+{
+    network::HttpRequestParser parser;
+    std::string body(100000, 'x');
+    body[5000] = '\0';
+    std::string request =
+        "POST / HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    parser.feed(request.data(), request.size());
+
+    ASSERT_EQ(parser.parse(), Status::COMPLETE);
+    EXPECT_EQ(parser.body().size(), body.size());
+    EXPECT_EQ(parser.body(), body);
+}
+
+TEST(HttpParser, DecodesChunkedBody)
+{
+    network::HttpRequestParser parser;
+    std::string request = "POST /submit HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                          "5;ext=1\r\nhello\r\n"
+                          "6\r\n world\r\n"
+                          "0\r\nX-Trailer: yes\r\n\r\n";
+
+    std::size_t split = request.size() / 2;
+    parser.feed(request.data(), split);
+    EXPECT_EQ(parser.parse(), Status::INCOMPLETE);
+    parser.feed(request.data() + split, request.size() - split);
+
+    ASSERT_EQ(parser.parse(), Status::COMPLETE);
+    EXPECT_EQ(parser.path(), "/submit");
+    EXPECT_EQ(parser.body(), "hello world");
+}
+
+TEST(HttpParser, HandlesPipelinedRequests)
+{
+    network::HttpRequestParser parser;
+    std::string requests = "POST /a HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc"
+                           "GET /b HTTP/1.1\r\n\r\n"
+                           "GET /c HTTP/1.1\r\nConnection: close\r\n\r\n";
+    parser.feed(requests.data(), requests.size());
+
+    ASSERT_EQ(parser.parse(), Status::COMPLETE);
+    EXPECT_EQ(parser.path(), "/a");
+    EXPECT_EQ(parser.body(), "abc");
+    parser.consume();
+
+    ASSERT_EQ(parser.parse(), Status::COMPLETE);
+    EXPECT_EQ(parser.path(), "/b");
+    EXPECT_TRUE(parser.keepAlive());
+    parser.consume();
+
+    ASSERT_EQ(parser.parse(), Status::COMPLETE);
+    EXPECT_EQ(parser.path(), "/c");
+    EXPECT_FALSE(parser.keepAlive());
+    parser.consume();
+
+    EXPECT_FALSE(parser.hasBufferedData());
+}
+
+TEST(HttpParser, Http10ClosesUnlessKeepAliveRequested)
+{
+    network::HttpRequestParser parser;
+    std::string requests = "GET / HTTP/1.0\r\n\r\n"
+                           "GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n";
+    parser.feed(requests.data(), requests.size());
+
+    ASSERT_EQ(parser.parse(), Status::COMPLETE);
+    EXPECT_FALSE(parser.keepAlive());
+    parser.consume();
+
+    ASSERT_EQ(parser.parse(), Status::COMPLETE);
+    EXPECT_TRUE(parser.keepAlive());
+}
+
+TEST(HttpParser, RejectsOversizedBody)
+{
+    network::HttpRequestParser parser(16);
+    std::string request = "POST / HTTP/1.1\r\nContent-Length: 17\r\n\r\n";
+    parser.feed(request.data(), request.size());
+
+    EXPECT_EQ(parser.parse(), Status::ERROR);
+    EXPECT_EQ(parser.errorStatus(), 413);
+}
+
+TEST(HttpParser, RejectsOversizedChunkedBody)
+{
+    network::HttpRequestParser parser(8);
+    std::string request = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                          "5\r\nhello\r\n5\r\nworld\r\n0\r\n\r\n";
+    parser.feed(request.data(), request.size());
+
+    EXPECT_EQ(parser.parse(), Status::ERROR);
+    EXPECT_EQ(parser.errorStatus(), 413);
+}
+
+TEST(HttpParser, RejectsOversizedHeaders)
+{
+    network::HttpRequestParser parser(1024, 64);
+    std::string request = "GET / HTTP/1.1\r\nX-Long: " + std::string(100, 'a');
+    parser.feed(request.data(), request.size());
+
+    EXPECT_EQ(parser.parse(), Status::ERROR);
+    EXPECT_EQ(parser.errorStatus(), 431);
+}
+
+TEST(HttpParser, RejectsMalformedRequests)
+{
+    const std::string malformed[] = {
+        "GARBAGE\r\n\r\n",
+        "GET / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n",
+        "GET / HTTP/1.1\r\nno colon here\r\n\r\n",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+    };
+
+    for (const auto &request : malformed)
+    {
+        network::HttpRequestParser parser;
+        parser.feed(request.data(), request.size());
+        EXPECT_EQ(parser.parse(), Status::ERROR) << request;
+        EXPECT_EQ(parser.errorStatus(), 400) << request;
+    }
+}
+
+TEST(HttpParser, SignalsExpectContinueOnce)
+{
+    network::HttpRequestParser parser;
+    std::string headers = "POST / HTTP/1.1\r\nContent-Length: 4\r\nExpect: 100-continue\r\n\r\n";
+    parser.feed(headers.data(), headers.size());
+
+    EXPECT_EQ(parser.parse(), Status::INCOMPLETE);
+    EXPECT_TRUE(parser.takeContinueRequest());
+    EXPECT_FALSE(parser.takeContinueRequest());
+
+    parser.feed("data", 4);
+    ASSERT_EQ(parser.parse(), Status::COMPLETE);
+    EXPECT_EQ(parser.body(), "data");
+}
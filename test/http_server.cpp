@@ -0,0 +1,360 @@
+#include "lib/network/http_server.hpp"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+// A blocking client socket; reads give up after a few seconds so a broken server fails the
+// test instead of hanging it
+class TestClient
+{
+  public:
+    explicit TestClient(int port) : m_fd(socket(AF_INET, SOCK_STREAM, 0))
+    {
+        timeval timeout{5, 0};
+        setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(m_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+        {
+            throw std::runtime_error("cannot connect to the test server");
+        }
+    }
+
+    ~TestClient()
+    {
+        close(m_fd);
+    }
+
+    int fd() const
+    {
+        return m_fd;
+    }
+
+    void send(const std::string &data)
+    {
+        std::size_t offset = 0;
+        while (offset < data.size())
+        {
+            ssize_t sent =
+                ::send(m_fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+            ASSERT_GT(sent, 0);
+            offset += static_cast<std::size_t>(sent);
+        }
+    }
+
+    // The next whole response, head and body; empty when the server closed or went quiet
+    std::string response()
+    {
+        std::size_t headEnd;
+        while ((headEnd = m_pending.find("\r\n\r\n")) == std::string::npos)
+        {
+            if (!receive())
+            {
+                return "";
+            }
+        }
+
+        std::size_t length = 0;
+        std::size_t header = m_pending.find("Content-Length: ");
+        if (header != std::string::npos && header < headEnd)
+        {
+            length = std::stoul(m_pending.substr(header + 16));
+        }
+        std::size_t total = headEnd + 4 + length;
+        while (m_pending.size() < total)
+        {
+            if (!receive())
+            {
+                return "";
+            }
+        }
+
+        std::string response = m_pending.substr(0, total);
+        m_pending.erase(0, total);
+        return response;
+    }
+
+    // True when the server closed the connection without sending anything more
+    bool closedByServer()
+    {
+        return m_pending.empty() && !receive() && m_lastReceive == 0;
+    }
+
+  private:
+    int m_fd;
+    std::string m_pending;
+    ssize_t m_lastReceive = -1;
+
+    bool receive()
+    {
+        char buffer[4096];
+        m_lastReceive = recv(m_fd, buffer, sizeof(buffer), 0);
+        if (m_lastReceive <= 0)
+        {
+            return false;
+        }
+        m_pending.append(buffer, static_cast<std::size_t>(m_lastReceive));
+        return true;
+    }
+};
+
+static std::string bodyOf(const std::string &response)
+{
+    std::size_t headEnd = response.find("\r\n\r\n");
+    return headEnd == std::string::npos ? "" : response.substr(headEnd + 4);
+}
+
+static std::string get(const std::string &path, const std::string &extraHeaders = "")
+{
+    return "GET " + path + " HTTP/1.1\r\nHost: test\r\n" + extraHeaders + "\r\n";
+}
+
+class HttpServerTest : public ::testing::Test
+{
+  protected:
+    network::HttpServer server;
+    std::thread loop;
+
+    void SetUp() override
+    {
+        server.setPort(0);
+        // Echoes the request back, so tests can tell responses apart
+        server.setRequestHandler(
+            [](const std::string &path, const std::string &method, const std::string &body)
+            {
+                return network::HttpResponse{
+                    200, method + " " + path + (body.empty() ? "" : " " + body), "text/plain", {}};
+            });
+    }
+
+    void TearDown() override
+    {
+        server.stop();
+        if (loop.joinable())
+        {
+            loop.join();
+        }
+    }
+
+    void startServer()
+    {
+        server.start();
+        loop = std::thread([this]() { server.run(); });
+    }
+};
+
+TEST_F(HttpServerTest, KeepsConnectionsAliveAcrossRequests)
+{
+    startServer();
+    TestClient client(server.port());
+
+    client.send(get("/first"));
+    std::string first = client.response();
+    EXPECT_NE(first.find("HTTP/1.1 200 OK"), std::string::npos);
+    EXPECT_NE(first.find("Connection: keep-alive"), std::string::npos);
+    EXPECT_EQ(bodyOf(first), "GET /first");
+
+    client.send(get("/second"));
+    EXPECT_EQ(bodyOf(client.response()), "GET /second");
+}
+
+TEST_F(HttpServerTest, StopsBeforeTheLoopRuns)
+{
+    server.start();
+    server.stop();
+    server.run();
+    EXPECT_FALSE(server.isRunning());
+
+    // stop() racing a loop thread that may not have been scheduled yet
+    for (int i = 0; i < 50; ++i)
+    {
+        startServer();
+        server.stop();
+        loop.join();
+    }
+
+    startServer();
+    TestClient client(server.port());
+    client.send(get("/after"));
+    EXPECT_EQ(bodyOf(client.response()), "GET /after");
+}
+
+TEST_F(HttpServerTest, AnswersPipelinedRequestsInOrder)
+{
+    startServer();
+    TestClient client(server.port());
+
+    client.send(get("/a") + "POST /b HTTP/1.1\r\nHost: test\r\nContent-Length: 5\r\n\r\nhello" +
+                get("/c"));
+
+    EXPECT_EQ(bodyOf(client.response()), "GET /a");
+    EXPECT_EQ(bodyOf(client.response()), "POST /b hello");
+    EXPECT_EQ(bodyOf(client.response()), "GET /c");
+}
+
+TEST_F(HttpServerTest, ClosesAfterConnectionClose)
+{
+    startServer();
+    TestClient client(server.port());
+
+    client.send(get("/last", "Connection: close\r\n") + get("/ignored"));
+    std::string response = client.response();
+    EXPECT_EQ(bodyOf(response), "GET /last");
+    EXPECT_NE(response.find("Connection: close"), std::string::npos);
+    EXPECT_TRUE(client.closedByServer());
+}
+
+TEST_F(HttpServerTest, AnswersRequestsSentBeforeAHalfClose)
+{
+    startServer();
+    TestClient client(server.port());
+
+    // As curl and nc -N do once the request is out
+    client.send(get("/a") + get("/b"));
+    shutdown(client.fd(), SHUT_WR);
+
+    EXPECT_EQ(bodyOf(client.response()), "GET /a");
+    EXPECT_EQ(bodyOf(client.response()), "GET /b");
+    EXPECT_TRUE(client.closedByServer());
+}
+
+TEST_F(HttpServerTest, ClosesIdleAndStalledConnections)
+{
+    server.setTimeouts(std::chrono::milliseconds(100), std::chrono::seconds(1));
+    startServer();
+
+    TestClient idle(server.port());
+    idle.send(get("/a"));
+    EXPECT_EQ(bodyOf(idle.response()), "GET /a");
+
+    // Headers that never finish
+    TestClient stalled(server.port());
+    stalled.send("GET /slow HTTP/1.1\r\nHost: te");
+
+    EXPECT_TRUE(idle.closedByServer());
+    EXPECT_TRUE(stalled.closedByServer());
+}
+
+TEST_F(HttpServerTest, StopsReadingWhileAWorkerHasTheRequest)
+{
+    std::atomic<bool> release(false);
+    server.setRequestHandler(
+        [&release](const std::string &path, const std::string &, const std::string &)
+        {
+            while (!release)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            return network::HttpResponse{200, path, "text/plain", {}};
+        });
+    server.setWorkerPool(1, 4);
+    startServer();
+    TestClient client(server.port());
+    client.send(get("/slow"));
+
+    // Pipelined headers that never end. Until the handler returns, only the socket buffers
+    // take them in; the server itself must not
+    int flags = fcntl(client.fd(), F_GETFL, 0);
+    fcntl(client.fd(), F_SETFL, flags | O_NONBLOCK);
+    std::string flood = "GET /next HTTP/1.1\r\nX-Flood: " + std::string(64 << 20, 'a');
+    std::size_t accepted = 0;
+    for (int idleRounds = 0; idleRounds < 10 && accepted < flood.size();)
+    {
+        ssize_t sent = ::send(client.fd(), flood.data() + accepted, flood.size() - accepted,
+                              MSG_NOSIGNAL);
+        if (sent > 0)
+        {
+            accepted += static_cast<std::size_t>(sent);
+            idleRounds = 0;
+            continue;
+        }
+        ASSERT_TRUE(errno == EAGAIN || errno == EWOULDBLOCK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ++idleRounds;
+    }
+    EXPECT_LT(accepted, flood.size() / 2);
+    fcntl(client.fd(), F_SETFL, flags);
+
+    // Once the worker is done, the flood runs into the header limit
+    release = true;
+    EXPECT_EQ(bodyOf(client.response()), "/slow");
+    EXPECT_EQ(client.response().rfind("HTTP/1.1 431", 0), 0u);
+}
+
+TEST_F(HttpServerTest, RejectsRequestsWhenTheWorkerQueueIsFull)
+{
+    std::atomic<int> entered(0);
+    std::atomic<bool> release(false);
+    server.setRequestHandler(
+        [&entered, &release](const std::string &path, const std::string &, const std::string &)
+        {
+            ++entered;
+            while (!release)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            return network::HttpResponse{200, path, "text/plain", {}};
+        });
+    server.setWorkerPool(1, 1);
+    startServer();
+
+    // One request on the only worker, one waiting in the queue, and no room for a third
+    TestClient running(server.port());
+    running.send(get("/running"));
+    while (entered == 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    TestClient queued(server.port());
+    queued.send(get("/queued"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    TestClient rejected(server.port());
+    rejected.send(get("/rejected"));
+    EXPECT_EQ(rejected.response().rfind("HTTP/1.1 503", 0), 0u);
+
+    release = true;
+    EXPECT_EQ(bodyOf(running.response()), "/running");
+    EXPECT_EQ(bodyOf(queued.response()), "/queued");
+}
+
+TEST_F(HttpServerTest, KeepsOffloadedResponsesInRequestOrder)
+{
+    // The first request takes longest; fast ones must still wait their turn
+    server.setRequestHandler(
+        [](const std::string &path, const std::string &, const std::string &)
+        {
+            if (path == "/slow")
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            else if (path == "/medium")
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(30));
+            }
+            return network::HttpResponse{200, path, "text/plain", {}};
+        });
+    server.setWorkerPool(4, 16);
+    server.setOffloadFilter([](const std::string &, const std::string &path)
+                            { return path != "/inline"; });
+    startServer();
+    TestClient client(server.port());
+
+    client.send(get("/slow") + get("/inline") + get("/medium") + get("/fast"));
+
+    EXPECT_EQ(bodyOf(client.response()), "/slow");
+    EXPECT_EQ(bodyOf(client.response()), "/inline");
+    EXPECT_EQ(bodyOf(client.response()), "/medium");
+    EXPECT_EQ(bodyOf(client.response()), "/fast");
+}
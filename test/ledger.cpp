@@ -0,0 +1,87 @@
+#include "lib/sheet/ledger.hpp"
+
+#include <gtest/gtest.h>
+
+#include "marksman/categorizer.hpp"
+#include "marksman/duplifinder.hpp"
+#include "test_utils.hpp"
+
+static sheet::Ledger sampleLedger()
+{
+    return sheet::Ledger::fromTransactions({
+        {"Bank A", "Coffee", makeTimePoint(2025, 1, 1, 9, 30, 0), 35000, "IDR", ""},
+        {"Bank A ", "Coffee", makeTimePoint(2025, 1, 1, 11, 45, 0), 35000, "IDR", ""},
+        {"Wallet", "Train to Kyoto", makeTimePoint(2025, 1, 2, 8, 5, 0), 570, "JPY", "Travel"},
+    });
+}
+
+TEST(Ledger, StoresColumnsAndInternsStrings)
+{
+    sheet::Ledger ledger = sampleLedger();
+
+    ASSERT_EQ(ledger.size(), 3);
+    EXPECT_EQ(ledger.subject(2), "Train to Kyoto");
+    EXPECT_EQ(ledger.amount(2), 570);
+    EXPECT_EQ(ledger.currency(2), "JPY");
+    EXPECT_EQ(ledger.category(2), "Travel");
+    EXPECT_EQ(ledger.date(0), std::chrono::duration_cast<std::chrono::seconds>(
+                                  makeTimePoint(2025, 1, 1, 9, 30, 0).time_since_epoch())
+                                  .count());
+
+    // Same currency and category share an id; trailing whitespace keeps accounts apart here
+    EXPECT_EQ(ledger.currencyId(0), ledger.currencyId(1));
+    EXPECT_EQ(ledger.categoryId(0), ledger.categoryId(1));
+    EXPECT_NE(ledger.accountId(0), ledger.accountId(1));
+    EXPECT_EQ(ledger.currencies().size(), 2);
+    EXPECT_EQ(ledger.currencies().find("USD"), sheet::StringPool::NONE);
+}
+
+TEST(Ledger, ViewsSurviveGrowthAndMoves)
+{
+    sheet::Ledger ledger;
+    for (int i = 0; i < 1000; ++i)
+    {
+        ledger.append({"Account " + std::to_string(i % 50), "Subject " + std::to_string(i),
+                       makeTimePoint(2025, 1, 1), i, "IDR", ""});
+    }
+
+    sheet::Ledger moved = std::move(ledger);
+    EXPECT_EQ(moved.account(999), "Account 49");
+    EXPECT_EQ(moved.subject(123), "Subject 123");
+    EXPECT_EQ(moved.accounts().find("Account 7"), moved.accountId(7));
+
+    sheet::Transaction copy = moved.transaction(42);
+    EXPECT_EQ(copy.subject, "Subject 42");
+    EXPECT_EQ(copy.amount, 42);
+    EXPECT_EQ(copy.date, makeTimePoint(2025, 1, 1));
+}
+
+TEST(Ledger, DuplicateEditsReferToRowsByIndex)
+{
+    sheet::Ledger ledger = sampleLedger();
+
+    auto edits = marksman::findPossibleDuplicates(ledger);
+
+    ASSERT_EQ(edits.size(), 1);
+    EXPECT_EQ(edits[0].kind, sheet::RowEdit::Kind::MARK_DUPLICATE);
+    EXPECT_EQ(edits[0].row, 1);
+    EXPECT_EQ(edits[0].original, 0);
+    EXPECT_EQ(sheet::duplicateSubject(static_cast<int>(edits[0].original) + 2,
+                                      ledger.subject(edits[0].row)),
+              "?dupof(2) Coffee");
+}
+
+TEST(Ledger, CategoryEditsPointIntoTheMatcher)
+{
+    sheet::Ledger ledger = sampleLedger();
+    marksman::CategoryMatcher matcher({{"Coffee", "Food"}, {"Kyoto", "Holiday"}});
+
+    auto edits = marksman::matchSubjectToCategories(ledger, matcher);
+
+    // Row 2 already has a category
+    ASSERT_EQ(edits.size(), 2);
+    EXPECT_EQ(edits[0].kind, sheet::RowEdit::Kind::SET_CATEGORY);
+    EXPECT_EQ(edits[0].row, 0);
+    EXPECT_EQ(edits[0].category, "Food");
+    EXPECT_EQ(edits[1].row, 1);
+}
@@ -0,0 +1,202 @@
+#include <future>
+#include <gtest/gtest.h>
+#include <memory>
+
+#include "lib/auth/static_provider.hpp"
+#include "lib/sheet/client.hpp"
+#include "lib/sheet/ledger.hpp"
+#include "mock_sheets/service.hpp"
+#include "test_utils.hpp"
+
+using json = nlohmann::json;
+
+static const std::string DRIVE_BASE = "http://mock/drive/v3/files/";
+
+// Hands requests straight to the service, as the HTTP server would
+static std::shared_ptr<ScriptedRequester> inProcessRequester(mock_sheets::Service &service)
+{
+    return std::make_shared<ScriptedRequester>(
+        [&service](const network::Request &request)
+        {
+            std::string path = request.url.substr(std::string("http://mock").size());
+            path = path.substr(0, path.find('?'));
+            network::HttpResponse served = service.handle(path, request.method, request.body);
+            return network::Response{served.code, served.content, {}};
+        });
+}
+
+static json getJson(mock_sheets::Service &service, const std::string &path)
+{
+    network::HttpResponse response = service.handle(path, "GET", "");
+    EXPECT_EQ(response.code, 200) << response.content;
+    return json::parse(response.content);
+}
+
+TEST(MockSheetsTest, ReadsRangesLikeSheets)
+{
+    mock_sheets::Service service;
+    service.setValues("s", "Transactions",
+                      {{"Account", "Subject", "Date", "Amount", "Currency", "Category"},
+                       {"Cash", "Lunch", 45292.5, -20000, "IDR", nullptr},
+                       {"BCA", nullptr, 45293, -5, "USD", "Food"}});
+
+    json response = getJson(service, "/v4/spreadsheets/s/values/Transactions!A2:F");
+    EXPECT_EQ(response["values"], json::parse(R"([["Cash", "Lunch", 45292.5, -20000, "IDR"],
+                                                   ["BCA", "", 45293, -5, "USD", "Food"]])"));
+
+    response = getJson(service, "/v4/spreadsheets/s/values/Transactions!B3:C3");
+    EXPECT_EQ(response["values"], json::parse(R"([["",45293]])"));
+
+    // Past the end there are no values at all
+    response = getJson(service, "/v4/spreadsheets/s/values/Transactions!A10:F");
+    EXPECT_FALSE(response.contains("values"));
+}
+
+TEST(MockSheetsTest, WritesAreInterpretedAsUserEntered)
+{
+    mock_sheets::Service service;
+    json request = {{"valueInputOption", "USER_ENTERED"},
+                    {"data",
+                     {{{"range", "Transactions!A2:D2"},
+                       {"values", {{"Cash", "?dupof(3) Lunch", "2024-01-01 12:00:00", "0"}}}},
+                      {{"range", "Transactions!F2:F2"}, {"values", {{"Food"}}}}}}};
+    std::uint64_t version = service.version("s");
+
+    network::HttpResponse response =
+        service.handle("/v4/spreadsheets/s/values:batchUpdate", "POST", request.dump());
+    ASSERT_EQ(response.code, 200) << response.content;
+    EXPECT_EQ(json::parse(response.content)["totalUpdatedCells"], 5);
+    EXPECT_EQ(service.version("s"), version + 1);
+
+    auto rows = service.values("s", "Transactions");
+    ASSERT_EQ(rows.size(), 2u);
+    EXPECT_EQ(rows[1][0], "Cash");
+    EXPECT_EQ(rows[1][1], "?dupof(3) Lunch");
+    EXPECT_EQ(rows[1][2], 45292.5);
+    EXPECT_TRUE(rows[1][3].is_number_integer());
+    EXPECT_EQ(rows[1][3], 0);
+    EXPECT_TRUE(rows[1][4].is_null());
+    EXPECT_EQ(rows[1][5], "Food");
+}
+
+TEST(MockSheetsTest, BadBatchChangesNothing)
+{
+    mock_sheets::Service service;
+    service.setValues("s", "Transactions", {{"a"}});
+    std::uint64_t version = service.version("s");
+
+    json request = {{"data",
+                     {{{"range", "Transactions!A1:A1"}, {"values", {{"changed"}}}},
+                      {{"range", "Transactions!B1:B1"}, {"values", {{"too", "wide"}}}}}}};
+    network::HttpResponse response =
+        service.handle("/v4/spreadsheets/s/values:batchUpdate", "POST", request.dump());
+    EXPECT_EQ(response.code, 400);
+    EXPECT_EQ(service.values("s", "Transactions")[0][0], "a");
+    EXPECT_EQ(service.version("s"), version);
+}
+
+TEST(MockSheetsTest, AppendsAfterTheLastRow)
+{
+    mock_sheets::Service service;
+    service.setValues("s", "Transactions", {{"Account"}, {"Cash"}, {"BCA"}});
+
+    json request = {{"values", {{"Jenius", "Coffee", "2024-01-02", 35000}}}};
+    network::HttpResponse response = service.handle(
+        "/v4/spreadsheets/s/values/Transactions!A:D:append", "POST", request.dump());
+    ASSERT_EQ(response.code, 200) << response.content;
+    EXPECT_EQ(json::parse(response.content)["updates"]["updatedRange"], "Transactions!A4:D4");
+
+    auto rows = service.values("s", "Transactions");
+    ASSERT_EQ(rows.size(), 4u);
+    EXPECT_EQ(rows[3][0], "Jenius");
+    EXPECT_EQ(rows[3][2], 45293.0);
+    EXPECT_EQ(rows[3][3], 35000);
+}
+
+TEST(MockSheetsTest, UpdatesARange)
+{
+    mock_sheets::Service service;
+    json request = {{"values", {{"x", "y"}, {"z"}}}};
+    network::HttpResponse response =
+        service.handle("/v4/spreadsheets/s/values/Sheet1!B2:C3", "PUT", request.dump());
+    ASSERT_EQ(response.code, 200) << response.content;
+    EXPECT_EQ(json::parse(response.content)["updatedCells"], 3);
+    EXPECT_EQ(json::parse(response.content)["updatedRange"], "Sheet1!B2:C3");
+
+    json read = getJson(service, "/v4/spreadsheets/s/values/Sheet1!A1:C3");
+    EXPECT_EQ(read["values"], json::parse(R"([[],["","x","y"],["","z"]])"));
+}
+
+TEST(MockSheetsTest, RejectsUnknownRequests)
+{
+    mock_sheets::Service service;
+    EXPECT_EQ(service.handle("/v4/spreadsheets/s/values/A1!%%", "GET", "").code, 400);
+    EXPECT_EQ(service.handle("/v4/spreadsheets/s/values/Sheet1!A0", "GET", "").code, 400);
+    EXPECT_EQ(service.handle("/v4/spreadsheets/s/values/Sheet1!C1:A1", "GET", "").code, 400);
+    EXPECT_EQ(service.handle("/v4/spreadsheets/s", "GET", "").code, 404);
+    EXPECT_EQ(service.handle("/v4/spreadsheets/s/values/Sheet1!A1", "DELETE", "").code, 404);
+    EXPECT_EQ(service.handle("/elsewhere", "GET", "").code, 404);
+    EXPECT_EQ(service.handle("/v4/spreadsheets/s/values:batchUpdate", "POST", "{").code, 400);
+}
+
+TEST(MockSheetsTest, InjectsRateLimitsAndErrors)
+{
+    mock_sheets::Faults faults;
+    faults.rateLimitRate = 1.0;
+    faults.retryAfterSeconds = 7;
+    mock_sheets::Service service(faults);
+
+    network::HttpResponse response = service.handle("/drive/v3/files/s", "GET", "");
+    EXPECT_EQ(response.code, 429);
+    ASSERT_EQ(response.headers.size(), 1u);
+    EXPECT_EQ(response.headers[0].first, "Retry-After");
+    EXPECT_EQ(response.headers[0].second, "7");
+
+    faults.rateLimitRate = 0.0;
+    faults.errorRate = 1.0;
+    service.setFaults(faults);
+    EXPECT_EQ(service.handle("/drive/v3/files/s", "GET", "").code, 503);
+
+    faults.errorRate = 0.0;
+    service.setFaults(faults);
+    EXPECT_EQ(service.handle("/drive/v3/files/s", "GET", "").code, 200);
+}
+
+TEST(MockSheetsTest, ServesTheClientEndToEnd)
+{
+    mock_sheets::Service service;
+    service.setValues("s", "Transactions",
+                      {{"Account", "Subject", "Date", "Amount", "Currency", "Category"},
+                       {"Cash", "Lunch", 45292.5, -20000, "IDR"},
+                       {"Cash", "Lunch", 45292.5, -20000, "IDR"}});
+
+    auto requester = inProcessRequester(service);
+    sheet::Client client(requester, std::make_shared<auth::StaticTokenProvider>("mock"));
+    // Without the trailing slash, which the client adds
+    client.setBaseUrls("http://mock/v4/spreadsheets", DRIVE_BASE);
+    client.setSheetId("s");
+
+    std::string revision = client.getRevision();
+    auto transactions = client.getTransactions();
+    ASSERT_EQ(transactions.size(), 2u);
+    EXPECT_EQ(transactions[1].subject, "Lunch");
+    EXPECT_EQ(transactions[1].amount, -20000);
+
+    sheet::Ledger ledger = sheet::Ledger::fromTransactions(transactions);
+    client.queueEdits(ledger, {{sheet::RowEdit::Kind::MARK_DUPLICATE, 1, 0, ""}}, 2);
+    client.flushUpdates();
+
+    transactions = client.getTransactions();
+    EXPECT_EQ(transactions[1].subject, "?dupof(2) Lunch");
+    EXPECT_EQ(transactions[1].amount, 0);
+    EXPECT_NE(client.getRevision(), revision);
+
+    client.addTransaction({"BCA", "Coffee", std::chrono::system_clock::time_point(
+                                                std::chrono::hours(24 * 19724 + 9)),
+                           35000, "", ""});
+    transactions = client.getTransactions();
+    ASSERT_EQ(transactions.size(), 3u);
+    EXPECT_EQ(transactions[2].subject, "Coffee");
+    EXPECT_EQ(transactions[2].date,
+              std::chrono::system_clock::time_point(std::chrono::hours(24 * 19724 + 9)));
+}
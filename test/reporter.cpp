@@ -0,0 +1,159 @@
+#include "reporter/report.hpp"
+
+#include <gtest/gtest.h>
+
+#include "test_utils.hpp"
+
+static std::int64_t epochSeconds(std::chrono::system_clock::time_point timePoint)
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(timePoint.time_since_epoch()).count();
+}
+
+TEST(Reporter, FormatsAmountsWithThousandsSeparators)
+{
+    EXPECT_EQ(reporter::formatAmount(0), "0");
+    EXPECT_EQ(reporter::formatAmount(999), "999");
+    EXPECT_EQ(reporter::formatAmount(1000), "1,000");
+    EXPECT_EQ(reporter::formatAmount(1234567), "1,234,567");
+    EXPECT_EQ(reporter::formatAmount(-250000), "-250,000");
+    EXPECT_EQ(reporter::formatAmount(INT64_MIN), "-9,223,372,036,854,775,808");
+}
+
+TEST(Reporter, TotalsRowsSinceCutoffByCategoryAndCurrency)
+{
+    auto ledger = sheet::Ledger::fromTransactions({
+        {"Bank A", "Old", makeTimePoint(2024, 12, 1), -99000, "IDR", "Food"},
+        {"Bank A", "Lunch", makeTimePoint(2025, 1, 2), -50000, "IDR", "Food"},
+        {"Bank A", "Dinner", makeTimePoint(2025, 1, 3), -75000, "IDR", "Food"},
+        {"Card", "Ramen", makeTimePoint(2025, 1, 3), -1200, "JPY", "Food"},
+        {"Card", "Misc", makeTimePoint(2025, 1, 4), -300, "JPY", ""},
+        {"Bank A", "Salary", makeTimePoint(2025, 1, 5), 9000000, "IDR", "Income"},
+    });
+
+    auto totals = reporter::totalsSince(ledger, epochSeconds(makeTimePoint(2025, 1, 1)));
+
+    ASSERT_EQ(totals.size(), 3);
+    EXPECT_EQ(totals["Food"]["IDR"], -125000);
+    EXPECT_EQ(totals["Food"]["JPY"], -1200);
+    EXPECT_EQ(totals["Uncategorized"]["JPY"], -300);
+    EXPECT_EQ(totals["Income"]["IDR"], 9000000);
+
+    EXPECT_EQ(reporter::formatReport(totals), "**Food**: 125,000 IDR | 1,200 JPY\n"
+                                              "**Income**: 9,000,000 IDR\n"
+                                              "**Uncategorized**: 300 JPY");
+}
+
+TEST(Reporter, EmptyReportWhenNothingInPeriod)
+{
+    auto ledger = sheet::Ledger::fromTransactions({
+        {"Bank A", "Old", makeTimePoint(2024, 12, 1), -99000, "IDR", "Food"},
+    });
+
+    auto totals = reporter::totalsSince(ledger, epochSeconds(makeTimePoint(2025, 1, 1)));
+    EXPECT_TRUE(totals.empty());
+    EXPECT_EQ(reporter::formatReport(totals), "");
+}
+
+TEST(Reporter, TotalsBetweenTakesUnsortedRowsAndExcludesTheEnd)
+{
+    auto ledger = sheet::Ledger::fromTransactions({
+        {"Bank A", "Late", makeTimePoint(2025, 1, 8), -7000, "IDR", "Food"},
+        {"Bank A", "Lunch", makeTimePoint(2025, 1, 2), -50000, "IDR", "Food"},
+        {"Bank A", "Old", makeTimePoint(2024, 12, 1), -99000, "IDR", "Food"},
+        {"Bank A", "Dinner", makeTimePoint(2025, 1, 7, 23, 59), -75000, "IDR", "Food"},
+        {"Bank A", "First", makeTimePoint(2025, 1, 1), -1000, "IDR", "Food"},
+    });
+
+    auto totals = reporter::totalsBetween(ledger, epochSeconds(makeTimePoint(2025, 1, 1)),
+                                          epochSeconds(makeTimePoint(2025, 1, 8)));
+    ASSERT_EQ(totals.size(), 1);
+    EXPECT_EQ(totals["Food"]["IDR"], -126000);
+}
+
+TEST(Reporter, SumTableGrowsAndMerges)
+{
+    reporter::SumTable table;
+    reporter::SumTable other(1);
+    for (std::uint32_t category = 0; category < 500; ++category)
+    {
+        for (std::uint32_t currency = 0; currency < 4; ++currency)
+        {
+            table.add(category, currency, category * 10 + currency);
+            table.add(category, currency, 1);
+            other.add(category, currency, -1);
+        }
+    }
+    other.add(1000, 0, 42);
+
+    EXPECT_EQ(table.size(), 2000u);
+    EXPECT_EQ(table.sum(123, 2), 1233);
+    EXPECT_EQ(table.sum(123, 9), 0);
+
+    table.merge(other);
+    EXPECT_EQ(table.size(), 2001u);
+    EXPECT_EQ(table.sum(123, 2), 1232);
+    EXPECT_EQ(table.sum(1000, 0), 42);
+
+    std::int64_t total = 0;
+    for (const auto &entry : table.entries())
+    {
+        EXPECT_EQ(entry.sum, table.sum(entry.category, entry.currency));
+        total += entry.sum;
+    }
+    EXPECT_EQ(total, 42 + 4 * 10 * (499 * 500 / 2) + 500 * (0 + 1 + 2 + 3));
+}
+
+TEST(Reporter, ParallelSumsMatchSequential)
+{
+    const char *categories[] = {"Food", "Rent", "Travel", ""};
+    const char *currencies[] = {"IDR", "JPY", "EUR"};
+    sheet::Ledger ledger;
+    for (int i = 0; i < 20000; ++i)
+    {
+        ledger.append({"Bank " + std::to_string(i % 7), "Row", makeTimePoint(2025, 1, 1 + i % 28),
+                       (i % 2 == 0 ? -1 : 1) * (i * 37 % 100000), currencies[i % 3],
+                       categories[i % 4]});
+    }
+    std::int64_t from = epochSeconds(makeTimePoint(2025, 1, 5));
+    std::int64_t until = epochSeconds(makeTimePoint(2025, 1, 20));
+
+    concurrency::ThreadPool pool(4);
+    auto sequential = reporter::sumsBetween(ledger, from, until);
+    auto parallel = reporter::sumsBetween(ledger, from, until, pool, 1000);
+
+    ASSERT_EQ(parallel.size(), sequential.size());
+    for (const auto &entry : sequential.entries())
+    {
+        EXPECT_EQ(parallel.sum(entry.category, entry.currency), entry.sum);
+    }
+    EXPECT_EQ(reporter::totalsSince(ledger, from, pool), reporter::totalsSince(ledger, from));
+}
+
+TEST(Reporter, SumsPastTheRangeOfInt)
+{
+    sheet::Ledger ledger;
+    for (int i = 0; i < 8; ++i)
+    {
+        ledger.append({"Bank A", "Salary", makeTimePoint(2025, 1, 1 + i), INT32_MAX, "IDR", "Pay"});
+    }
+
+    concurrency::ThreadPool pool(4);
+    auto sums = reporter::sumsBetween(ledger, 0, INT64_MAX, pool, 2);
+    auto totals = reporter::totalsFromSums(ledger, sums);
+    EXPECT_EQ(totals["Pay"]["IDR"], 8 * static_cast<std::int64_t>(INT32_MAX));
+}
+
+TEST(Reporter, ComparesTwoPeriods)
+{
+    reporter::TotalsByCategory current = {{"Food", {{"IDR", -125000}, {"JPY", -1200}}},
+                                          {"Income", {{"IDR", 9000000}}}};
+    reporter::TotalsByCategory previous = {{"Food", {{"IDR", -113000}}},
+                                           {"Travel", {{"USD", -40}}},
+                                           {"Income", {{"IDR", 9000000}}}};
+
+    EXPECT_EQ(reporter::formatComparison(current, previous),
+              "**Food**: 125,000 IDR (+12,000) | 1,200 JPY (+1,200)\n"
+              "**Income**: 9,000,000 IDR (+0)\n"
+              "**Travel**: 0 USD (-40)");
+    EXPECT_EQ(reporter::formatComparison({}, {}), "");
+}
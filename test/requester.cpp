@@ -0,0 +1,155 @@
+#include "lib/network/requester.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "lib/network/http_server.hpp"
+
+static const std::string BIG_BODY(256 * 1024, 'x');
+
+// Drives the curl engine against a local HttpServer with a worker pool, so several requests
+// can be in the handler at once
+class RequesterTest : public ::testing::Test
+{
+  protected:
+    network::HttpServer server;
+    std::thread loop;
+    std::atomic<int> inHandler{0};
+    std::atomic<int> peakInHandler{0};
+
+    void SetUp() override
+    {
+        server.setPort(0);
+        server.setWorkerPool(8, 64);
+        server.setRequestHandler(
+            [this](const std::string &path, const std::string &, const std::string &)
+            {
+                if (path == "/hold")
+                {
+                    int now = ++inHandler;
+                    int peak = peakInHandler;
+                    while (now > peak && !peakInHandler.compare_exchange_weak(peak, now))
+                    {
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    --inHandler;
+                }
+                if (path == "/big")
+                {
+                    return network::HttpResponse{200, BIG_BODY, "text/plain", {}};
+                }
+                if (path == "/missing")
+                {
+                    return network::HttpResponse{404, "no such thing", "text/plain", {}};
+                }
+                return network::HttpResponse{200, "ok", "text/plain", {}};
+            });
+        server.start();
+        loop = std::thread([this]() { server.run(); });
+    }
+
+    void TearDown() override
+    {
+        server.stop();
+        loop.join();
+    }
+
+    std::string url(const std::string &path)
+    {
+        return "http://127.0.0.1:" + std::to_string(server.port()) + path;
+    }
+};
+
+TEST_F(RequesterTest, CapsTransfersInFlight)
+{
+    network::Requester requester(2);
+
+    std::vector<std::future<network::Response>> responses;
+    for (int i = 0; i < 8; ++i)
+    {
+        responses.push_back(requester.sendAsync({"GET", url("/hold"), {}, ""}));
+    }
+    for (auto &response : responses)
+    {
+        EXPECT_EQ(response.get().code, 200);
+    }
+    EXPECT_EQ(peakInHandler, 2);
+
+    peakInHandler = 0;
+    requester.setMaxInFlight(4);
+    responses.clear();
+    for (int i = 0; i < 8; ++i)
+    {
+        responses.push_back(requester.sendAsync({"GET", url("/hold"), {}, ""}));
+    }
+    for (auto &response : responses)
+    {
+        EXPECT_EQ(response.get().code, 200);
+    }
+    EXPECT_GT(peakInHandler, 2);
+    EXPECT_LE(peakInHandler, 4);
+}
+
+TEST_F(RequesterTest, ReusesIdleConnections)
+{
+    network::Requester requester;
+    for (int i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ(requester.getRequest(url("/"), {}), "ok");
+    }
+
+    network::RequesterStats stats = requester.getStats();
+    EXPECT_EQ(stats.requests, 5u);
+    EXPECT_EQ(stats.newConnections, 1u);
+    EXPECT_EQ(stats.reusedConnections, 4u);
+}
+
+TEST_F(RequesterTest, StreamsBodiesAndAbortsWhenAsked)
+{
+    network::Requester requester;
+
+    std::string streamed;
+    network::Request request{"GET", url("/big"), {}, ""};
+    request.onData = [&streamed](const char *data, std::size_t length)
+    {
+        streamed.append(data, length);
+        return true;
+    };
+    network::Response response = requester.sendAsync(request).get();
+    EXPECT_EQ(response.code, 200);
+    EXPECT_TRUE(response.body.empty());
+    EXPECT_EQ(streamed, BIG_BODY);
+
+    std::size_t calls = 0;
+    request.onData = [&calls](const char *, std::size_t)
+    {
+        ++calls;
+        return false;
+    };
+    EXPECT_THROW(requester.sendAsync(request).get(), std::runtime_error);
+    EXPECT_EQ(calls, 1u);
+
+    // The aborted transfer does not take the engine down with it
+    EXPECT_EQ(requester.getRequest(url("/"), {}), "ok");
+}
+
+TEST_F(RequesterTest, KeepsErrorBodies)
+{
+    network::Requester requester;
+
+    bool streamed = false;
+    network::Request request{"GET", url("/missing"), {}, ""};
+    request.onData = [&streamed](const char *, std::size_t)
+    {
+        streamed = true;
+        return true;
+    };
+    network::Response response = requester.sendAsync(request).get();
+    EXPECT_EQ(response.code, 404);
+    EXPECT_EQ(response.body, "no such thing");
+    EXPECT_FALSE(streamed);
+
+    EXPECT_THROW(requester.postRequest(url("/missing"), {}, "{}"), std::runtime_error);
+}
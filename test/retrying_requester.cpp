@@ -0,0 +1,132 @@
+#include "lib/network/retrying_requester.hpp"
+
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "test_utils.hpp"
+
+static network::RetryPolicy fastPolicy()
+{
+    network::RetryPolicy policy;
+    policy.baseDelay = std::chrono::milliseconds(1);
+    policy.maxDelay = std::chrono::milliseconds(500);
+    return policy;
+}
+
+TEST(RetryingRequesterTest, RetriesTransientFailuresOfIdempotentRequests)
+{
+    auto inner = std::make_shared<ScriptedRequester>();
+    inner->queue({503});
+    inner->queue({0, "", {}, true});
+    network::RetryingRequester requester(inner, fastPolicy());
+
+    EXPECT_EQ(requester.getRequest("http://sheets/v4/a", {}), "ok");
+    EXPECT_EQ(inner->sent().size(), 3u);
+    EXPECT_EQ(requester.retryCount(), 2u);
+
+    // values:batchUpdate is a POST that can be repeated
+    inner->queue({502});
+    network::Request request{"POST", "http://sheets/v4/a/values:batchUpdate", {}, "{}"};
+    request.idempotent = true;
+    EXPECT_EQ(requester.sendAsync(request).get().code, 200);
+    EXPECT_EQ(inner->sent().size(), 5u);
+}
+
+TEST(RetryingRequesterTest, RetriesOtherPostsOnlyWhenRateLimited)
+{
+    auto inner = std::make_shared<ScriptedRequester>();
+    inner->queue({429, "", {{"retry-after", "0"}}});
+    network::RetryingRequester requester(inner, fastPolicy());
+    EXPECT_EQ(requester.postRequest("http://sheets/v4/a:append", {}, "{}"), "ok");
+    EXPECT_EQ(inner->sent().size(), 2u);
+
+    inner->queue({503});
+    EXPECT_THROW(requester.postRequest("http://sheets/v4/a:append", {}, "{}"),
+                 std::runtime_error);
+    inner->queue({0, "", {}, true});
+    EXPECT_THROW(requester.postRequest("http://sheets/v4/a:append", {}, "{}"),
+                 std::runtime_error);
+    EXPECT_EQ(inner->sent().size(), 4u);
+}
+
+TEST(RetryingRequesterTest, GivesUpOnLongRetryAfterAndAfterMaxAttempts)
+{
+    auto inner = std::make_shared<ScriptedRequester>();
+    inner->queue({429, "", {{"retry-after", "60"}}});
+    network::RetryingRequester requester(inner, fastPolicy());
+    EXPECT_EQ(requester.sendAsync({"GET", "http://sheets/v4/a", {}, ""}).get().code, 429);
+    EXPECT_EQ(inner->sent().size(), 1u);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        inner->queue({500});
+    }
+    EXPECT_THROW(requester.getRequest("http://sheets/v4/a", {}), std::runtime_error);
+    EXPECT_EQ(inner->sent().size(), 5u);
+
+    // A client error is the caller's problem; retrying would not change it
+    inner->queue({404});
+    EXPECT_THROW(requester.getRequest("http://sheets/v4/a", {}), std::runtime_error);
+    EXPECT_EQ(inner->sent().size(), 6u);
+}
+
+TEST(RetryingRequesterTest, SpendsARetryBudget)
+{
+    auto policy = fastPolicy();
+    policy.budgetCap = 1;
+    policy.budgetRatio = 0;
+    auto inner = std::make_shared<ScriptedRequester>();
+    network::RetryingRequester requester(inner, policy);
+
+    inner->queue({503});
+    EXPECT_EQ(requester.getRequest("http://sheets/v4/a", {}), "ok");
+    inner->queue({503});
+    EXPECT_THROW(requester.getRequest("http://sheets/v4/a", {}), std::runtime_error);
+    EXPECT_EQ(inner->sent().size(), 3u);
+    EXPECT_EQ(requester.retryCount(), 1u);
+}
+
+TEST(RetryingRequesterTest, OpensTheCircuitPerHost)
+{
+    auto policy = fastPolicy();
+    policy.maxAttempts = 1;
+    policy.breakerThreshold = 2;
+    policy.breakerCooldown = std::chrono::milliseconds(50);
+    auto inner = std::make_shared<ScriptedRequester>();
+    network::RetryingRequester requester(inner, policy);
+
+    inner->queue({503});
+    inner->queue({0, "", {}, true});
+    EXPECT_THROW(requester.getRequest("https://down.example/a", {}), std::runtime_error);
+    EXPECT_THROW(requester.getRequest("https://down.example/b", {}), std::runtime_error);
+
+    // Fails without reaching the host, while other hosts are unaffected
+    EXPECT_THROW(requester.getRequest("https://down.example/c", {}), std::runtime_error);
+    EXPECT_EQ(requester.getRequest("https://up.example/a", {}), "ok");
+    EXPECT_EQ(inner->sent().size(), 3u);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    EXPECT_EQ(requester.getRequest("https://down.example/c", {}), "ok");
+    EXPECT_EQ(inner->sent().size(), 4u);
+}
+
+TEST(RetryingRequesterTest, RetriesAStreamOnlyBeforeItsBodyArrives)
+{
+    auto inner = std::make_shared<ScriptedRequester>();
+    network::RetryingRequester requester(inner, fastPolicy());
+    std::string received;
+    auto onChunk = [&received](const char *data, std::size_t length)
+    { received.append(data, length); };
+
+    inner->queue({503});
+    requester.getRequestStream("http://sheets/v4/a", {}, onChunk);
+    EXPECT_EQ(received, "ok");
+    EXPECT_EQ(inner->sent().size(), 2u);
+
+    received.clear();
+    inner->queue({200, "ok", {}, true});
+    EXPECT_THROW(requester.getRequestStream("http://sheets/v4/a", {}, onChunk),
+                 std::runtime_error);
+    EXPECT_EQ(received, "ok");
+    EXPECT_EQ(inner->sent().size(), 3u);
+}
@@ -0,0 +1,153 @@
+#include "reporter/rollup.hpp"
+
+#include <gtest/gtest.h>
+
+#include "reporter/period.hpp"
+#include "reporter/report.hpp"
+
+#include "test_utils.hpp"
+
+static const std::int64_t DAY = 24 * 60 * 60;
+
+static std::int64_t epochSeconds(std::chrono::system_clock::time_point timePoint)
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(timePoint.time_since_epoch()).count();
+}
+
+// About two years of rows, a few a day, in several categories, currencies and accounts
+static std::vector<sheet::Transaction> makeRows()
+{
+    static const char *const CATEGORIES[] = {"Food", "Transport", "", "Bills"};
+    static const char *const CURRENCIES[] = {"IDR", "USD"};
+    static const char *const ACCOUNTS[] = {"Cash", "Bank A", "Card"};
+
+    std::vector<sheet::Transaction> rows;
+    auto start = makeTimePoint(2023, 11, 20);
+    for (int i = 0; i < 3000; ++i)
+    {
+        rows.push_back({ACCOUNTS[i % 3], "Row " + std::to_string(i),
+                        start + std::chrono::hours(i * 6 + i % 5),
+                        (i % 7 == 0 ? 1 : -1) * (1000 + i), CURRENCIES[(i / 3) % 2],
+                        CATEGORIES[(i / 2) % 4]});
+    }
+    return rows;
+}
+
+TEST(Period, ConvertsCivilDates)
+{
+    EXPECT_EQ(reporter::daysFromCivil(1970, 1, 1), 0);
+    EXPECT_EQ(reporter::daysFromCivil(2000, 3, 1), 11017);
+    EXPECT_EQ(reporter::daysFromCivil(1969, 12, 31), -1);
+
+    for (std::int64_t day = -800000; day < 800000; day += 97)
+    {
+        int year = 0;
+        unsigned month = 0, dayOfMonth = 0;
+        reporter::civilFromDays(day, year, month, dayOfMonth);
+        ASSERT_EQ(reporter::daysFromCivil(year, month, dayOfMonth), day);
+    }
+
+    EXPECT_EQ(reporter::dayOf(0), 0);
+    EXPECT_EQ(reporter::dayOf(DAY - 1), 0);
+    EXPECT_EQ(reporter::dayOf(-1), -1);
+    EXPECT_EQ(reporter::formatDay(reporter::daysFromCivil(2024, 2, 29)), "2024-02-29");
+}
+
+TEST(Period, ParsesPeriodsEndingToday)
+{
+    std::int64_t now = epochSeconds(makeTimePoint(2025, 3, 15, 12, 30));
+    std::int64_t today = reporter::daysFromCivil(2025, 3, 15);
+
+    reporter::Period week = reporter::parsePeriod("week", now);
+    EXPECT_EQ(week.firstDay, today - 6);
+    EXPECT_EQ(week.endDay, today + 1);
+
+    reporter::Period month = reporter::parsePeriod("month", now);
+    EXPECT_EQ(month.firstDay, reporter::daysFromCivil(2025, 3, 1));
+    EXPECT_EQ(month.endDay, today + 1);
+
+    reporter::Period ytd = reporter::parsePeriod("ytd", now);
+    EXPECT_EQ(ytd.firstDay, reporter::daysFromCivil(2025, 1, 1));
+
+    reporter::Period custom = reporter::parsePeriod("2024-02-01..2024-02-29", now);
+    EXPECT_EQ(custom.firstDay, reporter::daysFromCivil(2024, 2, 1));
+    EXPECT_EQ(custom.endDay, reporter::daysFromCivil(2024, 3, 1));
+    EXPECT_EQ(custom.label, "2024-02-01 to 2024-02-29");
+
+    reporter::Period before = reporter::previousPeriod(week);
+    EXPECT_EQ(before.firstDay, today - 13);
+    EXPECT_EQ(before.endDay, today - 6);
+
+    EXPECT_THROW(reporter::parsePeriod("fortnight", now), std::runtime_error);
+    EXPECT_THROW(reporter::parsePeriod("2025-02-30..2025-03-01", now), std::runtime_error);
+    EXPECT_THROW(reporter::parsePeriod("2025-03-02..2025-03-01", now), std::runtime_error);
+    EXPECT_THROW(reporter::parsePeriod("2025-3-1x..2025-03-01", now), std::runtime_error);
+}
+
+TEST(DailyRollup, MatchesARescanForAnyWindow)
+{
+    auto rows = makeRows();
+    auto ledger = sheet::Ledger::fromTransactions(rows);
+
+    // Built in two steps, as rows get appended
+    reporter::DailyRollup rollup;
+    auto firstHalf = sheet::Ledger::fromTransactions(
+        std::vector<sheet::Transaction>(rows.begin(), rows.begin() + 1234));
+    rollup.append(firstHalf);
+    rollup.append(ledger, 1234);
+
+    std::vector<std::pair<const char *, const char *>> windows = {
+        {"2023-01-01", "2023-12-31"}, {"2024-01-01", "2024-12-31"}, {"2024-02-01", "2024-02-29"},
+        {"2024-02-10", "2024-05-20"}, {"2024-03-31", "2024-04-01"}, {"2023-11-20", "2023-11-20"},
+        {"2024-06-15", "2025-09-30"}, {"2030-01-01", "2030-12-31"},
+    };
+    for (const auto &window : windows)
+    {
+        reporter::Period period =
+            reporter::parsePeriod(std::string(window.first) + ".." + window.second, 0);
+        EXPECT_EQ(rollup.totals(period),
+                  reporter::totalsBetween(ledger, period.firstDay * DAY, period.endDay * DAY))
+            << window.first << ".." << window.second;
+    }
+}
+
+TEST(DailyRollup, TakesRowsOutOfOrderAndRetractions)
+{
+    reporter::DailyRollup rollup;
+    std::int64_t march = epochSeconds(makeTimePoint(2025, 3, 10, 9));
+    std::int64_t january = epochSeconds(makeTimePoint(2025, 1, 5, 9));
+    rollup.add(march, "Food", "IDR", "Cash", -5000);
+    rollup.add(january, "Food", "IDR", "Cash", -2000);
+    rollup.add(january, "Food", "IDR", "Card", -1000);
+    // The January cash row changed: taken back out, then added as it is now
+    rollup.add(january, "Food", "IDR", "Cash", 2000);
+    rollup.add(january, "Transport", "IDR", "Cash", -2000);
+
+    EXPECT_EQ(rollup.groupCount(), 3u);
+
+    auto totals = rollup.totals(reporter::parsePeriod("2025-01-01..2025-12-31", 0));
+    EXPECT_EQ(totals["Food"]["IDR"], -6000);
+    EXPECT_EQ(totals["Transport"]["IDR"], -2000);
+
+    totals = rollup.totals(reporter::parsePeriod("2025-01-01..2025-01-31", 0));
+    EXPECT_EQ(totals["Food"]["IDR"], -1000);
+
+    // Per account, from the group sums
+    auto sums = rollup.sums(reporter::parsePeriod("2025-01-01..2025-03-31", 0));
+    std::int64_t cash = 0;
+    for (std::uint32_t id = 0; id < rollup.groupCount(); ++id)
+    {
+        if (rollup.accounts().view(rollup.group(id).account) == "Cash")
+        {
+            cash += sums[id];
+        }
+    }
+    EXPECT_EQ(cash, -7000);
+}
+
+TEST(DailyRollup, EmptyRollupHasNoTotals)
+{
+    reporter::DailyRollup rollup;
+    EXPECT_TRUE(rollup.totals(reporter::parsePeriod("week", 0)).empty());
+    EXPECT_TRUE(rollup.sums(reporter::parsePeriod("week", 0)).empty());
+}
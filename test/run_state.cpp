@@ -0,0 +1,152 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "marksman/duplifinder.hpp"
+#include "marksman/run_state.hpp"
+
+#include "test_utils.hpp"
+
+class RunStateTest : public ::testing::Test
+{
+  protected:
+    std::string path;
+
+    void SetUp() override
+    {
+        path = testTempPath("marksman_state_").string();
+        std::filesystem::remove(path);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove(path);
+    }
+};
+
+TEST_F(RunStateTest, MissingFileIsNotAnError)
+{
+    marksman::RunState state;
+    EXPECT_FALSE(marksman::loadRunState(path, state));
+}
+
+TEST_F(RunStateTest, RoundTrips)
+{
+    marksman::RunState state;
+    state.sheetId = "sheet-1";
+    state.nextRow = 12;
+    state.tailStartRow = 10;
+    state.cutoff = -1735689600;
+    state.tailHashes = {0xfedcba9876543210ULL, 42};
+    marksman::saveRunState(path, state);
+
+    marksman::RunState loaded;
+    ASSERT_TRUE(marksman::loadRunState(path, loaded));
+    EXPECT_EQ(loaded.sheetId, "sheet-1");
+    EXPECT_EQ(loaded.nextRow, 12);
+    EXPECT_EQ(loaded.tailStartRow, 10);
+    EXPECT_EQ(loaded.cutoff, -1735689600);
+    EXPECT_EQ(loaded.tailHashes, state.tailHashes);
+}
+
+TEST_F(RunStateTest, RejectsInconsistentFile)
+{
+    std::ofstream(path) << "marksman-state 2\nsheet s\nnext-row 12\ntail-start-row 10\n"
+                           "cutoff 0\ntail 1\n";
+
+    marksman::RunState state;
+    EXPECT_THROW(marksman::loadRunState(path, state), std::runtime_error);
+}
+
+TEST(RunState, TailStartsOneWindowBeforeNewest)
+{
+    std::vector<sheet::Transaction> transactions = {
+        {"Bank A", "Old", makeTimePoint(2025, 1, 1, 10, 5, 0), 100, "IDR", ""},
+        {"Bank A", "Recent", makeTimePoint(2025, 1, 4, 10, 5, 0), 200, "IDR", ""},
+        {"Bank A", "Newest", makeTimePoint(2025, 1, 5, 10, 5, 0), 300, "IDR", ""},
+    };
+
+    auto ledger = sheet::Ledger::fromTransactions(transactions);
+    auto state = marksman::advanceRunState("s", ledger, 20, std::chrono::hours(48));
+
+    EXPECT_EQ(state.nextRow, 23);
+    EXPECT_EQ(state.tailStartRow, 21);
+    ASSERT_EQ(state.tailHashes.size(), 2);
+    EXPECT_EQ(state.tailHashes[0], marksman::rowFingerprint(ledger, 1));
+}
+
+TEST(RunState, TailSurvivesMarkingButNotShiftedRows)
+{
+    std::vector<sheet::Transaction> transactions = {
+        {"Bank A", "Coffee", makeTimePoint(2025, 1, 1, 10, 5, 0), 100, "IDR", ""},
+        {"Bank A", "Coffee", makeTimePoint(2025, 1, 1, 11, 5, 0), 100, "IDR", ""},
+    };
+    auto state = marksman::advanceRunState("s", sheet::Ledger::fromTransactions(transactions),
+                                           2, std::chrono::hours(48));
+
+    // What the sheet looks like after this run's updates, plus a new row
+    auto next = transactions;
+    next[1].subject = "?dupof(2) Coffee";
+    next[1].amount = 0;
+    next[0].category = "Food";
+    next.push_back({"Bank B", "Tea", makeTimePoint(2025, 1, 2, 9, 5, 0), 50, "IDR", ""});
+    EXPECT_TRUE(marksman::tailMatches(state, sheet::Ledger::fromTransactions(next)));
+
+    // A row deleted above the tail shifts everything up
+    next.erase(next.begin());
+    EXPECT_FALSE(marksman::tailMatches(state, sheet::Ledger::fromTransactions(next)));
+}
+
+TEST(RunState, IncrementalRunFindsDuplicateAgainstTail)
+{
+    std::vector<sheet::Transaction> sheetRows = {
+        {"Bank A", "Rent", makeTimePoint(2025, 1, 1, 8, 5, 0), 5000, "IDR", ""},
+        {"Bank A", "Lunch", makeTimePoint(2025, 1, 10, 12, 5, 0), 700, "IDR", ""},
+        {"Bank B", "Taxi", makeTimePoint(2025, 1, 10, 18, 5, 0), 300, "IDR", ""},
+    };
+    auto state = marksman::advanceRunState("s", sheet::Ledger::fromTransactions(sheetRows), 2,
+                                           std::chrono::hours(48));
+    EXPECT_EQ(state.tailStartRow, 3);
+
+    // Next run: the fetch starts at the tail and includes a duplicate of row 3
+    std::vector<sheet::Transaction> fetched(sheetRows.begin() + 1, sheetRows.end());
+    fetched.push_back({"Bank A", "Lunch", makeTimePoint(2025, 1, 10, 12, 35, 0), 700, "IDR", ""});
+    ASSERT_TRUE(marksman::tailMatches(state, sheet::Ledger::fromTransactions(fetched)));
+
+    auto duplicates =
+        marksman::findPossibleDuplicates(fetched, std::chrono::hours(48), state.tailStartRow);
+    ASSERT_EQ(duplicates.size(), 1);
+    EXPECT_EQ(duplicates[0].row, 5);
+    EXPECT_EQ(duplicates[0].transaction->subject, "?dupof(3) Lunch");
+}
+
+TEST(RunState, BackDatedRowsReachPastTheTail)
+{
+    std::vector<sheet::Transaction> sheetRows = {
+        {"Bank A", "Lunch", makeTimePoint(2025, 1, 1, 12, 5, 0), 700, "IDR", ""},
+        {"Bank A", "Rent", makeTimePoint(2025, 1, 10, 8, 5, 0), 5000, "IDR", ""},
+    };
+    auto state = marksman::advanceRunState("s", sheet::Ledger::fromTransactions(sheetRows), 2,
+                                           std::chrono::hours(48));
+    EXPECT_EQ(state.tailStartRow, 3);
+    auto cutoff = makeTimePoint(2025, 1, 8, 8, 5, 0).time_since_epoch();
+    EXPECT_EQ(state.cutoff, std::chrono::duration_cast<std::chrono::seconds>(cutoff).count());
+
+    // Dated well after the tail's start: the incremental fetch is enough
+    std::vector<sheet::Transaction> fetched(sheetRows.begin() + 1, sheetRows.end());
+    fetched.push_back({"Bank B", "Taxi", makeTimePoint(2025, 1, 11, 9, 0, 0), 300, "IDR", ""});
+    EXPECT_FALSE(marksman::reachesBeforeTail(state, sheet::Ledger::fromTransactions(fetched),
+                                             std::chrono::hours(48)));
+
+    // A late entry of the lunch in row 2; only a full run can pair the two
+    fetched.push_back({"Bank A", "Lunch", makeTimePoint(2025, 1, 1, 12, 35, 0), 700, "IDR", ""});
+    auto ledger = sheet::Ledger::fromTransactions(fetched);
+    ASSERT_TRUE(marksman::tailMatches(state, ledger));
+    EXPECT_TRUE(marksman::reachesBeforeTail(state, ledger, std::chrono::hours(48)));
+
+    sheetRows.insert(sheetRows.end(), fetched.begin() + 1, fetched.end());
+    auto duplicates = marksman::findPossibleDuplicates(sheetRows, std::chrono::hours(48), 2);
+    ASSERT_EQ(duplicates.size(), 1);
+    EXPECT_EQ(duplicates[0].row, 5);
+    EXPECT_EQ(duplicates[0].transaction->subject, "?dupof(2) Lunch");
+}
@@ -0,0 +1,66 @@
+#include <chrono>
+#include <csignal>
+#include <gtest/gtest.h>
+
+#include "marksman/scheduler.hpp"
+
+using namespace std::chrono_literals;
+using Wake = marksman::CycleScheduler::Wake;
+
+TEST(CycleSchedulerTest, DelayStaysWithinJitter)
+{
+    marksman::CycleScheduler scheduler(1000ms, 200ms);
+    for (int i = 0; i < 1000; ++i)
+    {
+        auto delay = scheduler.nextDelay();
+        EXPECT_GE(delay, 800ms);
+        EXPECT_LE(delay, 1200ms);
+    }
+}
+
+TEST(CycleSchedulerTest, DelayIsNeverNegative)
+{
+    marksman::CycleScheduler scheduler(10ms, 1000ms);
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_GE(scheduler.nextDelay(), 0ms);
+    }
+}
+
+TEST(CycleSchedulerTest, NoJitterKeepsTheInterval)
+{
+    marksman::CycleScheduler scheduler(500ms, 0ms);
+    EXPECT_EQ(scheduler.nextDelay(), 500ms);
+}
+
+TEST(CycleSchedulerTest, RejectsInvalidTimings)
+{
+    EXPECT_THROW(marksman::CycleScheduler(0ms, 0ms), std::runtime_error);
+    EXPECT_THROW(marksman::CycleScheduler(1000ms, -1ms), std::runtime_error);
+}
+
+TEST(CycleSchedulerTest, WaitTimesOut)
+{
+    marksman::CycleScheduler scheduler(1000ms, 0ms);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(scheduler.wait(20ms), Wake::TIMER);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, 20ms);
+}
+
+TEST(CycleSchedulerTest, UserSignalTriggersACycle)
+{
+    marksman::CycleScheduler scheduler(1000ms, 0ms);
+    // Blocked, so it stays pending until wait() collects it
+    raise(SIGUSR1);
+    EXPECT_EQ(scheduler.wait(10s), Wake::TRIGGER);
+    EXPECT_EQ(scheduler.wait(0ms), Wake::TIMER);
+}
+
+TEST(CycleSchedulerTest, TerminationStops)
+{
+    marksman::CycleScheduler scheduler(1000ms, 0ms);
+    raise(SIGTERM);
+    EXPECT_EQ(scheduler.wait(10s), Wake::STOP);
+    raise(SIGINT);
+    EXPECT_EQ(scheduler.wait(10s), Wake::STOP);
+}
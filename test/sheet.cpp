@@ -1,9 +1,12 @@
+#include <climits>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
 
 #include "lib/external/exec.hpp"
 #include "lib/network/requester.hpp"
 #include "lib/sheet/client.hpp"
+#include "lib/sheet/ledger.hpp"
 
 #include "test_utils.hpp"
 
@@ -12,8 +15,46 @@ class MockRequester : public network::Requester
   public:
     MOCK_METHOD(std::string, getRequest,
                 (const std::string &url, const std::vector<std::string> &headers), ());
+
+    // Replays the mocked getRequest body in small pieces, like a slow download would arrive
+    void getRequestStream(
+        const std::string &url, const std::vector<std::string> &headers,
+        const std::function<void(const char *data, std::size_t length)> &onChunk) override
+    {
+        std::string body = getRequest(url, headers);
+        for (std::size_t offset = 0; offset < body.size(); offset += 7)
+        {
+            onChunk(body.data() + offset, std::min<std::size_t>(7, body.size() - offset));
+        }
+    }
+    MOCK_METHOD(std::future<std::string>, postRequestAsync,
+                (const std::string &url, const std::vector<std::string> &headers,
+                 const std::string &body),
+                ());
+    // Batch updates go out as idempotent requests; replay them through postRequestAsync
+    std::future<network::Response> sendAsync(network::Request request) override
+    {
+        EXPECT_TRUE(request.idempotent);
+        auto body = postRequestAsync(request.url, request.headers, request.body);
+        return std::async(std::launch::deferred, [body = std::move(body)]() mutable
+                          { return network::Response{200, body.get(), {}}; });
+    }
 };
 
+static std::future<std::string> readyFuture(const std::string &value)
+{
+    std::promise<std::string> promise;
+    promise.set_value(value);
+    return promise.get_future();
+}
+
+static std::future<std::string> failedFuture(const std::string &message)
+{
+    std::promise<std::string> promise;
+    promise.set_exception(std::make_exception_ptr(std::runtime_error(message)));
+    return promise.get_future();
+}
+
 class MockExec : public external::ShellExec
 {
   public:
@@ -49,6 +90,70 @@ TEST(Sheet, ClientGetTransactions)
     EXPECT_EQ(trxs[0].category, "category");
 }
 
+TEST(Sheet, ClientGetTransactionsFromRow)
+{
+    auto mockedRequester = std::make_shared<MockRequester>();
+    auto mockedExec = std::make_shared<MockExec>();
+
+    EXPECT_CALL(*mockedExec, googleOAuth).WillRepeatedly(testing::Return("test-token"));
+    EXPECT_CALL(*mockedRequester, getRequest(testing::HasSubstr("/values/Transactions!A120:F?"),
+                                             testing::_))
+        .WillOnce(testing::Return(
+            R"({ "values": [["account", "subject", 45658.0, 1000, "IDR", ""]] })"));
+
+    auto client = sheet::Client(mockedRequester, mockedExec);
+    std::vector<sheet::Transaction> trxs = client.getTransactionsFrom(120);
+
+    ASSERT_EQ(trxs.size(), 1);
+    EXPECT_EQ(trxs[0].amount, 1000);
+    EXPECT_THROW(client.getTransactionsFrom(1), std::runtime_error);
+}
+
+TEST(Sheet, ClientReadsAmountsInAnyNumberForm)
+{
+    auto mockedRequester = std::make_shared<MockRequester>();
+    auto mockedExec = std::make_shared<MockExec>();
+
+    EXPECT_CALL(*mockedExec, googleOAuth).WillRepeatedly(testing::Return("test-token"));
+    EXPECT_CALL(*mockedRequester, getRequest(testing::_, testing::_))
+        .WillOnce(testing::Return(R"({ "values": [
+            ["a", "s", 45658.0, 1.5E7, "IDR", ""],
+            ["a", "s", 45658.0, -2.5e3, "IDR", ""],
+            ["a", "s", 45658.0, 1234.9, "IDR", ""],
+            ["a", "s", 45658.0, 1e12, "IDR", ""],
+            ["a", "s", 45658.0, "42", "IDR", ""]
+        ] })"));
+
+    auto client = sheet::Client(mockedRequester, mockedExec);
+    std::vector<sheet::Transaction> trxs = client.getTransactions();
+
+    ASSERT_EQ(trxs.size(), 5);
+    EXPECT_EQ(trxs[0].amount, 15000000);
+    EXPECT_EQ(trxs[1].amount, -2500);
+    EXPECT_EQ(trxs[2].amount, 1234);
+    EXPECT_EQ(trxs[3].amount, INT_MAX);
+    EXPECT_EQ(trxs[4].amount, 42);
+}
+
+TEST(Sheet, ClientGetRevision)
+{
+    auto mockedRequester = std::make_shared<MockRequester>();
+    auto mockedExec = std::make_shared<MockExec>();
+
+    EXPECT_CALL(*mockedExec, googleOAuth(testing::HasSubstr("spreadsheets")))
+        .WillRepeatedly(testing::Return("sheets-token"));
+    EXPECT_CALL(*mockedExec, googleOAuth(testing::HasSubstr("drive.metadata.readonly")))
+        .WillOnce(testing::Return("drive-token"));
+    EXPECT_CALL(*mockedRequester,
+                getRequest("https://www.googleapis.com/drive/v3/files/sheet-1?fields=version",
+                           testing::Contains("Authorization: Bearer drive-token")))
+        .WillOnce(testing::Return(R"({"version": "4217"})"));
+
+    auto client = sheet::Client(mockedRequester, mockedExec);
+    client.setSheetId("sheet-1");
+    EXPECT_EQ(client.getRevision(), "4217");
+}
+
 TEST(Sheet, GoogleSheetsDateTimeParsing)
 {
     auto mockedRequester = std::make_shared<MockRequester>();
@@ -93,3 +198,129 @@ TEST(Sheet, GoogleSheetsDateTimeParsing)
     EXPECT_EQ(trxs[2].currency, "IDR");
     EXPECT_EQ(trxs[2].category, "Utilities");
 }
+
+TEST(Sheet, ClientFlushesQueuedUpdatesInOneBatch)
+{
+    auto mockedRequester = std::make_shared<MockRequester>();
+    auto mockedExec = std::make_shared<MockExec>();
+
+    EXPECT_CALL(*mockedExec, googleOAuth).WillRepeatedly(testing::Return("test-token"));
+
+    std::string sentBody;
+    EXPECT_CALL(*mockedRequester,
+                postRequestAsync(testing::EndsWith("/values:batchUpdate"), testing::_, testing::_))
+        .Times(testing::Exactly(1))
+        .WillOnce(testing::DoAll(testing::SaveArg<2>(&sentBody),
+                                 testing::Invoke([](auto &&...) { return readyFuture("{}"); })));
+
+    auto duplicate = std::make_shared<sheet::Transaction>(sheet::Transaction{
+        "Bank A", "?dupof(2) Lunch", makeTimePoint(2025, 1, 2), 1000, "JPY", ""});
+    auto categorized = std::make_shared<sheet::Transaction>(sheet::Transaction{
+        "Bank A", "Dinner", makeTimePoint(2025, 1, 3), 2000, "JPY", "Food"});
+
+    auto client = sheet::Client(mockedRequester, mockedExec);
+    client.queueDuplicateMarks({{duplicate, 3}});
+    client.queueCategories({{categorized, 4}});
+    EXPECT_EQ(client.pendingUpdateCount(), 3);
+
+    client.flushUpdates();
+    EXPECT_EQ(client.pendingUpdateCount(), 0);
+
+    auto json = nlohmann::json::parse(sentBody);
+    EXPECT_EQ(json["valueInputOption"], "USER_ENTERED");
+    ASSERT_EQ(json["data"].size(), 3);
+    EXPECT_EQ(json["data"][0]["range"], "Transactions!B3:B3");
+    EXPECT_EQ(json["data"][0]["values"][0][0], "?dupof(2) Lunch");
+    EXPECT_EQ(json["data"][1]["range"], "Transactions!D3:D3");
+    EXPECT_EQ(json["data"][1]["values"][0][0], "0");
+    EXPECT_EQ(json["data"][2]["range"], "Transactions!F4:F4");
+    EXPECT_EQ(json["data"][2]["values"][0][0], "Food");
+}
+
+TEST(Sheet, ClientQueuesLedgerEditsAtSheetRows)
+{
+    auto mockedRequester = std::make_shared<MockRequester>();
+    auto mockedExec = std::make_shared<MockExec>();
+
+    EXPECT_CALL(*mockedExec, googleOAuth).WillRepeatedly(testing::Return("test-token"));
+
+    std::string sentBody;
+    EXPECT_CALL(*mockedRequester, postRequestAsync(testing::_, testing::_, testing::_))
+        .WillOnce(testing::DoAll(testing::SaveArg<2>(&sentBody),
+                                 testing::Invoke([](auto &&...) { return readyFuture("{}"); })));
+
+    auto ledger = sheet::Ledger::fromTransactions({
+        {"Bank A", "Lunch", makeTimePoint(2025, 1, 2), 1000, "JPY", ""},
+        {"Bank A", "Lunch", makeTimePoint(2025, 1, 2), 1000, "JPY", ""},
+    });
+    std::string category = "Food";
+
+    // The ledger was fetched from row 40
+    auto client = sheet::Client(mockedRequester, mockedExec);
+    client.queueEdits(ledger,
+                      {{sheet::RowEdit::Kind::MARK_DUPLICATE, 1, 0, {}},
+                       {sheet::RowEdit::Kind::SET_CATEGORY, 0, 0, category}},
+                      40);
+    client.flushUpdates();
+
+    auto json = nlohmann::json::parse(sentBody);
+    ASSERT_EQ(json["data"].size(), 3);
+    EXPECT_EQ(json["data"][0]["range"], "Transactions!B41:B41");
+    EXPECT_EQ(json["data"][0]["values"][0][0], "?dupof(40) Lunch");
+    EXPECT_EQ(json["data"][1]["range"], "Transactions!D41:D41");
+    EXPECT_EQ(json["data"][2]["range"], "Transactions!F40:F40");
+    EXPECT_EQ(json["data"][2]["values"][0][0], "Food");
+}
+
+TEST(Sheet, ClientSplitsBatchIntoChunks)
+{
+    auto mockedRequester = std::make_shared<MockRequester>();
+    auto mockedExec = std::make_shared<MockExec>();
+
+    EXPECT_CALL(*mockedExec, googleOAuth).WillRepeatedly(testing::Return("test-token"));
+    EXPECT_CALL(*mockedRequester, postRequestAsync(testing::_, testing::_, testing::_))
+        .Times(testing::Exactly(3))
+        .WillRepeatedly(testing::Invoke([](auto &&...) { return readyFuture("{}"); }));
+
+    std::vector<sheet::TransactionRow> rows;
+    for (int i = 0; i < 5; ++i)
+    {
+        auto trx = std::make_shared<sheet::Transaction>(sheet::Transaction{
+            "Bank A", "Subject", makeTimePoint(2025, 1, 1), 1000, "JPY", "Food"});
+        rows.push_back({trx, i + 2});
+    }
+
+    auto client = sheet::Client(mockedRequester, mockedExec);
+    client.setBatchChunkSize(2);
+    client.setCategoriesInSheet(rows);
+
+    EXPECT_EQ(client.pendingUpdateCount(), 0);
+}
+
+TEST(Sheet, ClientKeepsUnsentUpdatesOnFailure)
+{
+    auto mockedRequester = std::make_shared<MockRequester>();
+    auto mockedExec = std::make_shared<MockExec>();
+
+    EXPECT_CALL(*mockedExec, googleOAuth).WillRepeatedly(testing::Return("test-token"));
+    EXPECT_CALL(*mockedRequester, postRequestAsync(testing::_, testing::_, testing::_))
+        .WillOnce(testing::Invoke([](auto &&...) { return readyFuture("{}"); }))
+        .WillOnce(testing::Invoke([](auto &&...) { return failedFuture("request failed: 429"); }))
+        .WillOnce(testing::Invoke([](auto &&...) { return readyFuture("{}"); }));
+
+    std::vector<sheet::TransactionRow> rows;
+    for (int i = 0; i < 5; ++i)
+    {
+        auto trx = std::make_shared<sheet::Transaction>(sheet::Transaction{
+            "Bank A", "Subject", makeTimePoint(2025, 1, 1), 1000, "JPY", "Food"});
+        rows.push_back({trx, i + 2});
+    }
+
+    auto client = sheet::Client(mockedRequester, mockedExec);
+    client.setBatchChunkSize(2);
+    client.queueCategories(rows);
+
+    EXPECT_THROW(client.flushUpdates(), std::runtime_error);
+    // Only the failed chunk stays queued
+    EXPECT_EQ(client.pendingUpdateCount(), 2);
+}
@@ -0,0 +1,151 @@
+#include "lib/sheet/snapshot.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "lib/sheet/ledger.hpp"
+
+#include "test_utils.hpp"
+
+class MockClient : public sheet::ClientInterface
+{
+  public:
+    MOCK_METHOD(void, setSheetId, (const std::string &sheetId), (override));
+    MOCK_METHOD(std::string, getRevision, (), (override));
+    MOCK_METHOD(std::vector<sheet::Transaction>, getTransactions, (), (override));
+    MOCK_METHOD(std::vector<sheet::Transaction>, getTransactionsFrom, (int firstRow),
+                (override));
+    MOCK_METHOD(void, streamTransactions,
+                (const std::function<void(sheet::Transaction &&)> &sink), (override));
+    MOCK_METHOD(void, streamTransactionsFrom,
+                (int firstRow, const std::function<void(sheet::Transaction &&)> &sink),
+                (override));
+    MOCK_METHOD(void, markDuplicatesInSheet, (const std::vector<sheet::TransactionRow> &rows),
+                (override));
+    MOCK_METHOD(void, setCategoriesInSheet, (const std::vector<sheet::TransactionRow> &rows),
+                (override));
+    MOCK_METHOD(void, queueDuplicateMarks, (const std::vector<sheet::TransactionRow> &rows),
+                (override));
+    MOCK_METHOD(void, queueCategories, (const std::vector<sheet::TransactionRow> &rows),
+                (override));
+    MOCK_METHOD(void, queueEdits,
+                (const sheet::Ledger &ledger, const std::vector<sheet::RowEdit> &edits,
+                 int firstRow),
+                (override));
+    MOCK_METHOD(void, flushUpdates, (), (override));
+    MOCK_METHOD(void, addTransaction, (const sheet::Transaction &transaction), (override));
+    MOCK_METHOD(void, addTransactions, (const std::vector<sheet::Transaction> &transactions),
+                (override));
+};
+
+class SnapshotTest : public ::testing::Test
+{
+  protected:
+    std::string path;
+    std::vector<sheet::Transaction> transactions = {
+        {"Bank A", "Coffee", makeTimePoint(2025, 1, 1, 9, 30, 0), 35000, "IDR", "Food"},
+        {"Bank A", "Train", makeTimePoint(2025, 1, 1, 18, 5, 0), -12000, "IDR", ""},
+        {"Wallet", "Coffee", makeTimePoint(2025, 1, 2, 9, 45, 0), 35000, "IDR", "Food"},
+    };
+
+    void SetUp() override
+    {
+        path = testTempPath("ledger_snapshot_").string();
+        std::filesystem::remove(path);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove(path);
+    }
+};
+
+static void expectSameTransaction(const sheet::Transaction &a, const sheet::Transaction &b)
+{
+    EXPECT_EQ(a.account, b.account);
+    EXPECT_EQ(a.subject, b.subject);
+    EXPECT_EQ(a.date, b.date);
+    EXPECT_EQ(a.amount, b.amount);
+    EXPECT_EQ(a.currency, b.currency);
+    EXPECT_EQ(a.category, b.category);
+}
+
+TEST_F(SnapshotTest, RoundTrips)
+{
+    sheet::Snapshot::write(path, "sheet-1", "42", transactions);
+
+    sheet::Snapshot snapshot(path);
+    EXPECT_EQ(snapshot.sheetId(), "sheet-1");
+    EXPECT_EQ(snapshot.revision(), "42");
+    ASSERT_EQ(snapshot.rowCount(), 3);
+
+    auto loaded = snapshot.transactions();
+    ASSERT_EQ(loaded.size(), 3);
+    for (std::size_t i = 0; i < loaded.size(); ++i)
+    {
+        expectSameTransaction(loaded[i], transactions[i]);
+    }
+}
+
+TEST_F(SnapshotTest, StoresRepeatedStringsOnce)
+{
+    std::vector<sheet::Transaction> repeated(1000, transactions[0]);
+    sheet::Snapshot::write(path, "sheet-1", "42", repeated);
+
+    // Header, 1000 rows of 8 + 4 + 4 * 4 bytes, and a handful of strings
+    EXPECT_LT(std::filesystem::file_size(path), 48 + 1000 * 28 + 200);
+    sheet::Snapshot snapshot(path);
+    EXPECT_EQ(snapshot.transaction(999).subject, "Coffee");
+}
+
+TEST_F(SnapshotTest, EmptyLedger)
+{
+    sheet::Snapshot::write(path, "sheet-1", "1", {});
+
+    sheet::Snapshot snapshot(path);
+    EXPECT_EQ(snapshot.rowCount(), 0);
+    EXPECT_TRUE(snapshot.transactions().empty());
+}
+
+TEST_F(SnapshotTest, RejectsTruncatedOrForeignFiles)
+{
+    EXPECT_THROW(sheet::Snapshot snapshot(path), std::runtime_error);
+
+    sheet::Snapshot::write(path, "sheet-1", "42", transactions);
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    EXPECT_THROW(sheet::Snapshot snapshot(path), std::runtime_error);
+
+    std::ofstream(path, std::ios::trunc) << "account,subject,date\n" << std::string(64, 'x');
+    EXPECT_THROW(sheet::Snapshot snapshot(path), std::runtime_error);
+}
+
+TEST_F(SnapshotTest, LoadTransactionsUsesSnapshotAtSameRevision)
+{
+    sheet::Snapshot::write(path, "sheet-1", "42", transactions);
+
+    MockClient client;
+    EXPECT_CALL(client, getRevision()).WillOnce(testing::Return("42"));
+    EXPECT_CALL(client, getTransactions()).Times(0);
+
+    auto loaded = sheet::loadTransactions(client, "sheet-1", path);
+    ASSERT_EQ(loaded.size(), 3);
+    expectSameTransaction(loaded[1], transactions[1]);
+}
+
+TEST_F(SnapshotTest, LoadTransactionsRefetchesAfterAnEdit)
+{
+    sheet::Snapshot::write(path, "sheet-1", "42", transactions);
+    std::vector<sheet::Transaction> edited(transactions.begin(), transactions.begin() + 1);
+
+    MockClient client;
+    EXPECT_CALL(client, getRevision()).WillOnce(testing::Return("43"));
+    EXPECT_CALL(client, getTransactions()).WillOnce(testing::Return(edited));
+
+    EXPECT_EQ(sheet::loadTransactions(client, "sheet-1", path).size(), 1);
+
+    sheet::Snapshot snapshot(path);
+    EXPECT_EQ(snapshot.revision(), "43");
+    EXPECT_EQ(snapshot.rowCount(), 1);
+}
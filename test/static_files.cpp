@@ -0,0 +1,125 @@
+#include "lib/network/static_files.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+
+#include "test_utils.hpp"
+
+class StaticFilesTest : public ::testing::Test
+{
+  protected:
+    std::filesystem::path root;
+
+    void SetUp() override
+    {
+        root = testTempPath("static_files_");
+        std::filesystem::create_directories(root / "assets");
+        writeFile("index.html", "<html>index</html>");
+        writeFile("assets/app.js", "console.log('plain');");
+        writeFile("assets/app.js.gz", "gzipped");
+        writeFile("assets/app.js.br", "brotli");
+        writeFile("assets/big.bin", std::string(4096, 'b'));
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(root);
+    }
+
+    void writeFile(const std::string &name, const std::string &content)
+    {
+        std::ofstream file(root / name, std::ios::binary);
+        file << content;
+    }
+};
+
+TEST_F(StaticFilesTest, ServesIndexForRoot)
+{
+    network::StaticFileCache cache;
+    EXPECT_EQ(cache.load(root.string()), 3);
+
+    network::StaticReply reply;
+    ASSERT_TRUE(cache.lookup("/", "", "", reply));
+    EXPECT_EQ(reply.code, 200);
+    EXPECT_EQ(reply.body, "<html>index</html>");
+    EXPECT_NE(reply.head.find("Content-Type: text/html"), std::string::npos);
+    EXPECT_NE(reply.head.find("Content-Length: 18\r\n"), std::string::npos);
+    EXPECT_NE(reply.head.find("ETag: \""), std::string::npos);
+    EXPECT_NE(reply.head.find("Last-Modified: "), std::string::npos);
+    EXPECT_EQ(reply.head.find("Vary:"), std::string::npos);
+
+    EXPECT_FALSE(cache.lookup("/missing.js", "", "", reply));
+    EXPECT_FALSE(cache.lookup("/assets/app.js.gz", "", "", reply));
+}
+
+TEST_F(StaticFilesTest, PicksPrecompressedVariantFromAcceptEncoding)
+{
+    network::StaticFileCache cache;
+    cache.load(root.string());
+
+    network::StaticReply reply;
+    ASSERT_TRUE(cache.lookup("/assets/app.js", "gzip, deflate, br", "", reply));
+    EXPECT_EQ(reply.body, "brotli");
+    EXPECT_NE(reply.head.find("Content-Encoding: br\r\n"), std::string::npos);
+    EXPECT_NE(reply.head.find("Vary: Accept-Encoding\r\n"), std::string::npos);
+
+    ASSERT_TRUE(cache.lookup("/assets/app.js", "gzip, br;q=0", "", reply));
+    EXPECT_EQ(reply.body, "gzipped");
+    EXPECT_NE(reply.head.find("Content-Encoding: gzip\r\n"), std::string::npos);
+
+    ASSERT_TRUE(cache.lookup("/assets/app.js", "", "", reply));
+    EXPECT_EQ(reply.body, "console.log('plain');");
+    EXPECT_EQ(reply.head.find("Content-Encoding"), std::string::npos);
+    EXPECT_NE(reply.head.find("Vary: Accept-Encoding\r\n"), std::string::npos);
+}
+
+TEST_F(StaticFilesTest, AnswersMatchingEtagWithNotModified)
+{
+    network::StaticFileCache cache;
+    cache.load(root.string());
+
+    network::StaticReply reply;
+    ASSERT_TRUE(cache.lookup("/index.html", "", "", reply));
+    std::size_t start = reply.head.find("ETag: ") + 6;
+    std::string etag = reply.head.substr(start, reply.head.find("\r\n", start) - start);
+
+    ASSERT_TRUE(cache.lookup("/index.html", "", "\"other\", W/" + etag, reply));
+    EXPECT_EQ(reply.code, 304);
+    EXPECT_TRUE(reply.body.empty());
+    EXPECT_EQ(reply.head.rfind("HTTP/1.1 304 Not Modified\r\n", 0), 0);
+
+    ASSERT_TRUE(cache.lookup("/index.html", "", "\"other\"", reply));
+    EXPECT_EQ(reply.code, 200);
+
+    // Each encoding has its own ETag, so a cached gzip body does not validate the plain one
+    ASSERT_TRUE(cache.lookup("/assets/app.js", "gzip", "", reply));
+    start = reply.head.find("ETag: ") + 6;
+    std::string gzipEtag = reply.head.substr(start, reply.head.find("\r\n", start) - start);
+    ASSERT_TRUE(cache.lookup("/assets/app.js", "", gzipEtag, reply));
+    EXPECT_EQ(reply.code, 200);
+}
+
+TEST_F(StaticFilesTest, KeepsLargeFilesOpenForSendfile)
+{
+    network::StaticFileCache cache;
+    cache.setSendfileThreshold(1024);
+    cache.load(root.string());
+
+    network::StaticReply reply;
+    ASSERT_TRUE(cache.lookup("/assets/big.bin", "", "", reply));
+    EXPECT_GE(reply.fd, 0);
+    EXPECT_EQ(reply.length, 4096);
+    EXPECT_TRUE(reply.body.empty());
+    EXPECT_NE(reply.head.find("Content-Type: application/octet-stream"), std::string::npos);
+
+    ASSERT_TRUE(cache.lookup("/index.html", "", "", reply));
+    EXPECT_EQ(reply.fd, -1);
+}
+
+TEST(StaticFiles, ThrowsForMissingDirectory)
+{
+    network::StaticFileCache cache;
+    EXPECT_THROW(cache.load("/nonexistent/static/root"), std::runtime_error);
+}
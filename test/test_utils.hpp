@@ -1,7 +1,20 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
 #include <ctime>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "lib/network.hpp"
 
 // Helper function to create time points for testing
 inline std::chrono::system_clock::time_point
@@ -20,3 +33,157 @@ makeTimePoint(int year, int month, int day, int hour = 0, int minute = 0, int se
 
     return std::chrono::system_clock::from_time_t(tt);
 }
+
+// A path in the temp directory named after the running test and process, so neither other
+// tests nor a parallel run of the suite touch the same file
+inline std::filesystem::path testTempPath(const std::string &prefix)
+{
+    const auto *test = ::testing::UnitTest::GetInstance()->current_test_info();
+    return std::filesystem::temp_directory_path() /
+           (prefix + test->name() + "_" + std::to_string(getpid()));
+}
+
+// Answers sendAsync from queued outcomes in order, falling back to a responder (200 "ok" by
+// default) once they run out, and records every request. The other methods go through
+// sendAsync, so a test only ever scripts one call.
+class ScriptedRequester : public network::RequesterInterface
+{
+  public:
+    struct Outcome
+    {
+        long code;
+        std::string body = "ok";
+        std::vector<std::pair<std::string, std::string>> headers = {};
+        // Drop the connection instead of answering, after streaming the body if there is one
+        bool drop = false;
+    };
+    using Responder = std::function<network::Response(const network::Request &request)>;
+
+    explicit ScriptedRequester(Responder responder = nullptr) : m_responder(std::move(responder))
+    {
+    }
+
+    void queue(Outcome outcome)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_script.push_back(std::move(outcome));
+    }
+
+    std::vector<network::Request> sent()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_sent;
+    }
+
+    std::future<network::Response> sendAsync(network::Request request) override
+    {
+        Outcome outcome{200};
+        bool scripted = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_sent.push_back(request);
+            if (!m_script.empty())
+            {
+                outcome = m_script.front();
+                m_script.pop_front();
+                scripted = true;
+            }
+        }
+        if (!scripted && m_responder)
+        {
+            network::Response response = m_responder(request);
+            outcome = {response.code, response.body, response.headers};
+        }
+
+        std::promise<network::Response> promise;
+        network::Response response{outcome.code, outcome.body, outcome.headers};
+        bool success = outcome.code >= 200 && outcome.code < 300;
+        if (request.onData && (outcome.drop || success))
+        {
+            // Uneven pieces, like a real download
+            for (std::size_t offset = 0; offset < response.body.size(); offset += 7)
+            {
+                std::size_t length = std::min<std::size_t>(7, response.body.size() - offset);
+                if (!request.onData(response.body.data() + offset, length))
+                {
+                    outcome.drop = true;
+                    break;
+                }
+            }
+            response.body.clear();
+        }
+        if (outcome.drop)
+        {
+            promise.set_exception(std::make_exception_ptr(std::runtime_error("connection reset")));
+        }
+        else
+        {
+            promise.set_value(response);
+        }
+        return promise.get_future();
+    }
+
+    std::future<std::string> getRequestAsync(const std::string &url,
+                                             const std::vector<std::string> &headers) override
+    {
+        return std::async(std::launch::deferred,
+                          [this, url, headers] { return checked({"GET", url, headers, ""}); });
+    }
+    std::future<std::string> postRequestAsync(const std::string &url,
+                                              const std::vector<std::string> &headers,
+                                              const std::string &body) override
+    {
+        return std::async(std::launch::deferred, [this, url, headers, body]
+                          { return checked({"POST", url, headers, body}); });
+    }
+    std::future<std::string> putRequestAsync(const std::string &url,
+                                             const std::vector<std::string> &headers,
+                                             const std::string &body) override
+    {
+        return std::async(std::launch::deferred, [this, url, headers, body]
+                          { return checked({"PUT", url, headers, body}); });
+    }
+    std::string getRequest(const std::string &url,
+                           const std::vector<std::string> &headers) override
+    {
+        return checked({"GET", url, headers, ""});
+    }
+    void getRequestStream(
+        const std::string &url, const std::vector<std::string> &headers,
+        const std::function<void(const char *data, std::size_t length)> &onChunk) override
+    {
+        network::Request request{"GET", url, headers, ""};
+        request.onData = [&onChunk](const char *data, std::size_t length)
+        {
+            onChunk(data, length);
+            return true;
+        };
+        checked(request);
+    }
+    std::string postRequest(const std::string &url, const std::vector<std::string> &headers,
+                            const std::string &body) override
+    {
+        return checked({"POST", url, headers, body});
+    }
+    std::string putRequest(const std::string &url, const std::vector<std::string> &headers,
+                           const std::string &body) override
+    {
+        return checked({"PUT", url, headers, body});
+    }
+
+  private:
+    Responder m_responder;
+    std::mutex m_mutex;
+    std::deque<Outcome> m_script;
+    std::vector<network::Request> m_sent;
+
+    std::string checked(network::Request request)
+    {
+        network::Response response = sendAsync(std::move(request)).get();
+        if (response.code < 200 || response.code >= 300)
+        {
+            throw std::runtime_error("request failed: " + std::to_string(response.code));
+        }
+        return response.body;
+    }
+};
@@ -0,0 +1,39 @@
+#include "lib/concurrency/thread_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(ThreadPool, ParallelForRunsEveryIndexOnce)
+{
+    concurrency::ThreadPool pool(4);
+    std::vector<std::atomic<int>> calls(100);
+
+    pool.parallelFor(calls.size(), [&calls](std::size_t index) { ++calls[index]; });
+
+    for (const auto &count : calls)
+    {
+        EXPECT_EQ(count, 1);
+    }
+}
+
+TEST(ThreadPool, ParallelForRethrowsAfterEveryCallFinished)
+{
+    concurrency::ThreadPool pool(2);
+    std::atomic<int> finished(0);
+
+    auto fn = [&finished](std::size_t index)
+    {
+        if (index == 0)
+        {
+            throw std::runtime_error("first");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ++finished;
+    };
+    EXPECT_THROW(pool.parallelFor(6, fn), std::runtime_error);
+    EXPECT_EQ(finished, 5);
+}
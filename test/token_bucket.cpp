@@ -0,0 +1,46 @@
+#include "lib/network/token_bucket.hpp"
+
+#include <gtest/gtest.h>
+
+using Clock = network::TokenBucket::Clock;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+TEST(TokenBucketTest, AllowsABurstThenSpacesRequests)
+{
+    network::TokenBucket bucket(5, seconds(5));
+    Clock::time_point now = Clock::now();
+
+    for (int i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ(bucket.take(now), now);
+    }
+    EXPECT_EQ(bucket.take(now), now + seconds(1));
+    EXPECT_EQ(bucket.take(now), now + seconds(2));
+
+    // Tokens earned later pay off the queued reservations first
+    EXPECT_EQ(bucket.take(now + seconds(3)), now + seconds(3));
+    EXPECT_EQ(bucket.take(now + seconds(10)), now + seconds(10));
+}
+
+TEST(TokenBucketTest, ServerLimitsOverrideTheLocalEstimate)
+{
+    network::TokenBucket bucket(5, seconds(5));
+    Clock::time_point now = Clock::now();
+
+    bucket.take(now);
+    bucket.update(0, milliseconds(2500), now);
+    EXPECT_GE(bucket.take(now), now + milliseconds(2500));
+
+    network::TokenBucket paused(50, seconds(1));
+    paused.pauseUntil(now + seconds(3));
+    paused.pauseUntil(now + seconds(1));
+    EXPECT_EQ(paused.take(now), now + seconds(3));
+    EXPECT_EQ(paused.take(now + seconds(4)), now + seconds(4));
+}
+
+TEST(TokenBucketTest, RejectsAnEmptyBucket)
+{
+    EXPECT_THROW(network::TokenBucket(0, seconds(1)), std::runtime_error);
+    EXPECT_THROW(network::TokenBucket(1, seconds(0)), std::runtime_error);
+}
@@ -0,0 +1,114 @@
+#include "lib/sheet/values_stream.hpp"
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Cell = sheet::ValuesStreamParser::Cell;
+
+static std::vector<std::vector<Cell>> parseInPieces(const std::string &json,
+                                                    std::size_t pieceSize)
+{
+    std::vector<std::vector<Cell>> rows;
+    sheet::ValuesStreamParser parser([&rows](const std::vector<Cell> &cells)
+                                     { rows.push_back(cells); });
+    for (std::size_t offset = 0; offset < json.size(); offset += pieceSize)
+    {
+        parser.feed(json.data() + offset, std::min(pieceSize, json.size() - offset));
+    }
+    parser.finish();
+    return rows;
+}
+
+const std::string VALUES_RESPONSE = R"({
+  "range": "Transactions!A2:F4",
+  "majorDimension": "ROWS",
+  "values": [
+    ["Bank A", "Coffee \"to go\"", 45657.5, 450, "JPY", "Food"],
+    ["Bank B", "東京 🚃", 45658.25, -1200],
+    [],
+    ["Bank C", null, 45659, "300", true, {"nested": [1, 2]}]
+  ]
+})";
+
+TEST(ValuesStream, EmitsRowsRegardlessOfChunking)
+{
+    for (std::size_t pieceSize : {std::size_t(1), std::size_t(3), VALUES_RESPONSE.size()})
+    {
+        auto rows = parseInPieces(VALUES_RESPONSE, pieceSize);
+
+        ASSERT_EQ(rows.size(), 4) << pieceSize;
+        ASSERT_EQ(rows[0].size(), 6);
+        EXPECT_EQ(rows[0][0].text, "Bank A");
+        EXPECT_EQ(rows[0][1].text, "Coffee \"to go\"");
+        EXPECT_EQ(rows[0][2].type, Cell::Type::NUMBER);
+        EXPECT_EQ(rows[0][2].text, "45657.5");
+        EXPECT_EQ(rows[0][3].text, "450");
+
+        ASSERT_EQ(rows[1].size(), 4);
+        EXPECT_EQ(rows[1][1].text, "東京 🚃");
+        EXPECT_EQ(rows[1][3].text, "-1200");
+
+        EXPECT_TRUE(rows[2].empty());
+
+        ASSERT_EQ(rows[3].size(), 6);
+        EXPECT_EQ(rows[3][1].type, Cell::Type::EMPTY);
+        EXPECT_EQ(rows[3][3].type, Cell::Type::STRING);
+        EXPECT_EQ(rows[3][4].type, Cell::Type::BOOLEAN);
+        EXPECT_EQ(rows[3][4].text, "true");
+        EXPECT_EQ(rows[3][5].type, Cell::Type::EMPTY);
+    }
+}
+
+TEST(ValuesStream, EmitsEachRowBeforeTheNextArrives)
+{
+    std::size_t rowsSeen = 0;
+    sheet::ValuesStreamParser parser([&rowsSeen](const std::vector<Cell> &) { ++rowsSeen; });
+
+    std::string first = R"({"values": [["a", 1], ["b")";
+    parser.feed(first.data(), first.size());
+    EXPECT_EQ(rowsSeen, 1);
+
+    std::string rest = R"(, 2]]})";
+    parser.feed(rest.data(), rest.size());
+    parser.finish();
+    EXPECT_EQ(rowsSeen, 2);
+    EXPECT_EQ(parser.rowCount(), 2);
+}
+
+TEST(ValuesStream, AcceptsResponseWithoutValues)
+{
+    // An empty range comes back without a "values" member
+    auto rows = parseInPieces(R"({"range": "Transactions!A2:F", "majorDimension": "ROWS"})", 5);
+    EXPECT_TRUE(rows.empty());
+}
+
+TEST(ValuesStream, IgnoresArraysOutsideValues)
+{
+    auto rows = parseInPieces(R"({"other": [["x"]], "values": [["y"]]})", 2);
+    ASSERT_EQ(rows.size(), 1);
+    EXPECT_EQ(rows[0][0].text, "y");
+}
+
+TEST(ValuesStream, RejectsMalformedInput)
+{
+    const std::string malformed[] = {
+        R"({"values": [["a",]]})",
+        R"({"values": [["a"]})",
+        R"({"values": [[nope]]})",
+        R"({"values": [["a\q"]]})",
+        R"({"values" [["a"]]})",
+        R"({"values": [["a"]]} x)",
+    };
+
+    for (const auto &json : malformed)
+    {
+        EXPECT_THROW(parseInPieces(json, 4), std::runtime_error) << json;
+    }
+}
+
+TEST(ValuesStream, RejectsTruncatedDocument)
+{
+    EXPECT_THROW(parseInPieces(R"({"values": [["a", 1], ["b")", 4), std::runtime_error);
+}
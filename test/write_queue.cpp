@@ -0,0 +1,225 @@
+#include "lib/sheet/write_queue.hpp"
+
+#include <condition_variable>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "test_utils.hpp"
+
+using namespace std::chrono_literals;
+
+// Records addTransactions calls; every other ClientInterface method is unused here
+class RecordingClient : public sheet::ClientInterface
+{
+  public:
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<std::vector<sheet::Transaction>> batches;
+    int failuresLeft = 0;
+    std::chrono::milliseconds appendDelay{0};
+
+    void setSheetId(const std::string &) override
+    {
+    }
+    std::string getRevision() override
+    {
+        return "";
+    }
+    std::vector<sheet::Transaction> getTransactions() override
+    {
+        return {};
+    }
+    std::vector<sheet::Transaction> getTransactionsFrom(int) override
+    {
+        return {};
+    }
+    void streamTransactions(const std::function<void(sheet::Transaction &&)> &) override
+    {
+    }
+    void streamTransactionsFrom(int, const std::function<void(sheet::Transaction &&)> &) override
+    {
+    }
+    void markDuplicatesInSheet(const std::vector<sheet::TransactionRow> &) override
+    {
+    }
+    void setCategoriesInSheet(const std::vector<sheet::TransactionRow> &) override
+    {
+    }
+    void queueDuplicateMarks(const std::vector<sheet::TransactionRow> &) override
+    {
+    }
+    void queueCategories(const std::vector<sheet::TransactionRow> &) override
+    {
+    }
+    void queueEdits(const sheet::Ledger &, const std::vector<sheet::RowEdit> &, int) override
+    {
+    }
+    void flushUpdates() override
+    {
+    }
+    void addTransaction(const sheet::Transaction &transaction) override
+    {
+        addTransactions({transaction});
+    }
+
+    void addTransactions(const std::vector<sheet::Transaction> &transactions) override
+    {
+        std::this_thread::sleep_for(appendDelay);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (failuresLeft != 0)
+        {
+            if (failuresLeft > 0)
+            {
+                --failuresLeft;
+            }
+            throw std::runtime_error("request failed: 503");
+        }
+        batches.push_back(transactions);
+        condition.notify_all();
+    }
+
+    bool waitForBatches(std::size_t count)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, 5s, [&] { return batches.size() >= count; });
+    }
+};
+
+class WriteQueueTest : public ::testing::Test
+{
+  protected:
+    std::string journalPath;
+
+    void SetUp() override
+    {
+        journalPath = testTempPath("write_queue_").string() + ".jsonl";
+        std::filesystem::remove(journalPath);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove(journalPath);
+    }
+
+    sheet::Transaction makeTransaction(const std::string &subject, int amount)
+    {
+        return {"Bank A", subject, makeTimePoint(2026, 2, 1, 12, 30, 0), amount, "JPY", ""};
+    }
+};
+
+TEST_F(WriteQueueTest, FlushesFullBatchInOneAppend)
+{
+    auto client = std::make_shared<RecordingClient>();
+    sheet::WriteBehindQueue queue(client, journalPath);
+    queue.setBatchSize(3);
+    queue.setFlushDelay(1h);
+    queue.start();
+
+    queue.enqueue(makeTransaction("Onigiri", 150));
+    queue.enqueue(makeTransaction("Tea", 120));
+    queue.enqueue(makeTransaction("Bento", 600));
+
+    ASSERT_TRUE(client->waitForBatches(1));
+    std::lock_guard<std::mutex> lock(client->mutex);
+    ASSERT_EQ(client->batches.size(), 1);
+    ASSERT_EQ(client->batches[0].size(), 3);
+    EXPECT_EQ(client->batches[0][0].subject, "Onigiri");
+    EXPECT_EQ(client->batches[0][2].amount, 600);
+}
+
+TEST_F(WriteQueueTest, FlushesPartialBatchAfterDelay)
+{
+    auto client = std::make_shared<RecordingClient>();
+    sheet::WriteBehindQueue queue(client, journalPath);
+    queue.setBatchSize(100);
+    queue.setFlushDelay(20ms);
+    queue.start();
+
+    queue.enqueue(makeTransaction("Onigiri", 150));
+    queue.enqueue(makeTransaction("Tea", 120));
+
+    ASSERT_TRUE(client->waitForBatches(1));
+    std::lock_guard<std::mutex> lock(client->mutex);
+    EXPECT_EQ(client->batches[0].size(), 2);
+}
+
+TEST_F(WriteQueueTest, KeepsTheDelayOfRowsQueuedDuringAnAppend)
+{
+    auto client = std::make_shared<RecordingClient>();
+    client->appendDelay = 250ms;
+    sheet::WriteBehindQueue queue(client, journalPath);
+    queue.setBatchSize(100);
+    queue.setFlushDelay(300ms);
+    queue.start();
+
+    // The first append goes out at 300ms and takes until 550ms
+    queue.enqueue(makeTransaction("Onigiri", 150));
+    std::this_thread::sleep_for(350ms);
+    auto queuedAt = std::chrono::steady_clock::now();
+    queue.enqueue(makeTransaction("Tea", 120));
+
+    // Sent 300ms after it was queued, not 300ms after the first append returned, and then
+    // in flight for another 250ms
+    ASSERT_TRUE(client->waitForBatches(2));
+    auto waited = std::chrono::steady_clock::now() - queuedAt;
+    EXPECT_GE(waited, 540ms);
+    EXPECT_LT(waited, 700ms);
+    std::lock_guard<std::mutex> lock(client->mutex);
+    ASSERT_EQ(client->batches[1].size(), 1);
+    EXPECT_EQ(client->batches[1][0].subject, "Tea");
+}
+
+TEST_F(WriteQueueTest, RetriesFailedAppends)
+{
+    auto client = std::make_shared<RecordingClient>();
+    client->failuresLeft = 2;
+    sheet::WriteBehindQueue queue(client, journalPath);
+    queue.setBatchSize(1);
+    queue.setRetryBackoff(1ms, 5ms);
+    queue.start();
+
+    queue.enqueue(makeTransaction("Onigiri", 150));
+
+    ASSERT_TRUE(client->waitForBatches(1));
+    std::lock_guard<std::mutex> lock(client->mutex);
+    EXPECT_EQ(client->failuresLeft, 0);
+    EXPECT_EQ(client->batches[0][0].subject, "Onigiri");
+}
+
+TEST_F(WriteQueueTest, ReplaysJournalAfterRestart)
+{
+    {
+        auto failing = std::make_shared<RecordingClient>();
+        failing->failuresLeft = -1;
+        sheet::WriteBehindQueue queue(failing, journalPath);
+        queue.setFlushDelay(1h);
+        queue.start();
+        queue.enqueue(makeTransaction("Onigiri", 150));
+        queue.enqueue(makeTransaction("Tea", 120));
+        EXPECT_EQ(queue.pendingCount(), 2);
+    }
+
+    auto client = std::make_shared<RecordingClient>();
+    sheet::WriteBehindQueue queue(client, journalPath);
+    queue.setFlushDelay(1ms);
+    queue.start();
+
+    ASSERT_TRUE(client->waitForBatches(1));
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        ASSERT_EQ(client->batches[0].size(), 2);
+        EXPECT_EQ(client->batches[0][0].subject, "Onigiri");
+        EXPECT_EQ(client->batches[0][1].subject, "Tea");
+        EXPECT_EQ(client->batches[0][1].date, makeTimePoint(2026, 2, 1, 12, 30, 0));
+    }
+
+    // Sent transactions are dropped from the journal
+    for (int i = 0; i < 500 && std::filesystem::file_size(journalPath) != 0; ++i)
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(std::filesystem::file_size(journalPath), 0);
+}